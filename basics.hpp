@@ -2,6 +2,7 @@
 #define BASICS_HPP
 
 #include <boost/multiprecision/cpp_bin_float.hpp>
+#include "float_kernels.hpp"
 
 namespace calc_val {
 
@@ -15,6 +16,11 @@ using int_type = __int128;
 using max_uint_type = unsigned __int128;
 using max_int_type = __int128;
 
+template <bool Signed> class wide_integer; // wide_int.hpp
+using wide_uint_type = wide_integer<false>;
+using wide_int_type = wide_integer<true>;
+// the integer types of the word sizes above 128 bits
+
 static const float_type pi     = boost::math::constants::pi<float_type>();
 static const float_type two_pi = boost::math::constants::two_pi<float_type>();
 static const float_type e      = boost::math::constants::e<float_type>();
@@ -26,7 +32,7 @@ enum radices {base2 = 2, base8 = 8, base10 = 10, base16 = 16};
 
 enum int_word_sizes {
     int_bits_8 = 8, int_bits_16 = 16, int_bits_32 = 32, int_bits_64 = 64,
-    int_bits_128 = 128};
+    int_bits_128 = 128, int_bits_256 = 256, int_bits_512 = 512, int_bits_1024 = 1024};
 
 // note: not using scoped enums because i want enum values to automatically be
 // convertible to their underlying types and to be accessable unqualified in
@@ -38,9 +44,17 @@ template <typename T>
 constexpr auto is_float_type() -> bool
 {return std::is_same_v<std::decay_t<T>, float_type>;}
 
+template <typename T>
+constexpr auto is_wide_int_type() -> bool
+{return std::is_same_v<std::decay_t<T>, wide_uint_type> || std::is_same_v<std::decay_t<T>, wide_int_type>;}
+
 template <typename T>
 constexpr auto is_int_type() -> bool
-{return std::is_same_v<std::decay_t<T>, uint_type> || std::is_same_v<std::decay_t<T>, int_type>;}
+{return std::is_same_v<std::decay_t<T>, uint_type> || std::is_same_v<std::decay_t<T>, int_type> || is_wide_int_type<T>();}
+
+template <typename T>
+constexpr auto is_signed_int_type() -> bool
+{return std::is_same_v<std::decay_t<T>, int_type> || std::is_same_v<std::decay_t<T>, wide_int_type>;}
 
 } // namespace calc_val
 
@@ -0,0 +1,48 @@
+#ifndef BENCH_HPP
+#define BENCH_HPP
+
+// timing of the benchmarks: the time per call of a function (the best of a
+// few runs), printed with a label and, for an alternative, its speedup over
+// the baseline
+
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string_view>
+
+namespace bench {
+
+template <typename Fn>
+auto seconds_per_call(std::size_t calls, Fn&& fn) -> double {
+// the best of 5 runs of calls calls of fn
+    auto best = 0.0;
+    for (auto run = 0; run < 5; ++run) {
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < calls; ++i)
+            fn();
+        auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (run == 0 || seconds < best)
+            best = seconds;
+    }
+    return best / static_cast<double>(calls);
+}
+
+inline auto report(std::string_view what, double seconds, double baseline_seconds = 0) -> void {
+    std::printf("%-56.*s %12.3f us", static_cast<int>(what.size()), what.data(), seconds * 1e6);
+    if (baseline_seconds)
+        std::printf("  x%.2f", baseline_seconds / seconds);
+    std::printf("\n");
+}
+
+template <typename T>
+inline auto keep(const T& x) -> void {asm volatile("" : : "g"(&x) : "memory");}
+// keeps the computation of x from being optimized away
+
+template <typename T>
+inline auto opaque(T x) -> T {asm volatile("" : "+m"(x)); return x;}
+// x, which the compiler can't then take for a constant (so a computation of
+// it is not hoisted out of a loop)
+
+} // namespace bench
+
+#endif // BENCH_HPP
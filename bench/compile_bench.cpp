@@ -0,0 +1,36 @@
+// compile_bench: formulas evaluated from their source against their compiled
+// expressions, whose constant subexpressions are folded and whose repeated
+// subexpressions are evaluated once
+
+#include "bench.hpp"
+#include "calc_parser.hpp"
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+namespace {
+
+constexpr auto formulas = {
+    "2*pi*sqrt(2)/ln(10)*x",
+    "sin(x)^2 + sin(x)*cos(x)",
+    "exp(-x^2/2)/sqrt(2*pi)",
+    "(x+1)^3 - 3*(x+1)^2 + 3*(x+1) - 1",
+    "ln(x)*ln(x) + ln(x)/ln(10)",
+    "hypot(x, 2*pi)*atan(1)*4"};
+
+} // namespace
+
+auto main() -> int {
+    auto parser = calc_parser();
+    auto out_options = output_options();
+    parser.evaluate("x=1.25", [] {}, out_options);
+    for (std::string_view formula : formulas) {
+        auto from_source = bench::seconds_per_call(2000, [&] {
+            bench::keep(parser.try_evaluate(formula, [] {}, out_options));
+        });
+        auto expr = parser.compile(formula);
+        auto compiled = bench::seconds_per_call(2000, [&] {bench::keep(parser.try_evaluate(expr));});
+        bench::report(std::string(formula) + ", source", from_source);
+        bench::report(std::string(formula) + ", compiled", compiled, from_source);
+    }
+}
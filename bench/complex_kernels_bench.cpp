@@ -0,0 +1,73 @@
+// complex_kernels_bench: the multiplication and division kernels of
+// complex_type (float_kernels.hpp) against boost's templates, for general,
+// real and imaginary operands and squares, with a check that the results are
+// the same bits; and evaluated powers and products
+
+#include "bench.hpp"
+#include "calc_parser.hpp"
+#include <cstdio>
+#include <initializer_list>
+#include <string>
+
+namespace {
+
+using backend = calc_val::complex_type::backend_type;
+namespace backends = boost::multiprecision::backends;
+
+using float_backend = calc_val::float_type::backend_type;
+using assign_op = void (*)(backend& r, const backend& z);
+
+auto same_bits(const float_backend& x, const float_backend& y) -> bool
+{return x.sign() == y.sign() && x.exponent() == y.exponent() && x.bits().compare(y.bits()) == 0;}
+
+auto compare(const std::string& what, const calc_val::complex_type& x, const calc_val::complex_type& z,
+    assign_op kernel, assign_op boost_template) -> bool
+{
+    auto r = x.backend(), boost_r = x.backend();
+    kernel(r, z.backend());
+    boost_template(boost_r, z.backend());
+    auto same = same_bits(r.real_data(), boost_r.real_data()) && same_bits(r.imag_data(), boost_r.imag_data());
+    auto boost_seconds = bench::seconds_per_call(100000, [&] {
+        boost_r = bench::opaque(x.backend());
+        boost_template(boost_r, z.backend());
+        bench::keep(boost_r);
+    });
+    bench::report("boost " + what, boost_seconds);
+    bench::report("kernel " + what, bench::seconds_per_call(100000, [&] {
+        r = bench::opaque(x.backend());
+        kernel(r, z.backend());
+        bench::keep(r);
+    }), boost_seconds);
+    return same;
+}
+
+} // namespace
+
+auto main() -> int {
+    auto a = sqrt(calc_val::float_type(2)), b = calc_val::float_type(1) / 3; // all 334 bits of the significand
+    auto x = calc_val::complex_type(a, b);
+    auto general = calc_val::complex_type(b, -a);
+    auto real = calc_val::complex_type(b);
+    auto imaginary = calc_val::complex_type(0, a);
+    // explicit template arguments take boost's templates rather than the kernels
+    auto ok = compare("multiply", x, general, backends::eval_multiply, backends::eval_multiply<float_backend>);
+    ok = compare("multiply by a real", x, real, backends::eval_multiply,
+        backends::eval_multiply<float_backend>) && ok;
+    ok = compare("multiply by an imaginary", x, imaginary, backends::eval_multiply,
+        backends::eval_multiply<float_backend>) && ok;
+    ok = compare("square", x, x, backends::eval_multiply, backends::eval_multiply<float_backend>) && ok;
+    ok = compare("divide", x, general, backends::eval_divide, backends::eval_divide<float_backend>) && ok;
+    ok = compare("divide by an imaginary", x, imaginary, backends::eval_divide,
+        backends::eval_divide<float_backend>) && ok;
+
+    auto parser = calc_parser();
+    auto out_options = output_options();
+    parser.evaluate("z=1.5-0.25i", [] {}, out_options);
+    for (auto input : {"z^37", "z*z*z*z*z*z*z*z", "(z*(1+2i) - 3i*z)/(2i)"})
+        bench::report(std::string("evaluate ") + input, bench::seconds_per_call(10000, [&] {
+            bench::keep(parser.try_evaluate(input, [] {}, out_options));
+        }));
+    if (!ok)
+        std::printf("a kernel's result differs from boost's\n");
+    return !ok;
+}
@@ -0,0 +1,51 @@
+// float_kernels_bench: the arithmetic kernels of float_type's backend
+// (float_kernels.hpp) against boost's templates, which the kernels replace,
+// op by op, with a check that the results are the same bits
+
+#include "bench.hpp"
+#include "complex_type.hpp"
+#include <cstdio>
+#include <string>
+
+namespace {
+
+using backend = calc_val::float_type::backend_type;
+namespace backends = boost::multiprecision::backends;
+
+using binary_op = void (*)(backend& r, const backend& x, const backend& y);
+
+auto compare(const char* op, const backend& a, const backend& b, binary_op kernel, binary_op boost_template) -> bool {
+    auto r = backend(), boost_r = backend();
+    kernel(r, a, b);
+    boost_template(boost_r, a, b);
+    auto same = r.sign() == boost_r.sign() && r.exponent() == boost_r.exponent()
+        && r.bits().compare(boost_r.bits()) == 0;
+    auto boost_seconds = bench::seconds_per_call(200000, [&] {
+        boost_template(boost_r, bench::opaque(a), b);
+        bench::keep(boost_r);
+    });
+    bench::report(std::string("boost ") + op, boost_seconds);
+    bench::report(std::string("kernel ") + op, bench::seconds_per_call(200000, [&] {
+        kernel(r, bench::opaque(a), b);
+        bench::keep(r);
+    }), boost_seconds);
+    return same;
+}
+
+} // namespace
+
+auto main() -> int {
+    auto a = sqrt(calc_val::float_type(2)).backend(); // operands with all 334 bits of the significand
+    auto b = (calc_val::float_type(1) / 3).backend();
+    // explicit template arguments take boost's templates rather than the kernels
+    auto ok = compare("add", a, b, backends::eval_add, backends::eval_add<100u, backends::digit_base_10, void, int, 0, 0>);
+    ok = compare("subtract", a, b, backends::eval_subtract,
+        backends::eval_subtract<100u, backends::digit_base_10, void, int, 0, 0>) && ok;
+    ok = compare("multiply", a, b, backends::eval_multiply,
+        backends::eval_multiply<100u, backends::digit_base_10, void, int, 0, 0>) && ok;
+    ok = compare("divide", a, b, backends::eval_divide,
+        backends::eval_divide<100u, backends::digit_base_10, void, int, 0, 0>) && ok;
+    if (!ok)
+        std::printf("a kernel's result differs from boost's\n");
+    return !ok;
+}
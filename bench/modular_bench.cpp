@@ -0,0 +1,82 @@
+// modular_bench: powmod, mulmod and invmod (montgomery multiplication) against
+// naive __int128 square-and-multiply, for 64 and 128-bit odd moduli
+
+#include "bench.hpp"
+#include "calc_parser.hpp"
+#include "modular.hpp"
+#include <cstdio>
+#include <initializer_list>
+#include <string>
+
+namespace {
+
+using calc_val::max_uint_type;
+
+auto naive_mulmod(max_uint_type x, max_uint_type y, max_uint_type m) -> max_uint_type {
+// the product of words of up to 64 bits fits; wider ones are multiplied by
+// doubling and adding (x, y < m)
+    if (m >> 64 == 0)
+        return x * y % m;
+    auto r = max_uint_type(0);
+    for (; y; y >>= 1) {
+        if (y & 1)
+            r = r >= m - x ? r - (m - x) : r + x;
+        x = x >= m - x ? x - (m - x) : x + x;
+    }
+    return r;
+}
+
+auto naive_powmod(max_uint_type x, max_uint_type e, max_uint_type m) -> max_uint_type {
+    auto r = max_uint_type(1) % m;
+    for (x %= m; e; e >>= 1) {
+        if (e & 1)
+            r = naive_mulmod(r, x, m);
+        x = naive_mulmod(x, x, m);
+    }
+    return r;
+}
+
+auto word(std::uint64_t high, std::uint64_t low) -> max_uint_type
+{return static_cast<max_uint_type>(high) << 64 | low;}
+
+} // namespace
+
+auto main() -> int {
+    struct {
+        const char* what;
+        max_uint_type m;
+        max_uint_type x;
+        max_uint_type y;
+        max_uint_type e;
+    } cases[] = {
+        {"64-bit modulus", 0xffffffffffffffc5, 0x123456789abcdef1, 0x0fedcba987654321, 0xfedcba9876543210},
+        {"128-bit modulus", word(0x7fffffffffffffff, 0xffffffffffffffff), word(0x0123456789abcdef, 0x1),
+            word(0x0fedcba987654321, 0x123456789abcdef), word(~0ull, ~0ull)}};
+    auto failed = false;
+    for (auto& c : cases) {
+        failed = failed || calc_val::powmod(c.x, c.e, c.m) != naive_powmod(c.x, c.e, c.m)
+            || calc_val::mulmod(c.x, c.y, c.m) != naive_mulmod(c.x, c.y, c.m);
+        auto naive_pow = bench::seconds_per_call(2000, [&] {bench::keep(naive_powmod(bench::opaque(c.x), c.e, c.m));});
+        bench::report(std::string("naive powmod, ") + c.what, naive_pow);
+        bench::report(std::string("powmod, ") + c.what,
+            bench::seconds_per_call(2000, [&] {bench::keep(calc_val::powmod(bench::opaque(c.x), c.e, c.m));}), naive_pow);
+        auto naive_mul = bench::seconds_per_call(100000, [&] {bench::keep(naive_mulmod(bench::opaque(c.x), c.y, c.m));});
+        bench::report(std::string("naive mulmod, ") + c.what, naive_mul);
+        bench::report(std::string("mulmod, ") + c.what,
+            bench::seconds_per_call(100000, [&] {bench::keep(calc_val::mulmod(bench::opaque(c.x), c.y, c.m));}), naive_mul);
+        bench::report(std::string("invmod, ") + c.what,
+            bench::seconds_per_call(100000, [&] {bench::keep(calc_val::invmod(bench::opaque(c.x), c.m));}));
+    }
+
+    auto parser = calc_parser();
+    auto out_options = output_options();
+    auto input = "@0du @w128 powmod(1512366075204170928967596825190072321, 340282366920938463463374607431768211455, "
+        "170141183460469231731687303715884105727)";
+    failed = failed || !parser.try_evaluate(input, [] {}, out_options).has_value();
+    bench::report("evaluate powmod, 128-bit modulus", bench::seconds_per_call(2000, [&] {
+        bench::keep(parser.try_evaluate(input, [] {}, out_options));
+    }));
+    if (failed)
+        std::printf("powmod or mulmod differs from the naive one, or the input failed\n");
+    return failed;
+}
@@ -0,0 +1,80 @@
+// primes_bench: isprime of primes and factor of semiprimes of various sizes,
+// and trial division of the smaller ones for comparison
+
+#include "bench.hpp"
+#include "primes.hpp"
+#include <cstdio>
+#include <initializer_list>
+#include <string>
+
+namespace {
+
+using calc_val::max_uint_type;
+
+auto word(std::uint64_t high, std::uint64_t low) -> max_uint_type
+{return static_cast<max_uint_type>(high) << 64 | low;}
+
+auto trial_division(std::uint64_t x) -> std::uint64_t {
+// least prime factor of x > 1
+    if (x % 2 == 0)
+        return 2;
+    for (std::uint64_t d = 3; d <= x / d; d += 2)
+        if (x % d == 0)
+            return d;
+    return x;
+}
+
+} // namespace
+
+auto main() -> int {
+    struct {
+        const char* what;
+        max_uint_type x;
+        max_uint_type least_factor;
+        std::size_t calls;
+    } primes[] = {
+        {"32-bit prime", 4294967291u, 4294967291u, 10000},
+        {"64-bit prime", 18446744073709551557u, 18446744073709551557u, 10000},
+        {"127-bit prime", word(0x7fffffffffffffff, 0xffffffffffffffff),
+            word(0x7fffffffffffffff, 0xffffffffffffffff), 1000},
+        {"128-bit prime", word(0xffffffffffffffff, 0xffffffffffffff61),
+            word(0xffffffffffffffff, 0xffffffffffffff61), 1000},
+        {"carmichael number 3215031751", 3215031751u, 151, 10000},
+    }, semiprimes[] = {
+        {"32-bit semiprime, 16-bit factors", 4292870399u, 65519, 1000},
+        {"48-bit semiprime, 24-bit factors", 281474641166387u, 16777199, 100},
+        {"64-bit semiprime, 32-bit factors", 18446743979220271189u, 4294967279u, 10},
+        {"80-bit semiprime, 40-bit factors", word(0xffff, 0xffff0200000038c1), 1099511627609u, 2},
+    };
+    auto failed = false;
+    for (auto& p : primes) {
+        failed = failed || calc_val::isprime(p.x, 128) != (p.x == p.least_factor);
+        auto trial = 0.0;
+        if (p.x >> 32 == 0) {
+            failed = failed || trial_division(static_cast<std::uint64_t>(p.x)) != p.least_factor;
+            trial = bench::seconds_per_call(p.calls / 100, [&] {
+                bench::keep(trial_division(bench::opaque(static_cast<std::uint64_t>(p.x))));
+            });
+            bench::report(std::string("trial division, ") + p.what, trial);
+        }
+        bench::report(std::string("isprime, ") + p.what, bench::seconds_per_call(p.calls, [&] {
+            bench::keep(calc_val::isprime(bench::opaque(p.x), 128));
+        }), trial);
+    }
+    for (auto& s : semiprimes) {
+        failed = failed || calc_val::factor(s.x, 128) != s.least_factor;
+        auto trial = 0.0;
+        if (s.x >> 48 == 0) {
+            trial = bench::seconds_per_call(s.calls / 10 + 1, [&] {
+                bench::keep(trial_division(bench::opaque(static_cast<std::uint64_t>(s.x))));
+            });
+            bench::report(std::string("trial division, ") + s.what, trial);
+        }
+        bench::report(std::string("factor, ") + s.what, bench::seconds_per_call(s.calls, [&] {
+            bench::keep(calc_val::factor(bench::opaque(s.x), 128));
+        }), trial);
+    }
+    if (failed)
+        std::printf("isprime, factor or trial division gave a wrong value\n");
+    return failed;
+}
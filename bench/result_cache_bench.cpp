@@ -0,0 +1,72 @@
+// result_cache_bench: evaluation of a service's recurring expressions without
+// and with a calc_result_cache, by one thread and by threads sharing the cache
+
+#include "bench.hpp"
+#include "calc_parser.hpp"
+#include "calc_result_cache.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <initializer_list>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+namespace {
+
+constexpr auto corpus = {
+    "2^64-1", "sqrt(2)", "gamma(0.5)", "@pr20 sqrt(2)", "@pr50 gamma(0.5)", "exp(1)*pi", "ln(2)/ln(10)",
+    "@w64 0xffffffffffffffff >> 3", "sin(1)^2 + cos(1)^2", "(1+2i)^10", "atan(1)*4", "1/3 + 1/7"};
+
+auto evaluate_corpus(calc_parser& parser) -> void {
+    auto out_options = output_options();
+    for (std::string_view line : corpus)
+        bench::keep(parser.try_evaluate(line, [] {}, out_options));
+}
+
+auto threads_evaluate(std::size_t thread_count, calc_result_cache* cache) -> double {
+// seconds per line of thread_count threads, each with its own parser
+    auto parsers = std::vector<calc_parser>();
+    for (std::size_t i = 0; i < thread_count; ++i) {
+        parsers.emplace_back();
+        parsers.back().result_cache(cache);
+    }
+    return bench::seconds_per_call(1, [&] {
+        auto threads = std::vector<std::thread>();
+        for (auto& parser : parsers)
+            threads.emplace_back([&parser] {
+                for (auto i = 0; i < 500; ++i)
+                    evaluate_corpus(parser);
+            });
+        for (auto& thread : threads)
+            thread.join();
+    }) / static_cast<double>(500 * corpus.size() * thread_count);
+}
+
+} // namespace
+
+auto main() -> int {
+    auto uncached = calc_parser();
+    auto uncached_seconds = bench::seconds_per_call(200, [&] {evaluate_corpus(uncached);})
+        / static_cast<double>(corpus.size());
+    bench::report("evaluate, per line, no cache", uncached_seconds);
+
+    auto cache = calc_result_cache();
+    auto cached = calc_parser();
+    cached.result_cache(&cache);
+    auto cached_seconds = bench::seconds_per_call(200, [&] {evaluate_corpus(cached);})
+        / static_cast<double>(corpus.size());
+    bench::report("evaluate, per line, cached", cached_seconds, uncached_seconds);
+
+    auto thread_count = std::max(2u, std::thread::hardware_concurrency());
+    auto threads = std::to_string(thread_count) + " threads";
+    auto threads_uncached = threads_evaluate(thread_count, nullptr);
+    bench::report("evaluate, per line, " + threads + ", no cache", threads_uncached);
+    cache.clear();
+    bench::report("evaluate, per line, " + threads + ", shared cache",
+        threads_evaluate(thread_count, &cache), threads_uncached);
+
+    auto stats = cache.stats();
+    std::printf("cache: %.4f hit rate, %zu entries, %zu bytes in use\n", stats.hit_rate(), stats.entries,
+        stats.bytes_in_use);
+}
@@ -0,0 +1,99 @@
+// sincos_bench: the sin, cos and tan kernels, which reduce the argument once
+// for both sin and cos and keep the last few reductions, against boost's
+// templates, which reduce it for each function; and complex exp (cis) and
+// evaluated trig-heavy expressions. the kernels' results are checked to be
+// the same bits as boost's
+
+#include "bench.hpp"
+#include "calc_parser.hpp"
+#include <array>
+#include <cstdio>
+#include <initializer_list>
+#include <string>
+
+namespace {
+
+using float_backend = calc_val::float_type::backend_type;
+using complex_backend = calc_val::complex_type::backend_type;
+namespace backends = boost::multiprecision::backends;
+namespace default_ops = boost::multiprecision::default_ops;
+
+using unary_fn = void (*)(float_backend& r, const float_backend& x);
+
+auto same_bits(const float_backend& x, const float_backend& y) -> bool
+{return x.sign() == y.sign() && x.exponent() == y.exponent() && x.bits().compare(y.bits()) == 0;}
+
+auto arguments() -> std::array<float_backend, 64> {
+// more distinct arguments than the kernels keep reductions of
+    auto args = std::array<float_backend, 64>();
+    for (std::size_t i = 0; i < args.size(); ++i)
+        args[i] = (sqrt(calc_val::float_type(i + 2)) * (i % 2 ? 7 : -3)).backend();
+    return args;
+}
+
+auto compare(const std::string& what, unary_fn kernel, unary_fn kernel2, unary_fn boost_template,
+    unary_fn boost_template2) -> bool
+// kernel2 and boost_template2 (if not null) of the same arguments follow
+{
+    auto args = arguments();
+    auto same = true;
+    auto r = float_backend(), boost_r = float_backend();
+    for (auto& x : args) {
+        kernel(r, x);
+        boost_template(boost_r, x);
+        same = same && same_bits(r, boost_r);
+    }
+    auto time = [&](unary_fn fn, unary_fn fn2) {
+        return bench::seconds_per_call(100, [&] {
+            for (auto& x : args) {
+                fn(r, bench::opaque(x));
+                bench::keep(r);
+                if (fn2) {
+                    fn2(r, x);
+                    bench::keep(r);
+                }
+            }
+        }) / static_cast<double>(args.size());
+    };
+    auto boost_seconds = time(boost_template, boost_template2);
+    bench::report("boost " + what, boost_seconds);
+    bench::report("kernel " + what, time(kernel, kernel2), boost_seconds);
+    return same;
+}
+
+} // namespace
+
+auto main() -> int {
+    // explicit template arguments take boost's templates rather than the kernels
+    auto ok = compare("sin", backends::eval_sin, nullptr, default_ops::eval_sin<float_backend>, nullptr);
+    ok = compare("cos", backends::eval_cos, nullptr, default_ops::eval_cos<float_backend>, nullptr) && ok;
+    ok = compare("tan", backends::eval_tan, nullptr, default_ops::eval_tan<float_backend>, nullptr) && ok;
+    ok = compare("sin and cos of one argument", backends::eval_sin, backends::eval_cos,
+        default_ops::eval_sin<float_backend>, default_ops::eval_cos<float_backend>) && ok;
+
+    auto z = calc_val::complex_type(calc_val::float_type(1) / 3, sqrt(calc_val::float_type(2))).backend();
+    auto r = complex_backend(), boost_r = complex_backend();
+    backends::eval_exp(r, z);
+    backends::eval_exp<float_backend>(boost_r, z);
+    ok = ok && same_bits(r.real_data(), boost_r.real_data()) && same_bits(r.imag_data(), boost_r.imag_data());
+    auto boost_exp = bench::seconds_per_call(10000, [&] {
+        backends::eval_exp<float_backend>(boost_r, bench::opaque(z));
+        bench::keep(boost_r);
+    });
+    bench::report("boost complex exp", boost_exp);
+    bench::report("kernel complex exp", bench::seconds_per_call(10000, [&] {
+        backends::eval_exp(r, bench::opaque(z));
+        bench::keep(r);
+    }), boost_exp);
+
+    auto parser = calc_parser();
+    auto out_options = output_options();
+    parser.evaluate("x=0.75", [] {}, out_options);
+    for (auto input : {"cos(x) + i*sin(x)", "exp(pi*i*x)", "tan(x)", "sin(x)^2 + cos(x)^2"})
+        bench::report(std::string("evaluate ") + input, bench::seconds_per_call(10000, [&] {
+            bench::keep(parser.try_evaluate(input, [] {}, out_options));
+        }));
+    if (!ok)
+        std::printf("a kernel's result differs from boost's\n");
+    return !ok;
+}
@@ -0,0 +1,81 @@
+// snapshot_bench: a session of thousands of 100-digit variables saved and
+// restored as a text script of assignments, evaluated line by line, against
+// a binary snapshot, loaded from a string and mapped from a file
+
+#include "bench.hpp"
+#include "calc_outputter.hpp"
+#include "calc_parser.hpp"
+#include <cstdio>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+constexpr auto variable_count = 5000;
+
+auto text_script(const calc_parser& parser) -> std::vector<std::string> {
+// an assignment of each variable's value at full precision
+    auto out_options = output_options();
+    out_options.precision = std::numeric_limits<calc_val::float_type>::digits10;
+    auto script = std::vector<std::string>();
+    for (auto itr = parser.variables_begin(); itr != parser.variables_end(); ++itr) {
+        auto line = std::ostringstream();
+        line << itr->first << '=' << calc_outputter(out_options)(itr->second);
+        script.push_back(std::move(line).str());
+    }
+    return script;
+}
+
+} // namespace
+
+auto main() -> int {
+    auto parser = calc_parser();
+    auto out_options = output_options();
+    for (auto i = 0; i < variable_count; ++i) {
+        auto n = std::to_string(i + 2);
+        auto assignment = i % 4 == 3
+            ? "v" + n + "=" + n + "*0x1000003"
+            : "v" + n + "=sqrt(" + n + ")" + (i % 4 == 2 ? "+ln(" + n + ")*i" : "");
+        parser.evaluate(assignment, [] {}, out_options);
+    }
+    auto per_variable = [](double seconds) {return seconds / variable_count;};
+
+    auto script = std::vector<std::string>();
+    auto save_script = bench::seconds_per_call(3, [&] {script = text_script(parser);});
+    bench::report("save, per variable, text script", per_variable(save_script));
+    auto snapshot = std::string();
+    auto save_snapshot = bench::seconds_per_call(3, [&] {snapshot = parser.save_snapshot(out_options);});
+    bench::report("save, per variable, snapshot", per_variable(save_snapshot), per_variable(save_script));
+
+    auto load_script = bench::seconds_per_call(3, [&] {
+        auto restored = calc_parser();
+        for (auto& line : script)
+            restored.evaluate(line, [] {}, out_options);
+    });
+    bench::report("restore, per variable, text script", per_variable(load_script));
+    auto load_snapshot = bench::seconds_per_call(3, [&] {
+        auto restored = calc_parser();
+        restored.load_snapshot(snapshot, out_options);
+    });
+    bench::report("restore, per variable, snapshot", per_variable(load_snapshot), per_variable(load_script));
+
+    char path[] = "/tmp/snapshot_bench.XXXXXX";
+    auto fd = ::mkstemp(path);
+    if (fd < 0)
+        return 1;
+    ::close(fd);
+    parser.save_snapshot(path, out_options);
+    auto map_snapshot = bench::seconds_per_call(3, [&] {
+        auto restored = calc_parser();
+        restored.load_snapshot(path, out_options);
+    });
+    bench::report("restore, per variable, snapshot file", per_variable(map_snapshot), per_variable(load_script));
+    ::unlink(path);
+    auto script_size = std::size_t(0);
+    for (auto& line : script)
+        script_size += line.size() + 1;
+    std::printf("text script %zu bytes, snapshot %zu bytes\n", script_size, snapshot.size());
+}
@@ -0,0 +1,51 @@
+// try_evaluate_bench: evaluate, whose errors and void input are exceptions,
+// against try_evaluate, which returns them, on a corpus in which a third of
+// the lines are blank, help, options only or invalid
+
+#include "bench.hpp"
+#include "calc_parser.hpp"
+#include <initializer_list>
+#include <string>
+#include <string_view>
+
+namespace {
+
+constexpr auto corpus = {
+    "", "   ", "1+", "(2*3", "foo*2", "help", "@w64", "delete y", "sqrt(-1",
+    "2*3", "sqrt(2)", "x=5", "x*2+1", "sin(x)^2", "2^64-1", "ln(10)/3", "0x1f & 7", "max(1, 2, x)",
+    "gamma(0.5)", "x/7", "1e100 + 1", "(1+2i)*(3-4i)", "10!", "atan(1)*4", "cos(pi/3)", "x%3", "x^x"};
+
+auto errors_and_voids(std::string_view line) -> bool
+{return line.empty() || line == "   " || line == "1+" || line == "(2*3" || line == "foo*2" || line == "help"
+    || line == "@w64" || line == "delete y" || line == "sqrt(-1";}
+
+} // namespace
+
+auto main() -> int {
+    auto parser = calc_parser();
+    auto out_options = output_options();
+    auto help = [] {};
+    for (auto only_errors : {false, true}) {
+        auto lines = std::size_t(0);
+        for (std::string_view line : corpus)
+            lines += !only_errors || errors_and_voids(line);
+        auto by_exceptions = bench::seconds_per_call(2000, [&] {
+            for (std::string_view line : corpus) {
+                if (only_errors && !errors_and_voids(line))
+                    continue;
+                try {
+                    bench::keep(parser.evaluate(line, help, out_options));
+                } catch (const calc_parse_error&) {
+                } catch (const calc_parser::void_expression&) {}
+            }
+        }) / static_cast<double>(lines);
+        auto by_results = bench::seconds_per_call(2000, [&] {
+            for (std::string_view line : corpus)
+                if (!only_errors || errors_and_voids(line))
+                    bench::keep(parser.try_evaluate(line, help, out_options));
+        }) / static_cast<double>(lines);
+        auto what = only_errors ? std::string_view(", invalid and void lines only") : std::string_view(", all lines");
+        bench::report(std::string("evaluate, per line").append(what), by_exceptions);
+        bench::report(std::string("try_evaluate, per line").append(what), by_results, by_exceptions);
+    }
+}
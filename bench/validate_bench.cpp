@@ -0,0 +1,35 @@
+// validate_bench: validating long input, as a gui does as it's typed, against
+// evaluating it
+
+#include "bench.hpp"
+#include "calc_parser.hpp"
+#include <initializer_list>
+#include <string>
+
+namespace {
+
+auto long_input(std::size_t terms) -> std::string {
+    auto input = std::string("x");
+    for (std::size_t i = 0; i < terms; ++i)
+        input += " + sin(1." + std::to_string(i) + ")*x - sqrt(" + std::to_string(i + 2) + ")/ln(7) + 0x1f*2.5e3";
+    return input;
+}
+
+} // namespace
+
+auto main() -> int {
+    auto parser = calc_parser();
+    auto out_options = output_options();
+    parser.evaluate("x=2", [] {}, out_options);
+    for (auto terms : {4, 40, 400}) {
+        auto input = long_input(terms);
+        auto size = std::to_string(input.size()) + " characters";
+        auto calls = 4000 / terms;
+        auto evaluate = bench::seconds_per_call(calls, [&] {
+            bench::keep(parser.try_evaluate(input, [] {}, out_options));
+        });
+        auto validate = bench::seconds_per_call(calls, [&] {bench::keep(parser.validate(input));});
+        bench::report("evaluate, " + size, evaluate);
+        bench::report("validate, " + size, validate, evaluate);
+    }
+}
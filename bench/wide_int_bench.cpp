@@ -0,0 +1,88 @@
+// wide_int_bench: arithmetic of wide_uint_type trimmed to 256, 512 and 1024
+// bits, as calc_parser trims it, against boost's fixed width cpp_int types,
+// and evaluated 256-bit arithmetic
+
+#include "bench.hpp"
+#include "calc_parser.hpp"
+#include "wide_int.hpp"
+#include <boost/multiprecision/cpp_int.hpp>
+#include <cstdio>
+#include <string>
+
+namespace {
+
+using calc_val::wide_uint_type;
+
+auto random_limb() -> std::uint64_t {
+// splitmix64
+    static auto state = std::uint64_t(0x9e3779b97f4a7c15);
+    auto z = state += 0x9e3779b97f4a7c15;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+    return z ^ (z >> 31);
+}
+
+template <unsigned Bits>
+auto trim(wide_uint_type x) -> wide_uint_type {
+    for (auto i = Bits / 64; i < wide_uint_type::limb_count; ++i)
+        x.limbs[i] = 0;
+    return x;
+}
+
+template <unsigned Bits, typename Boost>
+auto compare(const char* boost_name) -> bool {
+// times the operations of random operands of Bits bits (the divisor of half
+// as many) and returns whether both types gave the same values
+    auto a = wide_uint_type(), b = wide_uint_type(), c = wide_uint_type();
+    auto boost_a = Boost(), boost_b = Boost(), boost_c = Boost();
+    for (auto i = Bits / 64; i--;) {
+        a.limbs[i] = random_limb();
+        b.limbs[i] = random_limb();
+        boost_a = boost_a << 64 | a.limbs[i];
+        boost_b = boost_b << 64 | b.limbs[i];
+        if (i < Bits / 128) {
+            c.limbs[i] = random_limb();
+            boost_c = boost_c << 64 | c.limbs[i];
+        }
+    }
+    auto same = [](const wide_uint_type& x, const Boost& y) {
+        for (auto i = 0u; i < Bits / 64; ++i)
+            if (x.limbs[i] != static_cast<std::uint64_t>(y >> (64 * i) & ~std::uint64_t(0)))
+                return false;
+        return true;
+    };
+    auto ok = same(trim<Bits>(a + b), boost_a + boost_b) && same(trim<Bits>(a * b), boost_a * boost_b)
+        && same(trim<Bits>(a / c), boost_a / boost_c) && same(trim<Bits>(a << 37), boost_a << 37);
+
+    auto bits = std::to_string(Bits) + " bits";
+    auto time = [&](const char* op, auto wide_op, auto boost_op) {
+        auto boost_seconds = bench::seconds_per_call(100000, [&] {bench::keep(boost_op(bench::opaque(boost_a)));});
+        bench::report(std::string(boost_name) + " " + op + ", " + bits, boost_seconds);
+        bench::report(std::string("wide_uint_type ") + op + ", " + bits, bench::seconds_per_call(100000, [&] {
+            bench::keep(trim<Bits>(wide_op(bench::opaque(a))));
+        }), boost_seconds);
+    };
+    time("+", [&](const wide_uint_type& x) {return x + b;}, [&](const Boost& x) -> Boost {return x + boost_b;});
+    time("*", [&](const wide_uint_type& x) {return x * b;}, [&](const Boost& x) -> Boost {return x * boost_b;});
+    time("/", [&](const wide_uint_type& x) {return x / c;}, [&](const Boost& x) -> Boost {return x / boost_c;});
+    time("<<", [&](const wide_uint_type& x) {return x << 37;}, [&](const Boost& x) -> Boost {return x << 37;});
+    return ok;
+}
+
+} // namespace
+
+auto main() -> int {
+    auto ok = compare<256, boost::multiprecision::uint256_t>("uint256_t")
+        && compare<512, boost::multiprecision::uint512_t>("uint512_t")
+        && compare<1024, boost::multiprecision::uint1024_t>("uint1024_t");
+
+    auto parser = calc_parser();
+    auto out_options = output_options();
+    parser.evaluate("@0du @w256 x=2**200+12345", [] {}, out_options);
+    bench::report("evaluate x*x/3 + (x << 17) ^ x, 256 bits", bench::seconds_per_call(10000, [&] {
+        bench::keep(parser.try_evaluate("x*x/3 + (x << 17) ^ x", [] {}, out_options));
+    }));
+    if (!ok)
+        std::printf("wide_uint_type differs from boost's type\n");
+    return !ok;
+}
@@ -58,6 +58,21 @@ static bool single_flag_option(const_string_itr arg_itr, calc_args& args) {
         ++args.n_int_word_size_options;
         return true;
     }
+    if (arg_view == "w256") {
+        args.int_word_size = calc_val::int_bits_256;
+        ++args.n_int_word_size_options;
+        return true;
+    }
+    if (arg_view == "w512") {
+        args.int_word_size = calc_val::int_bits_512;
+        ++args.n_int_word_size_options;
+        return true;
+    }
+    if (arg_view == "w1024") {
+        args.int_word_size = calc_val::int_bits_1024;
+        ++args.n_int_word_size_options;
+        return true;
+    }
 
     if (arg_view == "pn") {
         args.output_fp_normalized = true;
@@ -0,0 +1,29 @@
+#include "calc_cancellation.hpp"
+
+namespace {
+
+thread_local const calc_cancellation* active_cancellation = nullptr;
+
+} // namespace
+
+auto calc_cancellation::state() const noexcept -> states {
+    if (cancelled.load(std::memory_order_relaxed))
+        return cancel_requested;
+    if (deadline != clock::time_point::max() && clock::now() >= deadline)
+        return deadline_passed;
+    return not_requested;
+}
+
+calc_cancellation::scope::scope(const calc_cancellation* cancellation) noexcept
+    : previous{active_cancellation}
+{
+    active_cancellation = cancellation;
+}
+
+calc_cancellation::scope::~scope() {
+    active_cancellation = previous;
+}
+
+auto calc_cancellation::current_state() noexcept -> states {
+    return active_cancellation ? active_cancellation->state() : not_requested;
+}
@@ -0,0 +1,58 @@
+#ifndef CALC_CANCELLATION_HPP
+#define CALC_CANCELLATION_HPP
+
+#include <atomic>
+#include <chrono>
+
+class calc_cancellation {
+// request to stop an evaluation, made by calling cancel() (from any thread) or
+// by a deadline passing. calc_parser checks it after each operation, and long
+// loops of the math functions (e.g., the square-and-multiply loop of integer
+// powers) check it at each iteration, so an evaluation stops soon after the
+// request. a single call of a multiprecision library function (e.g., tgamma)
+// is not interrupted
+public:
+    using clock = std::chrono::steady_clock;
+
+    calc_cancellation() noexcept = default;
+    explicit calc_cancellation(clock::time_point deadline_) noexcept : deadline{deadline_} {}
+    explicit calc_cancellation(clock::duration timeout) noexcept : deadline{clock::now() + timeout} {}
+
+    calc_cancellation(const calc_cancellation&) = delete;
+    auto operator=(const calc_cancellation&) -> calc_cancellation& = delete;
+
+    auto cancel() noexcept -> void {cancelled.store(true, std::memory_order_relaxed);}
+
+    enum states {not_requested, cancel_requested, deadline_passed};
+    auto state() const noexcept -> states;
+
+    class scope {
+    // makes a cancellation (or none, if nullptr) the one checked on the
+    // current thread for the scope's lifetime
+    public:
+        explicit scope(const calc_cancellation* cancellation) noexcept;
+        ~scope();
+        scope(const scope&) = delete;
+        auto operator=(const scope&) -> scope& = delete;
+    private:
+        const calc_cancellation* previous;
+    };
+
+    static auto current_state() noexcept -> states;
+    // state of the cancellation in scope on the current thread
+
+private:
+    std::atomic<bool> cancelled = false;
+    clock::time_point deadline = clock::time_point::max();
+};
+
+namespace calc_val {
+
+inline auto cancellation_requested() noexcept -> bool
+{return calc_cancellation::current_state() != calc_cancellation::not_requested;}
+// for long loops of the math functions, which return a meaningless value when
+// this is true (the evaluation then fails as cancelled)
+
+} // namespace calc_val
+
+#endif // CALC_CANCELLATION_HPP
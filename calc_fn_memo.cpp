@@ -0,0 +1,45 @@
+#include "calc_fn_memo.hpp"
+#include <cstring>
+#include <type_traits>
+
+auto calc_fn_memo::enable(fn_id id, bool enabled) -> void {
+    if (enabled)
+        enabled_fns.fetch_or(std::uint64_t(1) << id, std::memory_order_relaxed);
+    else
+        enabled_fns.fetch_and(~(std::uint64_t(1) << id), std::memory_order_relaxed);
+}
+
+template <typename T>
+static auto append_bytes(calc_fn_memo::key_type& key, const T& x) -> void {
+    static_assert(std::is_trivially_copyable_v<T>);
+    char bytes[sizeof(T)];
+    std::memcpy(bytes, &x, sizeof(T));
+    key.append(bytes, sizeof(T));
+}
+
+static auto append_float(calc_fn_memo::key_type& key, const calc_val::float_type::backend_type& x) -> void {
+// the sign, exponent and significand; the significand of 0, inf and nan (which
+// have exponents of their own) is 0
+    append_bytes(key, x.sign());
+    append_bytes(key, x.exponent());
+    auto& bits = x.bits();
+    key.append(reinterpret_cast<const char*>(bits.limbs()), bits.size() * sizeof(*bits.limbs()));
+}
+
+auto calc_fn_memo::key(fn_id id, const calc_val::variant_type& arg) const -> std::optional<key_type> {
+    if (!enabled(id))
+        return std::nullopt;
+    auto key = key_type();
+    key.push_back(static_cast<char>(id));
+    key.push_back(static_cast<char>(arg.index()));
+    std::visit([&](const auto& x) {
+        if constexpr (calc_val::is_complex_type<decltype(x)>()) {
+            append_float(key, x.backend().real_data());
+            append_float(key, x.backend().imag_data());
+        } else if constexpr (calc_val::is_wide_int_type<decltype(x)>())
+            append_bytes(key, x.limbs);
+        else
+            append_bytes(key, x);
+    }, arg);
+    return key;
+}
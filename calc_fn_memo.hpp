@@ -0,0 +1,59 @@
+#ifndef CALC_FN_MEMO_HPP
+#define CALC_FN_MEMO_HPP
+
+#include "calc_result_cache.hpp"
+#include "variant_type.hpp"
+#include <atomic>
+#include <cstdint>
+#include <optional>
+
+class calc_fn_memo {
+// memo of the values of the built-in functions of one argument (gamma, lgamma,
+// exp, asinh, ... and the factorial operators "!" and "!!"), shared by any
+// number of calc_parsers, which may be used concurrently on different threads.
+// entries are keyed by the function and the exact bits of the argument (so 0
+// and -0 are different arguments), which is all a built-in function's value
+// depends on; integer functions of int and uint arguments, whose values depend
+// on the word size, are not memoized.
+// the entries are held in a calc_result_cache, whose memory cap, least
+// recently used eviction and statistics are the memo's. each function can be
+// enabled or disabled; all are enabled at first
+public:
+    static constexpr std::size_t default_memory_cap = 1024 * 1024;
+
+    explicit calc_fn_memo(std::size_t memory_cap = default_memory_cap,
+        std::size_t shard_count = calc_result_cache::default_shard_count)
+    : values{memory_cap, shard_count}
+    {}
+    // memory_cap: approximate limit in bytes of the memory held by the
+    // entries (keys, values and bookkeeping)
+
+    calc_fn_memo(const calc_fn_memo&) = delete;
+    auto operator=(const calc_fn_memo&) -> calc_fn_memo& = delete;
+
+    using fn_id = unsigned;
+    static constexpr fn_id max_fn_count = 64;
+    // ids are given by calc_parser::fn_memo_id and are < max_fn_count
+
+    auto enable(fn_id id, bool enabled = true) -> void;
+    auto enabled(fn_id id) const -> bool
+    {return enabled_fns.load(std::memory_order_relaxed) >> id & 1;}
+    // disabling a function leaves its entries in place, to be evicted in time
+
+    using key_type = calc_result_cache::key_type;
+
+    auto key(fn_id id, const calc_val::variant_type& arg) const -> std::optional<key_type>;
+    // nullopt if the function is disabled
+    auto find(const key_type& key) -> std::optional<calc_val::variant_type> {return values.find(key);}
+    auto insert(const key_type& key, const calc_val::variant_type& value) -> void {values.insert(key, value);}
+    auto clear() -> void {values.clear();}
+
+    using statistics = calc_result_cache::statistics;
+    auto stats() const -> statistics {return values.stats();}
+
+private:
+    calc_result_cache values;
+    std::atomic<std::uint64_t> enabled_fns = ~std::uint64_t(0);
+};
+
+#endif // CALC_FN_MEMO_HPP
@@ -1,9 +1,9 @@
 #include "calc_lexer.hpp"
 #include "calc_args.hpp"
+#include "char_class.hpp"
 
 auto calc_lexer::get_token() -> lexer_token {
-    while (in_itr && std::isspace(*in_itr)) // eat whitespace
-        ++in_itr;
+    in_itr += calc_val::skip_space(in_itr.ptr(), in_itr.end()) - in_itr.ptr(); // eat whitespace
 
     if (in_itr.at_end()) {
         auto token_offset = static_cast<lexer_token::offset_type>(in_itr - in_begin);
@@ -46,6 +46,10 @@ auto calc_lexer::get_token() -> lexer_token {
             ++in_itr;
             token_id = lexer_token::rparen;
             break;
+        case ',':
+            ++in_itr;
+            token_id = lexer_token::comma;
+            break;
         case '!':
             do ++in_itr;
                 while (in_itr && *in_itr == '!');
@@ -95,14 +99,14 @@ auto calc_lexer::get_token() -> lexer_token {
         case expression_option_code:
             do ++in_itr;
                 while (in_itr && *in_itr == expression_option_code);
-            while (in_itr && std::isalnum(*in_itr))
+            while (in_itr && calc_val::is_alnum(*in_itr))
                 ++in_itr;
             token_id = lexer_token::option;
             break;
         default:
-            if (std::isalpha(*in_itr) || *in_itr == '_') {
-                do ++in_itr;
-                    while (in_itr && (std::isalnum(*in_itr) || *in_itr == '_'));
+            if (calc_val::is_alpha(*in_itr) || *in_itr == '_') {
+                ++in_itr;
+                in_itr += calc_val::skip_identifier_chars(in_itr.ptr(), in_itr.end()) - in_itr.ptr();
                 auto id = std::string_view(token_begin.ptr(), in_itr - token_begin);
                 if (id == "help")
                     token_id = lexer_token::help;
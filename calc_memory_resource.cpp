@@ -0,0 +1,18 @@
+#include "calc_memory_resource.hpp"
+#include <algorithm>
+#include <new>
+
+auto calc_memory_resource::do_allocate(std::size_t bytes, std::size_t alignment) -> void* {
+    if (usage_.limit && bytes > usage_.limit - std::min(usage_.limit, usage_.bytes_in_use))
+        throw std::bad_alloc();
+    auto p = upstream_->allocate(bytes, alignment);
+    usage_.bytes_in_use += bytes;
+    if (usage_.bytes_in_use > usage_.peak_bytes)
+        usage_.peak_bytes = usage_.bytes_in_use;
+    return p;
+}
+
+auto calc_memory_resource::do_deallocate(void* p, std::size_t bytes, std::size_t alignment) -> void {
+    upstream_->deallocate(p, bytes, alignment);
+    usage_.bytes_in_use -= bytes;
+}
@@ -0,0 +1,46 @@
+#ifndef CALC_MEMORY_RESOURCE_HPP
+#define CALC_MEMORY_RESOURCE_HPP
+
+#include <memory_resource>
+#include <cstddef>
+
+class calc_memory_resource : public std::pmr::memory_resource {
+// memory resource that forwards to an upstream resource while keeping count of
+// the bytes currently allocated through it, and that optionally refuses to
+// allocate beyond a limit (std::bad_alloc is thrown in that case, as the
+// standard resources do). used by calc_parser as the upstream of its session
+// pool so a session's memory is bounded and can be reported
+public:
+    explicit calc_memory_resource(
+        std::pmr::memory_resource* upstream = std::pmr::get_default_resource()) noexcept
+        : upstream_{upstream} {}
+
+    calc_memory_resource(const calc_memory_resource&) = delete;
+    auto operator=(const calc_memory_resource&) -> calc_memory_resource& = delete;
+
+    struct usage {
+        std::size_t bytes_in_use = 0;
+        std::size_t peak_bytes = 0;
+        std::size_t limit = 0; // 0 means no limit
+    };
+
+    auto memory_usage() const noexcept -> usage {return usage_;}
+
+    auto limit() const noexcept -> std::size_t {return usage_.limit;}
+    auto limit(std::size_t limit) noexcept -> void {usage_.limit = limit;}
+    // the limit does not release memory already allocated; it only causes
+    // subsequent allocations that would exceed it to fail
+
+    auto upstream_resource() const noexcept -> std::pmr::memory_resource* {return upstream_;}
+
+private:
+    std::pmr::memory_resource* upstream_;
+    usage usage_;
+
+    auto do_allocate(std::size_t bytes, std::size_t alignment) -> void* override;
+    auto do_deallocate(void* p, std::size_t bytes, std::size_t alignment) -> void override;
+    auto do_is_equal(const std::pmr::memory_resource& other) const noexcept -> bool override
+    {return this == &other;}
+};
+
+#endif // CALC_MEMORY_RESOURCE_HPP
@@ -43,7 +43,11 @@ auto calc_outputter::output_dec(std::ostream& out) const -> std::ostream& {
                 }
                 return val;
             }());
-        else {
+        else if constexpr (calc_val::is_wide_int_type<VT>()) {
+            if (val.is_negative())
+                out << '-';
+            output_dec_uint(out, val.magnitude());
+        } else {
             static_assert(std::is_same_v<calc_val::complex_type, VT>);
             if (val.real() != 0 || val.imag() == 0)
                 out << val.real();
@@ -74,6 +78,27 @@ auto calc_outputter::output_dec_uint(std::ostream& out, calc_val::max_uint_type
     return out;
 }
 
+auto calc_outputter::output_dec_uint(std::ostream& out, calc_val::wide_uint_type val) const -> std::ostream& {
+// in chunks of 19 digits, the most that fit in a limb, so there is one long
+// division of the limbs per chunk
+    constexpr auto chunk_digits = 19;
+    constexpr auto chunk_divisor = std::uint64_t(10'000'000'000'000'000'000u);
+    std::vector<std::uint64_t> reversed;
+    reversed.reserve(calc_val::wide_uint_type::bits / 63 + 1);
+    do
+        reversed.emplace_back(val.div_limb(chunk_divisor));
+    while (val != 0);
+    output_dec_uint(out, reversed.back());
+    for (auto itr = reversed.rbegin() + 1; itr != reversed.rend(); ++itr) {
+        auto chunk = *itr;
+        std::array<char, chunk_digits> chunk_chars;
+        for (auto i = chunk_digits; i-- > 0; chunk /= 10)
+            chunk_chars[i] = digits.at(chunk % 10);
+        out.write(chunk_chars.data(), chunk_digits);
+    }
+    return out;
+}
+
 auto calc_outputter::output_radix_pow2(std::ostream& out) const -> std::ostream& {
     return std::visit([&](const auto& val) -> std::ostream& {
         using VT = std::decay_t<decltype(val)>;
@@ -87,7 +112,11 @@ auto calc_outputter::output_radix_pow2(std::ostream& out) const -> std::ostream&
             }());
         } else if constexpr (std::is_integral_v<VT>)
             output_radix_pow2_uint(out, val);
-        else {
+        else if constexpr (calc_val::is_wide_int_type<VT>()) {
+            if (val.is_negative())
+                out << '-';
+            output_radix_pow2_uint(out, val.magnitude());
+        } else {
             static_assert(std::is_same_v<calc_val::complex_type, VT>);
             if (val.real() != 0 || val.imag() == 0)
                 output_radix_pow2_float(out, val.real());
@@ -105,7 +134,8 @@ auto calc_outputter::output_radix_pow2(std::ostream& out) const -> std::ostream&
     }, val);
 }
 
-auto calc_outputter::output_radix_pow2_uint(std::ostream& out, calc_val::max_uint_type val) const -> std::ostream& {
+template <typename T>
+auto calc_outputter::output_radix_pow2_uint(std::ostream& out, T val) const -> std::ostream& {
     unsigned delimit_at;
     decltype(val) digit_mask;
     size_t digit_n_bits;
@@ -125,12 +155,12 @@ auto calc_outputter::output_radix_pow2_uint(std::ostream& out, calc_val::max_uin
     }
 
     std::vector<char> reversed;
-    reversed.reserve(std::numeric_limits<std::decay_t<decltype(val)>>::digits / digit_n_bits + 1);
+    reversed.reserve(sizeof(val) * 8 / digit_n_bits + 1);
 
     do {
-        reversed.emplace_back(digits.at(val & digit_mask));
-        val >>= digit_n_bits;
-    } while (val);
+        reversed.emplace_back(digits.at(static_cast<unsigned>(val & digit_mask)));
+        val = val >> digit_n_bits;
+    } while (val != 0);
 
     unsigned digit_count = reversed.size();
     for (auto itr = reversed.rbegin(); itr != reversed.rend(); ++itr) {
@@ -26,8 +26,11 @@ private:
 
     auto output_dec(std::ostream& out) const -> std::ostream&;
     auto output_dec_uint(std::ostream& out, calc_val::max_uint_type val) const -> std::ostream&;
+    auto output_dec_uint(std::ostream& out, calc_val::wide_uint_type val) const -> std::ostream&;
     auto output_radix_pow2(std::ostream& out) const -> std::ostream&;
-    auto output_radix_pow2_uint(std::ostream& out, calc_val::max_uint_type val) const -> std::ostream&;
+    template <typename T>
+    auto output_radix_pow2_uint(std::ostream& out, T val) const -> std::ostream&;
+    // T is max_uint_type or wide_uint_type
     auto output_radix_pow2_float(std::ostream& out, const calc_val::float_type& val) const -> std::ostream&;
 
     static constexpr auto digits = std::array{
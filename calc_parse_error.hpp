@@ -18,7 +18,9 @@ public:
         op_domain_positive_real_only,
         op_domain_real_only,
         variable_identifier_expected, cant_delete_internal,
-        help_invalid_here, internal_error};
+        help_invalid_here, formula_cycle, variable_used_by_formula,
+        assignment_in_formula, evaluation_cancelled, deadline_exceeded,
+        wide_int_fn_unsupported, out_of_memory, internal_error};
     static constexpr auto error_txt = std::array {
         // elements correspond with error_codes enums so enum can be used as index
         "no_error", "syntax error", "number expected", "undefined identifier",
@@ -32,12 +34,17 @@ public:
         "operation is limited to number with positive real part only",
         "operation is limited to number with real part only",
         "variable identifier expected", "can't delete internal value",
-        "help is invalid here", "internal error"};
+        "help is invalid here", "formula would depend on itself",
+        "variable is used by a formula", "assignment is invalid in a formula",
+        "evaluation cancelled", "evaluation deadline exceeded",
+        "function is unsupported for word sizes above 128 bits",
+        "memory limit exceeded", "internal error"};
 
     calc_parse_error(error_codes error, const lexer_token& token_,
         lexer_token::token_ids expected_token_id_ = lexer_token::unspecified);
 
     auto error_str() const -> std::string;
+    auto error() const -> error_codes {return error_;}
     auto token() const -> const lexer_token& {return token_;}
 
 private:
@@ -1,33 +1,74 @@
 #include "calc_parser.hpp"
 #include "calc_parse_error.hpp"
+#include "int_functions.hpp"
+#include "modular.hpp"
+#include "primes.hpp"
+#include "real_functions.hpp"
+#include "reductions.hpp"
 #include <algorithm>
+#include <array>
 #include <cmath>
+#include <new>
+#include <numeric>
+#include <optional>
+#include <set>
+#include <unordered_map>
 
 calc_parser::identifier_with_unary_fn calc_parser::unary_fn_table[] = {
-    {"exp", boost::multiprecision::exp}, // exp(n) is e raised to the power of n
-    {"ln", boost::multiprecision::log}, // natural (base e) log
-    {"log10", boost::multiprecision::log10}, // base 10 log
-    {"log2", calc_val::log2}, // base 2 log
-    {"sqrt", boost::multiprecision::sqrt},
-    {"cbrt", calc_val::cbrt}, // cubic root
-    {"sin", boost::multiprecision::sin},
-    {"cos", boost::multiprecision::cos},
-    {"tan", boost::multiprecision::tan},
-    {"asin", boost::multiprecision::asin}, // arc sin
-    {"acos", boost::multiprecision::acos}, // arc cos
-    {"atan", boost::multiprecision::atan}, // arc tan
-    {"sinh", boost::multiprecision::sinh}, // hyperbolic sin
-    {"cosh", boost::multiprecision::cosh}, // hyperbolic cos
-    {"tanh", boost::multiprecision::tanh}, // hyperbolic tan
-    {"asinh", boost::multiprecision::asinh}, // inverse hyperbolic sin
-    {"acosh", boost::multiprecision::acosh}, // inverse hyperbolic cos
-    {"atanh", boost::multiprecision::atanh}, // inverse hyperbolic tan
-    {"gamma", calc_val::tgamma},
-    {"lgamma", calc_val::lgamma}, // log gamma
-    {"arg", calc_val::arg_wrapper}, // phase angle
-    {"norm", calc_val::norm_wrapper}, // squared magnitude
-    {"conj", boost::multiprecision::conj}, // conjugate
-    {"proj", boost::multiprecision::proj}, // projection onto the Riemann sphere
+    {"exp", boost::multiprecision::exp, any_domain, calc_val::real::exp}, // exp(n) is e raised to the power of n
+    {"ln", boost::multiprecision::log, any_domain, calc_val::real::log, positive_real_domain}, // natural (base e) log
+    {"log10", boost::multiprecision::log10, any_domain, calc_val::real::log10, positive_real_domain}, // base 10 log
+    {"log2", calc_val::log2, any_domain, calc_val::real::log2, positive_real_domain}, // base 2 log
+    {"sqrt", boost::multiprecision::sqrt, any_domain, calc_val::real::sqrt, positive_real_domain},
+    {"cbrt", calc_val::cbrt, any_domain, calc_val::real::cbrt, positive_real_domain}, // cubic root
+    {"sin", boost::multiprecision::sin, any_domain, calc_val::real::sin},
+    {"cos", boost::multiprecision::cos, any_domain, calc_val::real::cos},
+    {"tan", boost::multiprecision::tan, any_domain, calc_val::real::tan},
+    {"asin", boost::multiprecision::asin, any_domain}, // arc sin
+    {"acos", boost::multiprecision::acos, any_domain}, // arc cos
+    {"atan", boost::multiprecision::atan, any_domain, calc_val::real::atan}, // arc tan
+    {"sinh", boost::multiprecision::sinh, any_domain, calc_val::real::sinh}, // hyperbolic sin
+    {"cosh", boost::multiprecision::cosh, any_domain, calc_val::real::cosh}, // hyperbolic cos
+    {"tanh", boost::multiprecision::tanh, any_domain, calc_val::real::tanh}, // hyperbolic tan
+    {"asinh", boost::multiprecision::asinh, any_domain, calc_val::real::asinh}, // inverse hyperbolic sin
+    {"acosh", boost::multiprecision::acosh, any_domain}, // inverse hyperbolic cos
+    {"atanh", boost::multiprecision::atanh, any_domain}, // inverse hyperbolic tan
+    {"gamma", calc_val::tgamma, real_domain},
+    {"lgamma", calc_val::lgamma, positive_real_domain}, // log gamma
+    {"arg", calc_val::arg_wrapper, any_domain}, // phase angle
+    {"norm", calc_val::norm_wrapper, any_domain}, // squared magnitude
+    {"conj", boost::multiprecision::conj, any_domain, nullptr, any_domain, calc_val::int_identity}, // conjugate
+    {"proj", boost::multiprecision::proj, any_domain}, // projection onto the Riemann sphere
+    {"isqrt", nullptr, positive_real_domain, nullptr, any_domain, calc_val::isqrt}, // integer square root
+    {"popcount", nullptr, any_domain, nullptr, any_domain, calc_val::popcount}, // number of 1 bits
+    {"clz", nullptr, any_domain, nullptr, any_domain, calc_val::clz}, // count leading 0 bits
+    {"ctz", nullptr, any_domain, nullptr, any_domain, calc_val::ctz}, // count trailing 0 bits
+    {"bitrev", nullptr, any_domain, nullptr, any_domain, calc_val::bitrev}, // bits reversed
+    {"bswap", nullptr, any_domain, nullptr, any_domain, calc_val::bswap}, // bytes reversed
+    {"isprime", nullptr, positive_real_domain, nullptr, any_domain, calc_val::isprime}, // 1 if prime, else 0
+    {"factor", nullptr, positive_real_domain, nullptr, any_domain, calc_val::factor}, // least prime factor
+};
+
+const calc_fn_memo::fn_id calc_parser::fac_memo_id = static_cast<calc_fn_memo::fn_id>(std::size(unary_fn_table));
+const calc_fn_memo::fn_id calc_parser::dfac_memo_id = fac_memo_id + 1;
+
+constexpr auto any_number = std::numeric_limits<std::size_t>::max();
+
+calc_parser::identifier_with_multi_fn calc_parser::multi_fn_table[] = {
+    {"min", min_fn, 1, any_number},
+    {"max", max_fn, 1, any_number},
+    {"sum", sum_fn, 1, any_number},
+    {"prod", prod_fn, 1, any_number}, // product
+    {"mean", mean_fn, 1, any_number}, // arithmetic mean
+    {"gcd", gcd_fn, 1, any_number}, // greatest common divisor
+    {"lcm", lcm_fn, 1, any_number}, // least common multiple
+    {"hypot", hypot_fn, 1, any_number}, // sqrt of the sum of the squared magnitudes
+    {"atan2", atan2_fn, 2, 2}, // atan2(y, x) is the angle of the point (x, y)
+    {"rotl", rotl_fn, 2, 2}, // rotl(x, n) is x rotated left by n bits
+    {"rotr", rotr_fn, 2, 2}, // rotr(x, n) is x rotated right by n bits
+    {"powmod", powmod_fn, 3, 3}, // powmod(x, e, m) is x^e mod m, without overflow
+    {"mulmod", mulmod_fn, 3, 3}, // mulmod(x, y, m) is x * y mod m, without overflow
+    {"invmod", invmod_fn, 2, 2}, // invmod(x, m) is y such that x * y mod m is 1
 };
 
 
@@ -46,31 +87,113 @@ inline auto calc_parser::trim_if_int(const calc_val::float_type& x) const -> cal
 
 inline auto calc_parser::trim_if_int(const calc_val::uint_type& x) const -> calc_val::uint_type {
     static_assert(sizeof(std::int8_t) == 1);
-    assert(sizeof(x) * 8 >= int_word_size);
-    unsigned shift = sizeof(x) * 8 - int_word_size;
+    unsigned shift = sizeof(x) * 8 - std::min<unsigned>(int_word_size, sizeof(x) * 8); // 0 for the wide word sizes
     return x & (~calc_val::uint_type(0) >> shift);
 }
 
 inline auto calc_parser::trim_if_int(const calc_val::int_type& x) const -> calc_val::int_type  {
     static_assert(sizeof(std::int8_t) == 1);
-    assert(sizeof(x) * 8 >= int_word_size);
-    unsigned shift = sizeof(x) * 8 - int_word_size;
+    unsigned shift = sizeof(x) * 8 - std::min<unsigned>(int_word_size, sizeof(x) * 8); // 0 for the wide word sizes
     return (x << shift) >> shift; // preserves sign bits for negative number
 }
 
+auto calc_parser::trim_if_int(const calc_val::wide_uint_type& x) const -> calc_val::wide_uint_type {
+// the wide word sizes are whole limbs
+    auto r = x;
+    for (unsigned i = int_word_size / 64; i < r.limb_count; ++i)
+        r.limbs[i] = 0;
+    return r;
+}
+
+auto calc_parser::trim_if_int(const calc_val::wide_int_type& x) const -> calc_val::wide_int_type {
+    auto r = x;
+    unsigned top = int_word_size / 64;
+    auto fill = top && r.limbs[top - 1] >> 63 ? ~std::uint64_t(0) : 0;
+    for (auto i = top; i < r.limb_count; ++i)
+        r.limbs[i] = fill;
+    return r;
+}
+
 inline auto calc_parser::trim_int(calc_val::variant_type& val) const -> void {
+// also converts an integer to the wide or narrow type of the same signedness
+// that the word size calls for
     std::visit([&](const auto& x) {
-        if constexpr (calc_val::is_int_type<decltype(x)>())
-            val = trim_if_int(x);
+        using VT = std::decay_t<decltype(x)>;
+        constexpr auto is_signed = calc_val::is_signed_int_type<VT>();
+        using narrow_type = std::conditional_t<is_signed, calc_val::int_type, calc_val::uint_type>;
+        using wide_type = std::conditional_t<is_signed, calc_val::wide_int_type, calc_val::wide_uint_type>;
+        if constexpr (calc_val::is_wide_int_type<VT>()) {
+            if (int_word_size > calc_val::int_bits_128)
+                val = trim_if_int(x);
+            else
+                val = trim_if_int(static_cast<narrow_type>(x));
+        } else if constexpr (calc_val::is_int_type<VT>()) {
+            if (int_word_size > calc_val::int_bits_128)
+                val = trim_if_int(wide_type(x));
+            else
+                val = trim_if_int(x);
+        }
     }, val);
 }
 
+static auto promote_operands(calc_val::variant_type& lval, calc_val::variant_type& rval) -> void {
+// a wide integer operand becomes complex if the other is complex, and a
+// narrow integer becomes wide if the other is wide (as it would after
+// trim_int), so that visit_operands has pairs of the same kind
+    auto is_wide = [](const calc_val::variant_type& x) {return x.index() >= 3;};
+    if (!is_wide(lval) && !is_wide(rval))
+        return;
+    auto promote = [](calc_val::variant_type& x, bool to_complex) {
+        std::visit([&](const auto& sub_val) {
+            using VT = std::decay_t<decltype(sub_val)>;
+            if constexpr (calc_val::is_wide_int_type<VT>()) {
+                if (to_complex)
+                    x = calc_val::complex_type(calc_val::float_type(sub_val));
+            } else if constexpr (calc_val::is_int_type<VT>()) {
+                if (!to_complex)
+                    x = std::conditional_t<calc_val::is_signed_int_type<VT>(),
+                        calc_val::wide_int_type, calc_val::wide_uint_type>(sub_val);
+            }
+        }, x);
+    };
+    auto is_complex = [](const calc_val::variant_type& x) {return std::holds_alternative<calc_val::complex_type>(x);};
+    promote(lval, is_complex(rval));
+    promote(rval, is_complex(lval));
+}
+
+template <typename Fn>
+static auto visit_operands(Fn fn, const calc_val::variant_type& lval, const calc_val::variant_type& rval)
+    -> calc_val::variant_type
+{
+// std::visit(fn, lval, rval) for operands that promote_operands has paired
+// up, so fn isn't instantiated for a wide integer with another type
+    return std::visit([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
+        if constexpr (calc_val::is_wide_int_type<decltype(lval)>() == calc_val::is_wide_int_type<decltype(rval)>())
+            return fn(lval, rval);
+        else {
+            assert(false); // not reached
+            return {};
+        }
+    }, lval, rval);
+}
+
 
 
-static auto try_to_make_int_if_complex(calc_val::variant_type& val) -> void {
+auto calc_parser::try_to_make_int_if_complex(calc_val::variant_type& val) const -> void {
+// a whole real number becomes an int: a wide int if the word size is wide,
+// so that it meets integers of its own kind
     std::visit([&](const auto& sub_val) {
         if constexpr (calc_val::is_complex_type<decltype(sub_val)>()) {
             if (sub_val.imag() == 0) {
+                if (int_word_size > calc_val::int_bits_128) {
+                    auto real = sub_val.real();
+                    if (isfinite(real) && trunc(real) == real) {
+                        auto i = calc_val::wide_int_type::from_float(real);
+                        if (calc_val::float_type(i) == real) // real fits in wide int
+                            val = i; // side effect: assume sub_val becomes invalid
+                    }
+                    return;
+                }
                 auto i = static_cast<calc_val::int_type>(sub_val.real());
                 if (i == sub_val.real()) // sub_val is a whole number that fits in int
                     val = i; // side effect: assume sub_val becomes invalid
@@ -81,30 +204,68 @@ static auto try_to_make_int_if_complex(calc_val::variant_type& val) -> void {
 
 
 
-inline auto calc_parser::finish_construction() -> void {
-    tmp_key.reserve(32);
+auto calc_parser::in_domain(domains domain, const calc_val::variant_type& val) -> bool {
+    if (domain == any_domain)
+        return true;
+    return std::visit([&](const auto& val) -> bool {
+        if constexpr (calc_val::is_complex_type<decltype(val)>()) {
+            if (val.imag() != 0)
+                return false;
+            return domain != positive_real_domain || val.real() >= 0;
+        } else
+            return domain != positive_real_domain || val >= 0;
+    }, val);
+}
+
 
-    for (auto& elem: unary_fn_table)
-        internals.emplace(tmp_key = elem.identifier, elem.fn);
 
-    internals.emplace(tmp_key = "pi", calc_val::c_pi);
-    internals.emplace(tmp_key = "e", calc_val::c_e);
-    internals.emplace(tmp_key = "i", calc_val::i);
-    last_val_pos = internals.emplace(tmp_key = "last", calc_val::complex_type(calc_val::nan, calc_val::nan)).first;
+inline auto calc_parser::finish_construction() -> void {
+    for (auto& elem: unary_fn_table)
+        internals.emplace(elem.identifier, &elem);
+    for (auto& elem: multi_fn_table)
+        internals.emplace(elem.identifier, &elem);
+
+    internals.emplace("pi", calc_val::c_pi);
+    internals.emplace("e", calc_val::c_e);
+    internals.emplace("i", calc_val::i);
+    last_val_pos = internals.emplace("last", calc_val::complex_type(calc_val::nan, calc_val::nan)).first;
 }
 
-calc_parser::calc_parser() {finish_construction();}
+calc_parser::calc_parser(std::pmr::memory_resource* upstream)
+    : memory{std::make_shared<session_memory>(upstream)}
+{
+    finish_construction();
+}
 
 calc_parser::calc_parser(
     calc_val::number_type_codes default_number_type_code_,
     calc_val::radices default_number_radix_,
-    calc_val::int_word_sizes int_word_size_)
+    calc_val::int_word_sizes int_word_size_,
+    std::pmr::memory_resource* upstream)
 :
     default_number_type_code{default_number_type_code_},
     default_number_radix{default_number_radix_},
-    int_word_size{int_word_size_}
+    int_word_size{int_word_size_},
+    memory{std::make_shared<session_memory>(upstream)}
+{
+    finish_construction();
+}
+
+calc_parser::calc_parser(fork_tag, const calc_parser& parent)
+:
+    default_number_type_code{parent.default_number_type_code},
+    default_number_radix{parent.default_number_radix},
+    int_word_size{parent.int_word_size},
+    memory{parent.memory}
 {
     finish_construction();
+    last_val_pos->second = parent.last_val();
+    variables = parent.variables;
+    formulas = parent.formulas;
+    dependents = parent.dependents;
+    variables_version_ = parent.variables_version_;
+    result_cache_ = parent.result_cache_;
+    fn_memo_ = parent.fn_memo_;
 }
 
 auto calc_parser::options() const -> parser_options {
@@ -127,34 +288,128 @@ auto calc_parser::evaluate(
     output_options& out_options,
     variables_changed_callback variables_changed_
 ) -> calc_val::variant_type
+{
+    return value_or_throw(try_evaluate(input, help, out_options, variables_changed_));
+}
+
+auto calc_parser::evaluate(
+    calc_stream_lexer& input,
+    help_callback help,
+    output_options& out_options,
+    variables_changed_callback variables_changed_
+) -> calc_val::variant_type
+{
+    return value_or_throw(try_evaluate(input, help, out_options, variables_changed_));
+}
+
+auto calc_parser::try_evaluate(
+    std::string_view input,
+    help_callback help,
+    output_options& out_options,
+    variables_changed_callback variables_changed_
+) -> evaluation_result
 {
     assert(help);
     variables_changed = variables_changed_;
+    auto cancellation_scope = calc_cancellation::scope(cancellation_);
+
+    // long input is tokenized up front; the token array is a temporary of this
+    // evaluation and lives in an arena released as a whole on return
+    auto arena = std::pmr::monotonic_buffer_resource(&memory->counter);
+    auto token_buffer = std::optional<calc_token_buffer>();
+    if (input.size() >= pretokenize_min_input_size && input.size() <= calc_token_buffer::max_input_size) {
+        try {
+            token_buffer.emplace(input, default_number_radix, &arena);
+        } catch (const std::bad_alloc&) { // beyond the memory limit; lexed on demand instead
+            token_buffer.reset();
+        }
+    }
+    auto lexer = token_buffer
+        ? lookahead_calc_lexer(*token_buffer)
+        : lookahead_calc_lexer(input, default_number_radix);
 
-    auto lexer = lookahead_calc_lexer(input, default_number_radix);
+    auto result = input_expr<calc_val::variant_type>(lexer, help, out_options, input);
+    deliver_variables_delta();
+    return result;
+}
+
+auto calc_parser::try_evaluate(
+    calc_stream_lexer& input,
+    help_callback help,
+    output_options& out_options,
+    variables_changed_callback variables_changed_
+) -> evaluation_result
+{
+    assert(help);
+    variables_changed = variables_changed_;
+    auto cancellation_scope = calc_cancellation::scope(cancellation_);
+
+    input.default_number_radix(default_number_radix);
+    auto lexer = lookahead_calc_lexer(input);
+    auto result = input_expr<calc_val::variant_type>(lexer, help, out_options);
+    deliver_variables_delta();
+    return result;
+}
+
+auto calc_parser::value_or_throw(evaluation_result&& result) -> calc_val::variant_type {
+    if (result.error)
+        throw *result.error;
+    if (result.void_kind != not_void)
+        throw void_expression();
+    return std::move(result.value);
+}
+
+auto calc_parser::fail(calc_parse_error::error_codes error, const lexer_token& token,
+    lexer_token::token_ids expected_token_id) -> calc_val::variant_type
+{
+    if (!parse_error)
+        parse_error.emplace(error, token, expected_token_id);
+    return {};
+}
 
+template <typename Value>
+auto calc_parser::input_expr(lookahead_calc_lexer& lexer, help_callback& help, output_options& out_options,
+    std::string_view cacheable_input) -> evaluation_result
+{
     // <input> ::= "help"
     //           | [ <option> ]... [ <delete_expr> | <math_expr> ]
+    constexpr auto validating = std::is_same_v<Value, validated>;
+
+    parse_error.reset();
+    if constexpr (!validating)
+        changed_variables_.clear();
+    auto result = evaluation_result();
+    auto error_result = [&] {
+        result.error = std::move(parse_error);
+        parse_error.reset();
+        return result;
+    };
 
     if (lexer.peek_token().id == lexer_token::help && lexer.peek_token2().id == lexer_token::end) {
         help();
-        throw void_expression();
+        result.void_kind = help_input;
+        return result;
     }
 
-    if (lexer.peek_token().id == lexer_token::option) {
+    auto has_options = lexer.peek_token().id == lexer_token::option;
+    if (has_options) {
         calc_args args;
         do {
             lexer.get_token();
             interpret_arg(lexer.last_token().view, expression_option_code, args);
-            if (args.other_args)
-                throw calc_parse_error(calc_parse_error::invalid_option, lexer.last_token());
+            if (args.other_args) {
+                fail(calc_parse_error::invalid_option, lexer.last_token());
+                return error_result();
+            }
             if (args.n_default_options > 1
                 || args.n_output_options > 1
                 || args.n_int_word_size_options > 1
                 || args.n_precision_options > 1
                 || args.n_output_fp_normalized_options > 1
-            )
-                throw calc_parse_error(calc_parse_error::too_many_options, lexer.last_token());
+            ) {
+                fail(calc_parse_error::too_many_options, lexer.last_token());
+                return error_result();
+            }
         } while (lexer.peek_token().id == lexer_token::option);
 
         if (args.n_help_options)
@@ -176,168 +431,298 @@ auto calc_parser::evaluate(
 
     if (lexer.peek_token().id == lexer_token::del) {
         assumed_delete_expr(lexer);
-        throw void_expression();
+        if (failed())
+            return error_result();
+        result.void_kind = delete_input;
+        return result;
     }
 
-    if (lexer.peek_token().id == lexer_token::end)
-        throw void_expression();
+    if (lexer.peek_token().id == lexer_token::end) {
+        result.void_kind = has_options ? options_input : blank_input;
+        return result;
+    }
+
+    auto cache_key = std::optional<calc_result_cache::key_type>();
+    if (!validating && result_cache_ && !cacheable_input.empty()) {
+        cache_key = result_cache_key(cacheable_input.substr(lexer.peek_token().view_offset));
+        if (cache_key) {
+            if (auto cached = result_cache_->find(*cache_key)) {
+                last_val_pos->second = *cached;
+                result.value = std::move(*cached);
+                return result;
+            }
+        }
+    }
+
+    auto val = math_expr<Value>(lexer);
+    if (failed())
+        return error_result();
 
-    auto val = math_expr(lexer);
+    if (lexer.peek_token().id == lexer_token::option) {
+        fail(calc_parse_error::option_must_preface_math_expr, lexer.peeked_token());
+        return error_result();
+    }
+    if (lexer.get_token().id != lexer_token::end) {
+        fail(calc_parse_error::syntax_error, lexer.last_token());
+        return error_result();
+    }
 
-    if (lexer.peek_token().id == lexer_token::option)
-        throw calc_parse_error(calc_parse_error::option_must_preface_math_expr, lexer.peeked_token());
-    if (lexer.get_token().id != lexer_token::end)
-        throw calc_parse_error(calc_parse_error::syntax_error, lexer.last_token());
+    if constexpr (!validating) {
+        if (cache_key)
+            result_cache_->insert(*cache_key, val);
+        last_val_pos->second = val;
+        result.value = std::move(val);
+    }
+    return result;
+}
 
-    last_val_pos->second = val;
-    return val;
+auto calc_parser::result_cache_key(std::string_view expression_input) const
+    -> std::optional<calc_result_cache::key_type>
+{
+    // the key is the parser options followed by the tokens, each as its id and,
+    // for tokens whose spelling varies, its text terminated by a nul
+    auto key = calc_result_cache::key_type();
+    key.reserve(expression_input.size() + 8);
+    key += static_cast<char>(default_number_type_code);
+    key += static_cast<char>(default_number_radix);
+    key += static_cast<char>(int_word_size);
+    key += static_cast<char>(int_word_size >> 8);
+
+    auto lexer = calc_lexer(expression_input, default_number_radix);
+    for (;;) {
+        auto token = lexer.get_token();
+        switch (token.id) {
+            case lexer_token::end:
+                return key;
+            case lexer_token::unspecified:
+            case lexer_token::eq:
+            case lexer_token::option:
+            case lexer_token::help:
+            case lexer_token::del:
+                return std::nullopt; // assignment, or an error that is not worth caching
+            case lexer_token::identifier:
+                if (token.view == "last" || internals.find(token.view) == internals.end()
+                    || variables.contains(token.view))
+                    return std::nullopt; // value is not fixed (a variable may shadow an internal)
+                [[fallthrough]];
+            case lexer_token::number:
+            case lexer_token::mfac:
+                key += static_cast<char>(token.id);
+                key += token.view;
+                key += '\0';
+                break;
+            default:
+                key += static_cast<char>(token.id);
+        }
+    }
 }
 
 auto calc_parser::assumed_delete_expr(lookahead_calc_lexer& lexer) -> void {
 // <delete_expr> ::= "delete" <identifier> <end>
+// when validating, the checks are made but the variable is not deleted
     lexer.get_token(); // assume next token is del (caller assures this)
     assert(lexer.last_token().id == lexer_token::del);
 
     lexer.get_token();
-    if (lexer.last_token().id != lexer_token::identifier)
-        throw calc_parse_error(calc_parse_error::variable_identifier_expected, lexer.last_token());
-    auto itr = variables.find(tmp_key = lexer.last_token().view);
-    if (itr != variables.end()) {
-        if (lexer.get_token().id != lexer_token::end)
-            throw calc_parse_error(calc_parse_error::syntax_error, lexer.last_token());
-        variables.erase(itr);
+    if (lexer.last_token().id != lexer_token::identifier) {
+        fail(calc_parse_error::variable_identifier_expected, lexer.last_token());
+        return;
+    }
+    auto identifier_token = lexer.last_token();
+    if (variables.contains(identifier_token.view)) {
+        if (lexer.get_token().id != lexer_token::end) {
+            fail(calc_parse_error::syntax_error, lexer.last_token());
+            return;
+        }
+        if (dependents.find(identifier_token.view) != dependents.end()) {
+            fail(calc_parse_error::variable_used_by_formula, identifier_token);
+            return;
+        }
+        if (validating_state) {
+            classify_identifier(identifier_token, variable_class);
+            return;
+        }
+        try {
+            // erasing copies nodes shared with a checkpoint or fork
+            if (formulas.contains(identifier_token.view))
+                unbind_formula(identifier_token.view);
+            variables.erase(identifier_token.view);
+        } catch (const std::bad_alloc&) {
+            fail(calc_parse_error::out_of_memory, identifier_token);
+            return;
+        }
+        note_variable_change(identifier_token.view, variable_removed);
         if (variables_changed)
             variables_changed();
-    } else if (internals.find(tmp_key) != internals.end())
-        throw calc_parse_error(calc_parse_error::cant_delete_internal, lexer.last_token());
-    else
-        throw calc_parse_error(calc_parse_error::undefined_identifier, lexer.last_token());
+    } else if (auto itr = internals.find(identifier_token.view); itr != internals.end()) {
+        if (validating_state)
+            classify_identifier(identifier_token,
+                std::holds_alternative<calc_val::variant_type>(itr->second) ? constant_class : function_class);
+        fail(calc_parse_error::cant_delete_internal, identifier_token);
+    } else {
+        if (validating_state)
+            classify_identifier(identifier_token, undefined_class);
+        fail(calc_parse_error::undefined_identifier, identifier_token);
+    }
 }
 
-auto calc_parser::math_expr(lookahead_calc_lexer& lexer) -> calc_val::variant_type {
-// <math_expr> ::= <bxor_expr> [ "|" <bxor_expr> ]...
-    auto lval = bxor_expr(lexer);
-    for (;;) {
-        if (lexer.peek_token().id == lexer_token::bor) {
-            auto op_token = lexer.get_token();
-            auto rval = bxor_expr(lexer);
-            try_to_make_int_if_complex(lval);
-            try_to_make_int_if_complex(rval);
-            lval = std::visit([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
-                assert(is_nan(lval) || lval == trim_if_int(lval));
-                assert(is_nan(rval) || rval == trim_if_int(rval));
-                if constexpr (calc_val::is_int_type<decltype(lval)>() && calc_val::is_int_type<decltype(rval)>())
-                    return lval | rval;
-                else if constexpr (!calc_val::is_int_type<decltype(lval)>())
-                    throw calc_parse_error(calc_parse_error::invalid_left_operand, op_token);
-                else
-                    throw calc_parse_error(calc_parse_error::invalid_right_operand, op_token);
-            }, lval, rval);
-        } else
-            break;
+// operations shared by evaluation while parsing and by compiled expressions.
+// each records a parse error at op_token if the operation is invalid for its
+// operands
+
+auto calc_parser::binary_op(const lexer_token& op_token, lexer_token::token_ids op,
+    calc_val::variant_type lval, calc_val::variant_type rval) -> calc_val::variant_type
+{
+    auto val = apply_binary_op(op_token, op, std::move(lval), std::move(rval));
+    check_cancellation(op_token);
+    return val;
+}
+
+auto calc_parser::unary_op(const lexer_token& op_token, lexer_token::token_ids op,
+    calc_val::variant_type val) -> calc_val::variant_type
+{
+    auto memo_id = std::optional<calc_fn_memo::fn_id>();
+    if (op == lexer_token::fac || op == lexer_token::dfac)
+        memo_id = op == lexer_token::fac ? fac_memo_id : dfac_memo_id;
+    return memoized(op_token, memo_id, val, [&] {
+        return apply_unary_op(op_token, op, std::move(val));
+    });
+}
+
+auto calc_parser::call_fn(const lexer_token& identifier_token, const identifier_with_unary_fn* fn,
+    const calc_val::variant_type& arg) -> calc_val::variant_type
+{
+    auto memo_id = std::optional<calc_fn_memo::fn_id>();
+    if (fn->fn && !(fn->int_fn && !std::holds_alternative<calc_val::complex_type>(arg)))
+        memo_id = static_cast<calc_fn_memo::fn_id>(fn - unary_fn_table);
+    return memoized(identifier_token, memo_id, arg, [&] {
+        return apply_fn(identifier_token, fn, arg);
+    });
+}
+
+template <typename Apply>
+auto calc_parser::memoized(const lexer_token& token, std::optional<calc_fn_memo::fn_id> memo_id,
+    const calc_val::variant_type& arg, Apply apply) -> calc_val::variant_type
+{
+// apply() followed by check_cancellation, looked up in and stored into
+// fn_memo_ if there is a memo_id. a value is stored only if it was computed
+// without error (or cancellation)
+    auto key = std::optional<calc_fn_memo::key_type>();
+    if (fn_memo_ && memo_id) {
+        key = fn_memo_->key(*memo_id, arg);
+        if (key) {
+            if (auto val = fn_memo_->find(*key))
+                return std::move(*val);
+        }
     }
-    return lval;
+    auto val = apply();
+    check_cancellation(token);
+    if (key && !parse_error)
+        fn_memo_->insert(*key, val);
+    return val;
 }
 
-auto calc_parser::bxor_expr(lookahead_calc_lexer& lexer) -> calc_val::variant_type {
-// <bxor_expr> ::= <band_expr> [ "^" <band_expr> ]...
-    auto lval = band_expr(lexer);
-    for (;;) {
-        if (lexer.peek_token().id == lexer_token::bxor) {
-            auto op_token = lexer.get_token();
-            auto rval = band_expr(lexer);
-            try_to_make_int_if_complex(lval);
-            try_to_make_int_if_complex(rval);
-            lval = std::visit([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
-                assert(is_nan(lval) || lval == trim_if_int(lval));
-                assert(is_nan(rval) || rval == trim_if_int(rval));
-                if constexpr (calc_val::is_int_type<decltype(lval)>() && calc_val::is_int_type<decltype(rval)>())
-                    return lval ^ rval;
-                else if constexpr (!calc_val::is_int_type<decltype(lval)>())
-                    throw calc_parse_error(calc_parse_error::invalid_left_operand, op_token);
-                else
-                    throw calc_parse_error(calc_parse_error::invalid_right_operand, op_token);
-            }, lval, rval);
-        } else
-            break;
+auto calc_parser::fn_memo_id(std::string_view identifier) -> std::optional<calc_fn_memo::fn_id> {
+    static_assert(std::size(unary_fn_table) + 2 <= calc_fn_memo::max_fn_count);
+    if (identifier == "!")
+        return fac_memo_id;
+    if (identifier == "!!")
+        return dfac_memo_id;
+    for (auto& elem : unary_fn_table) {
+        if (elem.identifier == identifier)
+            return elem.fn ? std::optional(static_cast<calc_fn_memo::fn_id>(&elem - unary_fn_table)) : std::nullopt;
     }
-    return lval;
+    return std::nullopt;
 }
 
-auto calc_parser::band_expr(lookahead_calc_lexer& lexer) -> calc_val::variant_type {
-// <band_expr> ::= <shift_expr> [ "&" <shift_expr> ]...
-    auto lval = shift_expr(lexer);
-    for (;;) {
-        if (lexer.peek_token().id == lexer_token::band) {
-            auto op_token = lexer.get_token();
-            auto rval = shift_expr(lexer);
-            try_to_make_int_if_complex(lval);
-            try_to_make_int_if_complex(rval);
-            lval = std::visit([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
-                assert(is_nan(lval) || lval == trim_if_int(lval));
-                assert(is_nan(rval) || rval == trim_if_int(rval));
-                if constexpr (calc_val::is_int_type<decltype(lval)>() && calc_val::is_int_type<decltype(rval)>())
-                    return lval & rval;
-                else if constexpr (!calc_val::is_int_type<decltype(lval)>())
-                    throw calc_parse_error(calc_parse_error::invalid_left_operand, op_token);
-                else
-                    throw calc_parse_error(calc_parse_error::invalid_right_operand, op_token);
-            }, lval, rval);
-        } else
+auto calc_parser::call_fn(const lexer_token& identifier_token, const identifier_with_multi_fn* fn,
+    std::span<const calc_val::variant_type> args) -> calc_val::variant_type
+{
+    auto val = apply_fn(identifier_token, fn, args);
+    check_cancellation(identifier_token);
+    return val;
+}
+
+auto calc_parser::check_cancellation(const lexer_token& token) -> void {
+// a long operation may have returned early, with a meaningless value, if the
+// evaluation was cancelled; that's reported here
+    switch (calc_cancellation::current_state()) {
+        case calc_cancellation::not_requested:
+            break;
+        case calc_cancellation::cancel_requested:
+            fail(calc_parse_error::evaluation_cancelled, token);
+            break;
+        case calc_cancellation::deadline_passed:
+            fail(calc_parse_error::deadline_exceeded, token);
             break;
     }
-    return lval;
 }
 
-auto calc_parser::shift_expr(lookahead_calc_lexer& lexer) -> calc_val::variant_type {
-// <shift_expr> ::= <additive_expr> [ ( "<<" | ">>" ) <additive_expr> ]...
-    auto shift_arg_in_range = [&](const auto& shift_arg, const lexer_token& op_token) -> auto {
+auto calc_parser::apply_binary_op(const lexer_token& op_token, lexer_token::token_ids op,
+    calc_val::variant_type lval, calc_val::variant_type rval) -> calc_val::variant_type
+{
+    auto shift_arg_in_range = [&](const auto& shift_arg) -> auto {
     // assume shift_arg is valid only if positive and less than int_word_size.
-    // if shift_arg is negative then it's unusable; parse_error will be thrown
-    // in that case. if shift_arg is >= int_word_size then we will simulate
-    // shifting beyond that limit
+    // if shift_arg is negative then it's unusable; parse error will be
+    // recorded in that case. if shift_arg is >= int_word_size then we will
+    // simulate shifting beyond that limit
         using ShiftT = std::decay_t<decltype(shift_arg)>;
-        if constexpr (calc_val::is_int_type<ShiftT>() && std::is_signed_v<ShiftT>) {
-            if (shift_arg < 0)
-                throw calc_parse_error(calc_parse_error::negative_shift_invalid, op_token);
+        if constexpr (calc_val::is_signed_int_type<ShiftT>()) {
+            if (shift_arg < 0) {
+                fail(calc_parse_error::negative_shift_invalid, op_token);
+                return false;
+            }
             return shift_arg < int_word_size;
         } else if constexpr (calc_val::is_int_type<ShiftT>())
             return shift_arg < int_word_size;
     };
 
-    auto lval = additive_expr(lexer);
-    for (;;) {
-        if (lexer.peek_token().id == lexer_token::shiftl) {
-            lexer_token op_token = lexer.get_token();
-            auto rval = additive_expr(lexer);
+    switch (op) {
+        case lexer_token::bor:
+        case lexer_token::bxor:
+        case lexer_token::band:
+            try_to_make_int_if_complex(lval);
+            try_to_make_int_if_complex(rval);
+            promote_operands(lval, rval);
+            return visit_operands([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
+                assert(is_nan(lval) || lval == trim_if_int(lval));
+                assert(is_nan(rval) || rval == trim_if_int(rval));
+                if constexpr (calc_val::is_int_type<decltype(lval)>() && calc_val::is_int_type<decltype(rval)>())
+                    return op == lexer_token::bor ? lval | rval : op == lexer_token::bxor ? lval ^ rval : lval & rval;
+                else if constexpr (!calc_val::is_int_type<decltype(lval)>())
+                    return fail(calc_parse_error::invalid_left_operand, op_token);
+                else
+                    return fail(calc_parse_error::invalid_right_operand, op_token);
+            }, lval, rval);
+        case lexer_token::shiftl:
             try_to_make_int_if_complex(lval);
             try_to_make_int_if_complex(rval);
-            lval = std::visit([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
+            promote_operands(lval, rval);
+            return visit_operands([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
                 assert(is_nan(lval) || lval == trim_if_int(lval));
                 assert(is_nan(rval) || rval == trim_if_int(rval));
                 using LVT = std::decay_t<decltype(lval)>;
                 using RVT = std::decay_t<decltype(rval)>;
                 if constexpr (calc_val::is_int_type<LVT>() && calc_val::is_int_type<RVT>()) {
-                    if (shift_arg_in_range(rval, op_token))
+                    if (shift_arg_in_range(rval))
                         return trim_if_int(lval << rval);
                     return LVT(0);
                 } else if (!calc_val::is_int_type<LVT>())
-                    throw calc_parse_error(calc_parse_error::invalid_left_operand, op_token);
+                    return fail(calc_parse_error::invalid_left_operand, op_token);
                 else
-                    throw calc_parse_error(calc_parse_error::invalid_right_operand, op_token);
+                    return fail(calc_parse_error::invalid_right_operand, op_token);
             }, lval, rval);
-        } else if (lexer.peeked_token().id == lexer_token::shiftr) {
-            lexer_token op_token = lexer.get_token();
-            auto rval = additive_expr(lexer);
+        case lexer_token::shiftr:
             try_to_make_int_if_complex(lval);
             try_to_make_int_if_complex(rval);
-            lval = std::visit([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
+            promote_operands(lval, rval);
+            return visit_operands([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
                 assert(is_nan(lval) || lval == trim_if_int(lval));
                 assert(is_nan(rval) || rval == trim_if_int(rval));
                 using LVT = std::decay_t<decltype(lval)>;
                 using RVT = std::decay_t<decltype(rval)>;
-                if constexpr (calc_val::is_int_type<LVT>() && std::is_signed_v<LVT> && calc_val::is_int_type<RVT>()) {
-                    if (shift_arg_in_range(rval, op_token))
+                if constexpr (calc_val::is_signed_int_type<LVT>() && calc_val::is_int_type<RVT>()) {
+                    if (shift_arg_in_range(rval))
                         return lval >> rval;
                     else if (lval < 0)
                         return LVT(-1); // -1 doesn't need to be trimmed -- sign extended value
@@ -345,216 +730,714 @@ auto calc_parser::shift_expr(lookahead_calc_lexer& lexer) -> calc_val::variant_t
                         return LVT(0);
                 } else if constexpr (calc_val::is_int_type<LVT>() && calc_val::is_int_type<RVT>()) {
                     calc_val::uint_type shift_arg = 0;
-                    if (shift_arg_in_range(rval, op_token))
+                    if (shift_arg_in_range(rval))
                         return lval >> shift_arg;
                     return LVT(0);
                 } else if (!calc_val::is_int_type<LVT>())
-                    throw calc_parse_error(calc_parse_error::invalid_left_operand, op_token);
+                    return fail(calc_parse_error::invalid_left_operand, op_token);
                 else
-                    throw calc_parse_error(calc_parse_error::invalid_right_operand, op_token);
+                    return fail(calc_parse_error::invalid_right_operand, op_token);
             }, lval, rval);
-        } else
-            break;
-    }
-    return lval;
-}
-
-auto calc_parser::additive_expr(lookahead_calc_lexer& lexer) -> calc_val::variant_type {
-// <additive_expr> ::= <term> [ ( "+" | "-" ) <term> ]...
-    auto lval = term(lexer);
-    for (;;) {
-        if (lexer.peek_token().id == lexer_token::add) {
-            lexer.get_token();
-            lval = std::visit([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
+        case lexer_token::add:
+            promote_operands(lval, rval);
+            return visit_operands([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
                 assert(is_nan(lval) || lval == trim_if_int(lval));
                 assert(is_nan(rval) || rval == trim_if_int(rval));
                 return trim_if_int(lval + rval); // trim incase of overflow
-            }, lval, term(lexer));
-        } else if (lexer.peeked_token().id == lexer_token::sub) {
-            lexer.get_token();
-            lval = std::visit([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
+            }, lval, rval);
+        case lexer_token::sub:
+            promote_operands(lval, rval);
+            return visit_operands([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
                 assert(is_nan(lval) || lval == trim_if_int(lval));
                 assert(is_nan(rval) || rval == trim_if_int(rval));
                 return trim_if_int(lval - rval); // trim incase of underflow
-            }, lval, term(lexer));
-        } else
-            break;
-    }
-    return lval;
-}
-
-auto calc_parser::term(lookahead_calc_lexer& lexer) -> calc_val::variant_type {
-// <term> ::= <factor> [ ( "*" | "/" | "%" ) <factor> | <juxtaposed_factor> ]...
-// <justaposed_factor> ::= <number_factor> | <identifier_factor> | <group_factor> | <bnot_factor> | <help_factor>
-// note: implied multiplication (multiplication by juxtaposition) has the same
-// precedence as explicit multiplication, as it does in wolfram alpha and google
-// calculator, and as argued as being correct in this article:
-// https://mindyourdecisions.com/blog/2016/08/31/what-is-6%C3%B7212-the-correct-answer-explained/
-// note2: <help_factor> is just for proper error handling
-    auto lval = factor(lexer);
-    for (;;) {
-        if (lexer.peek_token().id == lexer_token::mul) {
-            lexer.get_token();
-            lval = std::visit([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
+            }, lval, rval);
+        case lexer_token::mul:
+            promote_operands(lval, rval);
+            return visit_operands([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
                 assert(is_nan(lval) || lval == trim_if_int(lval));
                 assert(is_nan(rval) || rval == trim_if_int(rval));
                 return trim_if_int(lval * rval); // trim incase of overflow
-            }, lval, factor(lexer));
-        } else if (lexer.peeked_token().id == lexer_token::div) {
-            auto op_token = lexer.get_token();
-            lval = std::visit([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
+            }, lval, rval);
+        case lexer_token::div:
+            promote_operands(lval, rval);
+            return visit_operands([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
                 assert(is_nan(lval) || lval == trim_if_int(lval));
                 assert(is_nan(rval) || rval == trim_if_int(rval));
                 if constexpr (calc_val::is_int_type<decltype(lval)>() && calc_val::is_int_type<decltype(rval)>()) {
                     if (rval == 0)
-                        throw calc_parse_error(calc_parse_error::integer_division_by_0, op_token);
+                        return fail(calc_parse_error::integer_division_by_0, op_token);
                 }
                 return trim_if_int(lval / rval); // note: −32768 / −1 overflows 16 bit int, thus need to trim
-            }, lval, factor(lexer));
-        } else if (lexer.peeked_token().id == lexer_token::mod) {
-            auto op_token = lexer.get_token();
-            auto rval = factor(lexer);
+            }, lval, rval);
+        case lexer_token::mod:
             try_to_make_int_if_complex(lval);
             try_to_make_int_if_complex(rval);
-            lval = std::visit([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
+            promote_operands(lval, rval);
+            return visit_operands([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
                 assert(is_nan(lval) || lval == trim_if_int(lval));
                 assert(is_nan(rval) || rval == trim_if_int(rval));
                 if constexpr (calc_val::is_int_type<decltype(lval)>() && calc_val::is_int_type<decltype(rval)>()) {
                     if (rval == 0)
-                        throw calc_parse_error(calc_parse_error::integer_division_by_0, op_token);
+                        return fail(calc_parse_error::integer_division_by_0, op_token);
                     return trim_if_int(lval % rval); // trim for good measure
                 } else if constexpr (!calc_val::is_int_type<decltype(lval)>())
-                    throw calc_parse_error(calc_parse_error::invalid_left_operand, op_token);
+                    return fail(calc_parse_error::invalid_left_operand, op_token);
                 else
-                    throw calc_parse_error(calc_parse_error::invalid_right_operand, op_token);
+                    return fail(calc_parse_error::invalid_right_operand, op_token);
             }, lval, rval);
-        } else if (lexer.peeked_token().id == lexer_token::number // <number_factor>
-                || lexer.peeked_token().id == lexer_token::identifier // <identifier_factor>
-                || lexer.peeked_token().id == lexer_token::lparen // <group_factor>
-                || lexer.peeked_token().id == lexer_token::bnot// <bnot_factor>
-                || lexer.peeked_token().id == lexer_token::help) { // <help_factor>
-            lval = std::visit([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
+        case lexer_token::pow:
+            promote_operands(lval, rval);
+            return visit_operands([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
                 assert(is_nan(lval) || lval == trim_if_int(lval));
                 assert(is_nan(rval) || rval == trim_if_int(rval));
-                return trim_if_int(lval * rval); // trim incase of overflow
-            }, lval, factor(lexer));
-        } else
-            break;
+                return trim_if_int(calc_val::pow(lval, rval));
+            }, lval, rval);
+        default:
+            return fail(calc_parse_error::internal_error, op_token);
     }
-    return lval;
 }
 
-auto calc_parser::factor(lookahead_calc_lexer& lexer) -> calc_val::variant_type {
-// <factor> ::= "-" <number> ( <any_token> - ( <factorial_op> | "^" | "**" ) )
-//            | ( "-" | "+" | "~" ) <factor>
-//            | <base> [ <factorial_op> ]... [ "^" | "**" <factor> ]
-// <factorial_op> ::= "!" | "!!" | <mfac>
-// note: exponentiation is evaluated right-to-left.
-// Modifications here may require modifications to calc_parser::term for
-// <justaposed_factor>
-    if (lexer.peek_token().id == lexer_token::sub) { // "-'
-        lexer.get_token();
-
-        // special case: "-" <number> ( <any_token> - ( <factorial_op> | "^" | "**" ) )
-        // this is needed to properly negate and range check the number
-        if (lexer.peek_token().id == lexer_token::number &&
-                lexer.peek_token2().id != lexer_token::fac &&
-                lexer.peek_token2().id != lexer_token::dfac &&
-                lexer.peek_token2().id != lexer_token::mfac &&
-                lexer.peek_token2().id != lexer_token::pow)
-            return assumed_number(lexer, true);
-
-        return std::visit([&](const auto& val) -> calc_val::variant_type {
-            assert(is_nan(val) || val == trim_if_int(val));
-            return trim_if_int(-val);
-        }, factor(lexer));
+auto calc_parser::apply_unary_op(const lexer_token& op_token, lexer_token::token_ids op,
+    calc_val::variant_type val) -> calc_val::variant_type
+{
+    switch (op) {
+        case lexer_token::sub:
+            return std::visit([&](const auto& val) -> calc_val::variant_type {
+                assert(is_nan(val) || val == trim_if_int(val));
+                return trim_if_int(-val);
+            }, val);
+        case lexer_token::bnot:
+            try_to_make_int_if_complex(val);
+            return std::visit([&](const auto& val) -> calc_val::variant_type {
+                assert(is_nan(val) || val == trim_if_int(val));
+                if constexpr (calc_val::is_int_type<decltype(val)>())
+                    return trim_if_int(~val);
+                else
+                    return fail(calc_parse_error::invalid_operand, op_token);
+            }, val);
+        case lexer_token::fac:
+            if (!in_domain(real_domain, val))
+                return fail(calc_parse_error::op_domain_real_only, op_token);
+            return std::visit([](const auto& val) -> calc_val::variant_type {
+                if constexpr (calc_val::is_wide_int_type<decltype(val)>())
+                    return calc_val::tgamma(calc_val::complex_type(calc_val::float_type(val)) + 1);
+                else
+                    return calc_val::tgamma(val + 1);
+            }, val);
+        case lexer_token::dfac:
+            if (!in_domain(real_domain, val))
+                return fail(calc_parse_error::op_domain_real_only, op_token);
+            return std::visit([](const auto& val) -> calc_val::complex_type {
+                if constexpr (calc_val::is_wide_int_type<decltype(val)>())
+                    return calc_val::dfac(calc_val::complex_type(calc_val::float_type(val)));
+                else
+                    return calc_val::dfac(val);
+            }, val);
+        default:
+            return fail(calc_parse_error::internal_error, op_token);
     }
+}
 
-    if (lexer.peek_token().id == lexer_token::add) { // "+" -- just return <factor>
-        lexer.get_token();
-        return factor(lexer);
+auto calc_parser::real_fn_value(const identifier_with_unary_fn* fn, const calc_val::float_type& x, bool negative_zero)
+    -> std::optional<calc_val::complex_type>
+{
+// where a part of real_fn's value is not finite, fn's may differ
+    if (!fn->real_fn || x == 0 || !isfinite(x) || (fn->real_fn_domain == positive_real_domain && x < 0))
+        return std::nullopt;
+    auto val = fn->real_fn(x, negative_zero);
+    if (!isfinite(val.real()) || !isfinite(val.imag()))
+        return std::nullopt;
+    return val;
+}
+
+auto calc_parser::apply_fn(const lexer_token& identifier_token, const identifier_with_unary_fn* fn,
+    const calc_val::variant_type& arg) -> calc_val::variant_type
+{
+    if (!in_domain(fn->domain, arg))
+        return fail(fn->domain == positive_real_domain
+            ? calc_parse_error::op_domain_positive_real_only
+            : calc_parse_error::op_domain_real_only, identifier_token);
+    if (!fn->fn && std::holds_alternative<calc_val::complex_type>(arg)) { // an integer function
+        auto int_arg = arg;
+        try_to_make_int_if_complex(int_arg);
+        if (std::holds_alternative<calc_val::complex_type>(int_arg))
+            return fail(calc_parse_error::invalid_operand, identifier_token);
+        trim_int(int_arg);
+        return apply_fn(identifier_token, fn, int_arg);
     }
+    auto val = std::visit([&](const auto& val) -> calc_val::variant_type {
+        using VT = std::decay_t<decltype(val)>;
+        if constexpr (calc_val::is_wide_int_type<VT>()) {
+            // the integer functions take words of up to 128 bits; the others
+            // take the value as a real or complex number
+            if (auto z = real_fn_value(fn, calc_val::float_type(val), false))
+                return *z;
+            if (!fn->fn)
+                return fail(calc_parse_error::wide_int_fn_unsupported, identifier_token);
+            return fn->fn(calc_val::complex_type(calc_val::float_type(val)));
+        } else if constexpr (calc_val::is_int_type<VT>()) {
+            if (fn->int_fn) // on the bits of the word, then back to VT
+                return VT(fn->int_fn(trim_if_int(calc_val::uint_type(val)), int_word_size));
+            if (auto z = real_fn_value(fn, calc_val::float_type(val), false))
+                return *z;
+            return fn->fn(val);
+        } else {
+            if (val.imag() == 0)
+                if (auto z = real_fn_value(fn, val.real(), signbit(val.imag())))
+                    return *z;
+            return fn->fn(val);
+        }
+    }, arg);
+    trim_int(val);
+    return val;
+}
 
-    if (lexer.peek_token().id == lexer_token::bnot) { // "~"
-        auto op_token = lexer.get_token();
-        auto val = factor(lexer);
-        try_to_make_int_if_complex(val);
-        return std::visit([&](const auto& val) -> calc_val::variant_type {
-            assert(is_nan(val) || val == trim_if_int(val));
-            if constexpr (calc_val::is_int_type<decltype(val)>())
-                return trim_if_int(~val);
+template <typename T>
+static auto converted(std::span<const calc_val::variant_type> args) -> std::vector<T> {
+// args, which are integers, converted to T
+    auto xs = std::vector<T>();
+    xs.reserve(args.size());
+    for (auto& arg : args) {
+        xs.push_back(std::visit([](const auto& x) -> T {
+            if constexpr (calc_val::is_int_type<decltype(x)>())
+                return static_cast<T>(x);
             else
-                throw calc_parse_error(calc_parse_error::invalid_operand, op_token);
-        }, val);
+                return 0; // not reached
+        }, arg));
+    }
+    return xs;
+}
+
+static auto to_complex(const calc_val::variant_type& x) -> calc_val::complex_type {
+    return std::visit([](const auto& x) {
+        if constexpr (calc_val::is_wide_int_type<decltype(x)>())
+            return calc_val::complex_type(calc_val::float_type(x));
+        else
+            return calc_val::complex_type(x);
+    }, x);
+}
+
+static auto int_magnitude(const calc_val::variant_type& x) -> calc_val::uint_type {
+// of an integer x; that of the most negative int is still < 2^int_word_size
+    return std::visit([](const auto& x) -> calc_val::uint_type {
+        if constexpr (calc_val::is_signed_int_type<decltype(x)>())
+            return x < 0 ? calc_val::uint_type(0) - calc_val::uint_type(x) : calc_val::uint_type(x);
+        else
+            return calc_val::uint_type(x);
+    }, x);
+}
+
+static auto is_negative_int(const calc_val::variant_type& x) -> bool {
+    auto val = std::get_if<calc_val::int_type>(&x);
+    return val && *val < 0;
+}
+
+static auto magnitude(const calc_val::variant_type& x) -> calc_val::float_type {
+// not abs of a complex x, which throws std::overflow_error if a part is inf
+    return std::visit([](const auto& x) -> calc_val::float_type {
+        if constexpr (calc_val::is_complex_type<decltype(x)>())
+            return calc_val::hypot(std::array{abs(x.real()), abs(x.imag())});
+        else if constexpr (calc_val::is_signed_int_type<decltype(x)>())
+            return x < 0 ? -calc_val::float_type(x) : calc_val::float_type(x);
+        else
+            return calc_val::float_type(x);
+    }, x);
+}
+
+template <typename T>
+auto calc_parser::reduce_ints(const identifier_with_multi_fn* fn, std::span<const T> xs) -> T {
+// min, max, sum or product of xs, which are trimmed to int_word_size. words
+// of up to 64 bits are reduced as 64-bit lanes (see reductions.hpp)
+    if constexpr (!calc_val::is_wide_int_type<T>()) {
+        if (int_word_size <= 64) {
+            using lane_type = std::conditional_t<calc_val::is_signed_int_type<T>(), std::int64_t, std::uint64_t>;
+            switch (fn->fn) {
+                case min_fn:
+                case max_fn: {
+                    auto lanes = std::vector<lane_type>(xs.begin(), xs.end());
+                    return fn->fn == min_fn ? calc_val::min_lanes(lanes) : calc_val::max_lanes(lanes);
+                }
+                default: {
+                    auto lanes = std::vector<std::uint64_t>(xs.begin(), xs.end()); // the low bits
+                    return trim_if_int(T(fn->fn == sum_fn ? calc_val::sum_lanes(lanes) : calc_val::prod_lanes(lanes)));
+                }
+            }
+        }
+    }
+    switch (fn->fn) {
+        case min_fn:
+            return *std::min_element(xs.begin(), xs.end());
+        case max_fn:
+            return *std::max_element(xs.begin(), xs.end());
+        case sum_fn:
+            return trim_if_int(std::accumulate(xs.begin(), xs.end(), T(0)));
+        default:
+            return trim_if_int(std::accumulate(xs.begin(), xs.end(), T(1), std::multiplies<T>()));
+    }
+}
+
+auto calc_parser::int_args(const lexer_token& identifier_token, std::span<const calc_val::variant_type> args)
+    -> std::optional<std::vector<calc_val::variant_type>>
+{
+// args converted to integers, as the integer functions of unary_fn_table
+// take them; fails with invalid_operand if one is not a whole real number
+// or with wide_int_fn_unsupported if the word size is wider than those
+// functions take (128 bits)
+    auto ints = std::vector<calc_val::variant_type>(args.begin(), args.end());
+    for (auto& x : ints) {
+        try_to_make_int_if_complex(x);
+        trim_int(x);
+        if (std::holds_alternative<calc_val::complex_type>(x)) {
+            fail(calc_parse_error::invalid_operand, identifier_token);
+            return std::nullopt;
+        }
+        if (!std::holds_alternative<calc_val::uint_type>(x) && !std::holds_alternative<calc_val::int_type>(x)) {
+            fail(calc_parse_error::wide_int_fn_unsupported, identifier_token);
+            return std::nullopt;
+        }
+    }
+    return ints;
+}
+
+auto calc_parser::apply_fn(const lexer_token& identifier_token, const identifier_with_multi_fn* fn,
+    std::span<const calc_val::variant_type> args) -> calc_val::variant_type
+{
+// integer arguments of min, max, sum and prod are converted to uint if one
+// of them is a uint and to int otherwise, as they are by the arithmetic
+// operators; they are converted to complex if any argument is complex
+    assert(args.size() >= fn->min_args && args.size() <= fn->max_args);
+    auto is_int = [](const calc_val::variant_type& x) {return !std::holds_alternative<calc_val::complex_type>(x);};
+    auto is_uint = [](const calc_val::variant_type& x) {
+        return std::holds_alternative<calc_val::uint_type>(x) || std::holds_alternative<calc_val::wide_uint_type>(x);
+    };
+    auto trimmed = [&]<typename T>(std::vector<T>&& xs) {
+        for (auto& x : xs)
+            x = trim_if_int(x);
+        return std::move(xs);
+    };
+    auto reals = [&]() -> std::optional<std::vector<calc_val::float_type>> {
+        auto xs = std::vector<calc_val::float_type>();
+        xs.reserve(args.size());
+        for (auto& arg : args) {
+            if (!in_domain(real_domain, arg)) {
+                fail(calc_parse_error::op_domain_real_only, identifier_token);
+                return std::nullopt;
+            }
+            xs.push_back(to_complex(arg).real());
+        }
+        return xs;
+    };
+
+    switch (fn->fn) {
+        case min_fn:
+        case max_fn:
+        case sum_fn:
+        case prod_fn:
+            if (std::all_of(args.begin(), args.end(), is_int)) {
+                if (int_word_size > calc_val::int_bits_128) {
+                    if (std::any_of(args.begin(), args.end(), is_uint)) {
+                        auto xs = trimmed(converted<calc_val::wide_uint_type>(args));
+                        return reduce_ints(fn, std::span<const calc_val::wide_uint_type>(xs));
+                    }
+                    auto xs = converted<calc_val::wide_int_type>(args);
+                    return reduce_ints(fn, std::span<const calc_val::wide_int_type>(xs));
+                }
+                if (std::any_of(args.begin(), args.end(), is_uint)) {
+                    auto xs = trimmed(converted<calc_val::uint_type>(args));
+                    return reduce_ints(fn, std::span<const calc_val::uint_type>(xs));
+                }
+                auto xs = converted<calc_val::int_type>(args);
+                return reduce_ints(fn, std::span<const calc_val::int_type>(xs));
+            }
+            if (fn->fn == min_fn || fn->fn == max_fn) {
+                auto xs = reals();
+                if (!xs)
+                    return {};
+                if (auto nan = std::find_if(xs->begin(), xs->end(), [](const auto& x) {return is_nan(x);});
+                        nan != xs->end())
+                    return calc_val::complex_type(*nan);
+                return calc_val::complex_type(fn->fn == min_fn
+                    ? *std::min_element(xs->begin(), xs->end())
+                    : *std::max_element(xs->begin(), xs->end()));
+            } else {
+                auto zs = std::vector<calc_val::complex_type>();
+                zs.reserve(args.size());
+                std::transform(args.begin(), args.end(), std::back_inserter(zs), to_complex);
+                if (fn->fn == sum_fn)
+                    return calc_val::sum(zs);
+                auto z = zs.front();
+                for (std::size_t i = 1; i < zs.size(); ++i)
+                    z *= zs[i];
+                return z;
+            }
+        case mean_fn: {
+            auto zs = std::vector<calc_val::complex_type>();
+            zs.reserve(args.size());
+            std::transform(args.begin(), args.end(), std::back_inserter(zs), to_complex);
+            return calc_val::complex_type(calc_val::sum(zs) / calc_val::float_type(zs.size()));
+        }
+        case gcd_fn:
+        case lcm_fn: {
+            auto ints = int_args(identifier_token, args);
+            if (!ints)
+                return {};
+            // of the magnitudes, as uint
+            auto xs = std::vector<calc_val::uint_type>();
+            xs.reserve(ints->size());
+            std::transform(ints->begin(), ints->end(), std::back_inserter(xs), int_magnitude);
+            auto r = xs.front();
+            for (std::size_t i = 1; i < xs.size(); ++i) {
+                if (fn->fn == gcd_fn)
+                    r = calc_val::gcd(r, xs[i]);
+                else if (auto g = calc_val::gcd(r, xs[i]))
+                    r = trim_if_int(r / g * xs[i]);
+            }
+            if (std::any_of(ints->begin(), ints->end(), is_uint))
+                return r;
+            return trim_if_int(static_cast<calc_val::int_type>(r));
+        }
+        case hypot_fn: {
+            auto magnitudes = std::vector<calc_val::float_type>();
+            magnitudes.reserve(args.size());
+            std::transform(args.begin(), args.end(), std::back_inserter(magnitudes), magnitude);
+            return calc_val::complex_type(calc_val::hypot(magnitudes));
+        }
+        case atan2_fn: {
+            auto xs = reals();
+            if (!xs)
+                return {};
+            return calc_val::complex_type(atan2((*xs)[0], (*xs)[1]));
+        }
+        case rotl_fn:
+        case rotr_fn: {
+            auto ints = int_args(identifier_token, args);
+            if (!ints)
+                return {};
+            auto n = std::visit([&](const auto& n) {return trim_if_int(calc_val::uint_type(n));}, (*ints)[1]);
+            return std::visit([&](const auto& x) -> calc_val::variant_type {
+                using VT = std::decay_t<decltype(x)>;
+                auto bits = trim_if_int(calc_val::uint_type(x));
+                if constexpr (calc_val::is_int_type<VT>())
+                    return trim_if_int(VT(fn->fn == rotl_fn
+                        ? calc_val::rotl(bits, n, int_word_size)
+                        : calc_val::rotr(bits, n, int_word_size)));
+                else
+                    return {}; // not reached
+            }, (*ints)[0]);
+        }
+        case powmod_fn:
+        case mulmod_fn:
+        case invmod_fn: {
+            // the modulus m must be > 0. the result is in [0, m), so it fits
+            // the word of the arguments' common type
+            auto ints = int_args(identifier_token, args);
+            if (!ints)
+                return {};
+            auto& m_arg = ints->back();
+            auto m = int_magnitude(m_arg);
+            if (m == 0)
+                return fail(calc_parse_error::integer_division_by_0, identifier_token);
+            if (is_negative_int(m_arg))
+                return fail(calc_parse_error::invalid_operand, identifier_token);
+            auto residue = [&](const calc_val::variant_type& x) { // x mod m, in [0, m)
+                auto r = int_magnitude(x) % m;
+                return is_negative_int(x) && r ? m - r : r;
+            };
+            auto r = calc_val::uint_type(0);
+            if (fn->fn == mulmod_fn)
+                r = calc_val::mulmod(residue((*ints)[0]), residue((*ints)[1]), m);
+            else {
+                auto x = residue((*ints)[0]);
+                if (fn->fn == invmod_fn || is_negative_int((*ints)[1])) { // x^-e is (x^-1)^e
+                    auto inverse = calc_val::invmod(x, m);
+                    if (!inverse)
+                        return fail(calc_parse_error::invalid_operand, identifier_token);
+                    x = *inverse;
+                }
+                r = fn->fn == invmod_fn ? x : calc_val::powmod(x, int_magnitude((*ints)[1]), m);
+            }
+            if (std::any_of(ints->begin(), ints->end(), is_uint))
+                return r;
+            return calc_val::int_type(r);
+        }
+        default:
+            return fail(calc_parse_error::internal_error, identifier_token);
+    }
+}
+
+auto calc_parser::assign_variable(const lexer_token& identifier_token, calc_val::variant_type val)
+    -> calc_val::variant_type
+{
+    ++impure_count;
+    trim_int(val);
+    if (formulas.contains(identifier_token.view)) {
+        try {
+            unbind_formula(identifier_token.view); // the variable now holds a plain value
+        } catch (const std::bad_alloc&) {
+            return fail(calc_parse_error::out_of_memory, identifier_token);
+        }
+    }
+    store_variable(identifier_token, val);
+    return val;
+}
+
+auto calc_parser::store_variable(const lexer_token& identifier_token, const calc_val::variant_type& val) -> void {
+// sets a variable and, if that changes it, recomputes the formulas that
+// depend on it
+    auto identifier = identifier_token.view;
+    auto old_val = variables.find(identifier);
+    if (old_val && *old_val == val)
+        return;
+    auto change = old_val ? variable_modified : variable_added;
+    try {
+        variables.insert_or_assign(identifier, val);
+    } catch (const std::bad_alloc&) {
+        fail(calc_parse_error::out_of_memory, identifier_token);
+        return;
+    }
+    note_variable_change(identifier, change);
+    recompute_dependents(identifier_token);
+    if (variables_changed)
+        variables_changed();
+}
+
+// productions. each is instantiated for three kinds of Value: for
+// calc_val::variant_type the productions evaluate the expression as it is
+// parsed; for node_ref they append the operations to the compiled_expr being
+// built (see compile); for validated they only parse (see validate). the
+// overloads of the operations above for node_ref are defined with compile,
+// and those for validated with validate
+
+template <typename Value>
+auto calc_parser::math_expr(lookahead_calc_lexer& lexer) -> Value {
+// <math_expr> ::= <bxor_expr> [ "|" <bxor_expr> ]...
+    auto lval = bxor_expr<Value>(lexer);
+    while (!failed()) {
+        if (lexer.peek_token().id == lexer_token::bor) {
+            auto op_token = lexer.get_token();
+            auto rval = bxor_expr<Value>(lexer);
+            if (failed())
+                break;
+            lval = binary_op(op_token, op_token.id, std::move(lval), std::move(rval));
+        } else
+            break;
+    }
+    return lval;
+}
+
+template <typename Value>
+auto calc_parser::bxor_expr(lookahead_calc_lexer& lexer) -> Value {
+// <bxor_expr> ::= <band_expr> [ "^" <band_expr> ]...
+    auto lval = band_expr<Value>(lexer);
+    while (!failed()) {
+        if (lexer.peek_token().id == lexer_token::bxor) {
+            auto op_token = lexer.get_token();
+            auto rval = band_expr<Value>(lexer);
+            if (failed())
+                break;
+            lval = binary_op(op_token, op_token.id, std::move(lval), std::move(rval));
+        } else
+            break;
+    }
+    return lval;
+}
+
+template <typename Value>
+auto calc_parser::band_expr(lookahead_calc_lexer& lexer) -> Value {
+// <band_expr> ::= <shift_expr> [ "&" <shift_expr> ]...
+    auto lval = shift_expr<Value>(lexer);
+    while (!failed()) {
+        if (lexer.peek_token().id == lexer_token::band) {
+            auto op_token = lexer.get_token();
+            auto rval = shift_expr<Value>(lexer);
+            if (failed())
+                break;
+            lval = binary_op(op_token, op_token.id, std::move(lval), std::move(rval));
+        } else
+            break;
+    }
+    return lval;
+}
+
+template <typename Value>
+auto calc_parser::shift_expr(lookahead_calc_lexer& lexer) -> Value {
+// <shift_expr> ::= <additive_expr> [ ( "<<" | ">>" ) <additive_expr> ]...
+    auto lval = additive_expr<Value>(lexer);
+    while (!failed()) {
+        if (lexer.peek_token().id == lexer_token::shiftl || lexer.peeked_token().id == lexer_token::shiftr) {
+            lexer_token op_token = lexer.get_token();
+            auto rval = additive_expr<Value>(lexer);
+            if (failed())
+                break;
+            lval = binary_op(op_token, op_token.id, std::move(lval), std::move(rval));
+        } else
+            break;
+    }
+    return lval;
+}
+
+template <typename Value>
+auto calc_parser::additive_expr(lookahead_calc_lexer& lexer) -> Value {
+// <additive_expr> ::= <term> [ ( "+" | "-" ) <term> ]...
+    auto lval = term<Value>(lexer);
+    while (!failed()) {
+        if (lexer.peek_token().id == lexer_token::add || lexer.peeked_token().id == lexer_token::sub) {
+            auto op_token = lexer.get_token();
+            auto rval = term<Value>(lexer);
+            if (failed())
+                break;
+            lval = binary_op(op_token, op_token.id, std::move(lval), std::move(rval));
+        } else
+            break;
+    }
+    return lval;
+}
+
+template <typename Value>
+auto calc_parser::term(lookahead_calc_lexer& lexer) -> Value {
+// <term> ::= <factor> [ ( "*" | "/" | "%" ) <factor> | <juxtaposed_factor> ]...
+// <justaposed_factor> ::= <number_factor> | <identifier_factor> | <group_factor> | <bnot_factor> | <help_factor>
+// note: implied multiplication (multiplication by juxtaposition) has the same
+// precedence as explicit multiplication, as it does in wolfram alpha and google
+// calculator, and as argued as being correct in this article:
+// https://mindyourdecisions.com/blog/2016/08/31/what-is-6%C3%B7212-the-correct-answer-explained/
+// note2: <help_factor> is just for proper error handling
+    auto lval = factor<Value>(lexer);
+    while (!failed()) {
+        if (lexer.peek_token().id == lexer_token::mul
+                || lexer.peeked_token().id == lexer_token::div
+                || lexer.peeked_token().id == lexer_token::mod) {
+            auto op_token = lexer.get_token();
+            auto rval = factor<Value>(lexer);
+            if (failed())
+                break;
+            lval = binary_op(op_token, op_token.id, std::move(lval), std::move(rval));
+        } else if (lexer.peeked_token().id == lexer_token::number // <number_factor>
+                || lexer.peeked_token().id == lexer_token::identifier // <identifier_factor>
+                || lexer.peeked_token().id == lexer_token::lparen // <group_factor>
+                || lexer.peeked_token().id == lexer_token::bnot// <bnot_factor>
+                || lexer.peeked_token().id == lexer_token::help) { // <help_factor>
+            auto op_token = lexer.peeked_token(); // implied "*"
+            auto rval = factor<Value>(lexer);
+            if (failed())
+                break;
+            lval = binary_op(op_token, lexer_token::mul, std::move(lval), std::move(rval));
+        } else
+            break;
+    }
+    return lval;
+}
+
+template <typename Value>
+auto calc_parser::factor(lookahead_calc_lexer& lexer) -> Value {
+// <factor> ::= "-" <number> ( <any_token> - ( <factorial_op> | "^" | "**" ) )
+//            | ( "-" | "+" | "~" ) <factor>
+//            | <base> [ <factorial_op> ]... [ "^" | "**" <factor> ]
+// <factorial_op> ::= "!" | "!!" | <mfac>
+// note: exponentiation is evaluated right-to-left.
+// Modifications here may require modifications to calc_parser::term for
+// <justaposed_factor>
+    if (lexer.peek_token().id == lexer_token::sub) { // "-'
+        auto op_token = lexer.get_token();
+
+        // special case: "-" <number> ( <any_token> - ( <factorial_op> | "^" | "**" ) )
+        // this is needed to properly negate and range check the number
+        if (lexer.peek_token().id == lexer_token::number &&
+                lexer.peek_token2().id != lexer_token::fac &&
+                lexer.peek_token2().id != lexer_token::dfac &&
+                lexer.peek_token2().id != lexer_token::mfac &&
+                lexer.peek_token2().id != lexer_token::pow)
+            return number<Value>(lexer, true);
+
+        auto val = factor<Value>(lexer);
+        if (failed())
+            return {};
+        return unary_op(op_token, op_token.id, std::move(val));
+    }
+
+    if (lexer.peek_token().id == lexer_token::add) { // "+" -- just return <factor>
+        lexer.get_token();
+        return factor<Value>(lexer);
+    }
+
+    if (lexer.peek_token().id == lexer_token::bnot) { // "~"
+        auto op_token = lexer.get_token();
+        auto val = factor<Value>(lexer);
+        if (failed())
+            return {};
+        return unary_op(op_token, op_token.id, std::move(val));
     }
 
     // <base>
 
-    auto lval = base(lexer);
+    auto lval = base<Value>(lexer);
 
     // [ <factorial_op> ]...
 
-    for (;;) {
-        if (lexer.peek_token().id == lexer_token::fac) {
+    while (!failed()) {
+        if (lexer.peek_token().id == lexer_token::fac || lexer.peeked_token().id == lexer_token::dfac) {
             auto op_token = lexer.get_token();
-            try {
-                lval = std::visit([](const auto& val) -> calc_val::variant_type {
-                    return calc_val::tgamma(val + 1);
-                }, lval);
-            } catch (calc_val::domain_real_only) {
-                throw calc_parse_error(calc_parse_error::op_domain_real_only, op_token);
-            }
-        } else if (lexer.peeked_token().id == lexer_token::dfac) {
-            auto op_token = lexer.get_token();
-            try {
-                lval = std::visit([](const auto& val) -> calc_val::complex_type {
-                    return calc_val::dfac(val);
-                }, lval);
-            } catch (calc_val::domain_real_only) {
-                throw calc_parse_error(calc_parse_error::op_domain_real_only, op_token);
-            }
-        } else if (lexer.peeked_token().id == lexer_token::mfac)
-            throw calc_parse_error(calc_parse_error::mfac_unsupported, lexer.get_token());
-        else
+            lval = unary_op(op_token, op_token.id, std::move(lval));
+        } else if (lexer.peeked_token().id == lexer_token::mfac) {
+            fail(calc_parse_error::mfac_unsupported, lexer.get_token());
+            return {};
+        } else
             break;
     }
+    if (failed())
+        return {};
 
     // [ "^" | "**" <factor> ]
 
     if (lexer.peek_token().id == lexer_token::pow) {
-        lexer.get_token();
-        lval = std::visit([&](const auto& lval, const auto& rval) -> calc_val::variant_type {
-            assert(is_nan(lval) || lval == trim_if_int(lval));
-            assert(is_nan(rval) || rval == trim_if_int(rval));
-            return trim_if_int(calc_val::pow(lval, rval));
-        }, lval, factor(lexer));
+        auto op_token = lexer.get_token();
+        auto rval = factor<Value>(lexer);
+        if (failed())
+            return {};
+        lval = binary_op(op_token, op_token.id, std::move(lval), std::move(rval));
     }
 
     return lval;
 }
 
-auto calc_parser::base(lookahead_calc_lexer& lexer) -> calc_val::variant_type {
+template <typename Value>
+auto calc_parser::base(lookahead_calc_lexer& lexer) -> Value {
 // <base> ::= <number> | <identifier_expr> | <group> | <help>
 // Modifications here may require modifications to calc_parser::term for
 // <justaposed_factor>
     if (lexer.peek_token().id == lexer_token::number)
-        return assumed_number(lexer, false);
+        return number<Value>(lexer, false);
     if (lexer.peeked_token().id == lexer_token::identifier)
-        return assumed_identifier_expr(lexer);
+        return assumed_identifier_expr<Value>(lexer);
     if (lexer.peeked_token().id == lexer_token::lparen)
-        return group(lexer);
+        return group<Value>(lexer);
     if (lexer.peeked_token().id == lexer_token::help)
-        throw calc_parse_error(calc_parse_error::help_invalid_here, lexer.peeked_token());
-    if (lexer.peeked_token().id == lexer_token::end)
-        throw calc_parse_error(calc_parse_error::unexpected_end_of_input, lexer.peeked_token());
-    throw calc_parse_error(calc_parse_error::syntax_error, lexer.peeked_token());
+        fail(calc_parse_error::help_invalid_here, lexer.peeked_token());
+    else if (lexer.peeked_token().id == lexer_token::end)
+        fail(calc_parse_error::unexpected_end_of_input, lexer.peeked_token());
+    else
+        fail(calc_parse_error::syntax_error, lexer.peeked_token());
+    return {};
 }
 
-auto calc_parser::assumed_identifier_expr(lookahead_calc_lexer& lexer) -> calc_val::variant_type {
+template <typename Value>
+auto calc_parser::assumed_identifier_expr(lookahead_calc_lexer& lexer) -> Value {
 // <identifier_expr> ::= <identifier> = <math_expr>
 //                     | <value_identifier>
 //                     | <unary_fn_identifier> <group>
+//                     | <multi_fn_identifier> <arguments>
 //                     | <undefined_identifier>
+// when compiling, an identifier that is not a variable when compiled and that
+// names an internal value other than "last" is bound to its value, and one
+// that names an internal function to the function. other identifiers are
+// looked up when the compiled expression is evaluated
+// when validating, the identifier is classified: an identifier assigned
+// earlier in the input is a variable
+    constexpr auto compiling = std::is_same_v<Value, node_ref>;
+    constexpr auto validating = std::is_same_v<Value, validated>;
+    constexpr auto evaluating = std::is_same_v<Value, calc_val::variant_type>;
+
     auto identifier_token = lexer.get_token(); // assume next token is identifier (caller assures this)
     assert(identifier_token.id == lexer_token::identifier);
     auto identifier = identifier_token.view;
@@ -563,62 +1446,1389 @@ auto calc_parser::assumed_identifier_expr(lookahead_calc_lexer& lexer) -> calc_v
 
     if (lexer.peek_token().id == lexer_token::eq) {
         lexer.get_token();
-        auto val = math_expr(lexer);
-        trim_int(val);
-        if (auto itr = variables.find(tmp_key = identifier); itr != variables.end()) {
-            if (itr->second != val) {
-                itr->second = val;
-                if (variables_changed)
-                    variables_changed();
-            }
+        auto val = math_expr<Value>(lexer);
+        if (failed())
+            return {};
+        return assign_variable(identifier_token, std::move(val));
+    }
+
+    // <value_identifier> | <unary_fn_identifier> <group> | <multi_fn_identifier> <arguments>
+
+    if (auto var = variables.find(identifier)) {
+        if constexpr (compiling) {
+            if (internals.find(identifier) != internals.end())
+                compiling_expr->note_internal(identifier, true);
+            return make_variable(identifier_token);
+        } else if constexpr (validating) {
+            classify_identifier(identifier_token, variable_class);
+            return {};
         } else {
-            variables.emplace_hint(itr, tmp_key = identifier, val);
-            if (variables_changed)
-                variables_changed();
-        }
-        return val;
-    }
-
-    // <value_identifier> | <unary_fn_identifier> <group>
-
-    if (auto itr = variables.find(tmp_key = identifier); itr != variables.end()) {
-        auto val = itr->second;
-        trim_int(val);
-        return val;
-    }
-
-    if (auto itr = internals.find(tmp_key = identifier); itr != internals.end()) {
-        auto val = std::visit([&](const auto& thing) -> calc_val::variant_type {
-            using VT = std::decay_t<decltype(thing)>;
-            if constexpr (std::is_same_v<VT, calc_val::variant_type>) // <value_identifier>
-                return thing;
-            else if constexpr (std::is_same_v<VT, unary_fn>) { // <unary_fn_variable> <group>
-                try {
-                    return std::visit([&](const auto& val) {
-                        return thing(val);
-                    }, group(lexer));
-                } catch (calc_val::domain_positive_real_only) {
-                    throw calc_parse_error(calc_parse_error::op_domain_positive_real_only, identifier_token);
-                } catch (calc_val::domain_real_only) {
-                    throw calc_parse_error(calc_parse_error::op_domain_real_only, identifier_token);
+            ++impure_count;
+            auto val = *var;
+            trim_int(val);
+            return val;
+        }
+    }
+
+    if constexpr (validating) {
+        auto& assigned = validating_state->assigned;
+        if (std::find(assigned.begin(), assigned.end(), identifier) != assigned.end()) {
+            classify_identifier(identifier_token, variable_class);
+            return {};
+        }
+    }
+    if constexpr (compiling) {
+        auto& assigned = compiling_assigned; // earlier in the expression, so a variable by now
+        if (std::find(assigned.begin(), assigned.end(), identifier) != assigned.end())
+            return make_variable(identifier_token);
+    }
+
+    if (auto itr = internals.find(identifier); itr != internals.end()) {
+        if constexpr (compiling) {
+            if (itr != last_val_pos)
+                compiling_expr->note_internal(identifier, false);
+        }
+        if (auto fn = std::get_if<const identifier_with_unary_fn*>(&itr->second)) { // <unary_fn_variable> <group>
+            if constexpr (validating)
+                classify_identifier(identifier_token, function_class);
+            auto begin = lexer.buffer_index() - 1; // the identifier's, when evaluating incrementally
+            auto impure_count_before = impure_count;
+            if constexpr (evaluating) {
+                if (incremental && lexer.peek_token().id == lexer_token::lparen) {
+                    if (auto val = reuse_value(lexer, begin))
+                        return *val;
                 }
             }
-        }, itr->second);
-        trim_int(val);
-        return val;
+            auto arg = group<Value>(lexer);
+            if (failed())
+                return {};
+            auto val = call_fn(identifier_token, *fn, std::move(arg));
+            if constexpr (evaluating) {
+                if (incremental && !failed())
+                    keep_value(lexer, begin, impure_count_before, val);
+            }
+            return val;
+        }
+        if (auto fn = std::get_if<const identifier_with_multi_fn*>(&itr->second)) { // <multi_fn_identifier> <arguments>
+            if constexpr (validating)
+                classify_identifier(identifier_token, function_class);
+            auto begin = lexer.buffer_index() - 1;
+            auto impure_count_before = impure_count;
+            if constexpr (evaluating) {
+                if (incremental && lexer.peek_token().id == lexer_token::lparen) {
+                    if (auto val = reuse_value(lexer, begin))
+                        return *val;
+                }
+            }
+            auto args = arguments<Value>(lexer, *fn);
+            if (failed())
+                return {};
+            auto val = call_fn(identifier_token, *fn, std::span<const Value>(args));
+            if constexpr (evaluating) {
+                if (incremental && !failed())
+                    keep_value(lexer, begin, impure_count_before, val);
+            }
+            return val;
+        }
+        if constexpr (compiling) {
+            if (itr == last_val_pos)
+                return make_variable(identifier_token);
+        }
+        if constexpr (validating) {
+            classify_identifier(identifier_token, itr == last_val_pos ? variable_class : constant_class);
+            return {};
+        } else {
+            if constexpr (evaluating) {
+                if (itr == last_val_pos)
+                    ++impure_count;
+            }
+            auto val = std::get<calc_val::variant_type>(itr->second); // <value_identifier>
+            trim_int(val);
+            if constexpr (compiling)
+                return make_constant(std::move(val));
+            else
+                return val;
+        }
     }
 
     // <undefined_identifier>
 
-    throw calc_parse_error(calc_parse_error::undefined_identifier, identifier_token);
+    if constexpr (compiling)
+        return make_variable(identifier_token); // may be assigned before it's evaluated
+    else {
+        if constexpr (validating)
+            classify_identifier(identifier_token, undefined_class);
+        fail(calc_parse_error::undefined_identifier, identifier_token);
+        return {};
+    }
 }
 
-auto calc_parser::group(lookahead_calc_lexer& lexer) -> calc_val::variant_type {
+template <typename Value>
+auto calc_parser::group(lookahead_calc_lexer& lexer) -> Value {
 // <group> ::= "(" <math_expr> ")"
-    if (lexer.get_token().id != lexer_token::lparen)
-        throw calc_parse_error(calc_parse_error::token_expected, lexer.last_token(), lexer_token::lparen);
-    auto val = math_expr(lexer);
-    if (lexer.get_token().id != lexer_token::rparen)
-        throw calc_parse_error(calc_parse_error::token_expected, lexer.last_token(), lexer_token::rparen);
+// when evaluating incrementally, the group's value may be reused or kept
+    constexpr auto evaluating = std::is_same_v<Value, calc_val::variant_type>;
+    auto begin = lexer.buffer_index();
+    auto impure_count_before = impure_count;
+    if constexpr (evaluating) {
+        if (incremental && lexer.peek_token().id == lexer_token::lparen) {
+            if (auto val = reuse_value(lexer, begin))
+                return *val;
+        }
+    }
+
+    if (lexer.get_token().id != lexer_token::lparen) {
+        fail(calc_parse_error::token_expected, lexer.last_token(), lexer_token::lparen);
+        return {};
+    }
+    auto val = math_expr<Value>(lexer);
+    if (failed())
+        return {};
+    if (lexer.get_token().id != lexer_token::rparen) {
+        fail(calc_parse_error::token_expected, lexer.last_token(), lexer_token::rparen);
+        return {};
+    }
+    if constexpr (evaluating) {
+        if (incremental)
+            keep_value(lexer, begin, impure_count_before, val);
+    }
     return val;
 }
+
+template <typename Value>
+auto calc_parser::arguments(lookahead_calc_lexer& lexer, const identifier_with_multi_fn* fn) -> std::vector<Value> {
+// <arguments> ::= "(" <math_expr> [ "," <math_expr> ]... ")"
+// the number of arguments must be within fn's limits
+    if (lexer.get_token().id != lexer_token::lparen) {
+        fail(calc_parse_error::token_expected, lexer.last_token(), lexer_token::lparen);
+        return {};
+    }
+    auto args = std::vector<Value>();
+    for (;;) {
+        args.push_back(math_expr<Value>(lexer));
+        if (failed())
+            return {};
+        auto id = lexer.get_token().id;
+        if (id == lexer_token::comma && args.size() < fn->max_args)
+            continue;
+        if (id == lexer_token::rparen && args.size() >= fn->min_args)
+            return args;
+        fail(calc_parse_error::token_expected, lexer.last_token(),
+            args.size() < fn->min_args ? lexer_token::comma : lexer_token::rparen);
+        return {};
+    }
+}
+
+template <typename Value>
+auto calc_parser::number(lookahead_calc_lexer& lexer, bool is_negative) -> Value {
+    if constexpr (std::is_same_v<Value, node_ref>) {
+        auto val = assumed_number(lexer, is_negative);
+        if (failed())
+            return {};
+        return make_constant(std::move(val));
+    } else if constexpr (std::is_same_v<Value, validated>) {
+        validate_number(lexer, is_negative);
+        return {};
+    } else
+        return assumed_number(lexer, is_negative);
+}
+
+auto calc_parser::variable_value(const lexer_token& identifier_token) -> calc_val::variant_type {
+// value of a variable, or of an internal value, of a compiled expression
+    if (auto val = stored_value(identifier_token.view)) {
+        auto trimmed = *val;
+        trim_int(trimmed);
+        return trimmed;
+    }
+    return fail(calc_parse_error::undefined_identifier, identifier_token);
+}
+
+auto calc_parser::stored_value(std::string_view identifier) const -> const calc_val::variant_type* {
+    if (auto var = variables.find(identifier))
+        return var;
+    if (auto itr = internals.find(identifier); itr != internals.end())
+        return std::get_if<calc_val::variant_type>(&itr->second);
+    return nullptr;
+}
+
+// compiling
+
+auto calc_parser::compiled_expr::note_internal(std::string_view identifier, bool shadowed) -> void {
+    auto itr = std::find_if(internals_.begin(), internals_.end(), [&](const auto& elem) {return elem.first == identifier;});
+    if (itr == internals_.end())
+        internals_.emplace_back(identifier, shadowed);
+}
+
+auto calc_parser::compiled_expr::add_node(node_kinds kind, const lexer_token& token) -> node& {
+    auto& n = nodes.emplace_back();
+    n.kind = kind;
+    n.token_id = token.id;
+    n.token_offset = token.view_offset;
+    n.token_length = token.view.size();
+    return n;
+}
+
+auto calc_parser::binary_op(const lexer_token& op_token, lexer_token::token_ids op, node_ref lval, node_ref rval)
+    -> node_ref
+{
+    auto& n = compiling_expr->add_node(compiled_expr::binary_kind, op_token);
+    n.op = op;
+    n.lhs = lval.index;
+    n.rhs = rval.index;
+    return node_ref{compiling_expr->nodes.size() - 1};
+}
+
+auto calc_parser::unary_op(const lexer_token& op_token, lexer_token::token_ids op, node_ref val) -> node_ref {
+    auto& n = compiling_expr->add_node(compiled_expr::unary_kind, op_token);
+    n.op = op;
+    n.lhs = val.index;
+    return node_ref{compiling_expr->nodes.size() - 1};
+}
+
+auto calc_parser::call_fn(const lexer_token& identifier_token, const identifier_with_unary_fn* fn, node_ref arg)
+    -> node_ref
+{
+    auto& n = compiling_expr->add_node(compiled_expr::call_kind, identifier_token);
+    n.fn = fn;
+    n.lhs = arg.index;
+    return node_ref{compiling_expr->nodes.size() - 1};
+}
+
+auto calc_parser::call_fn(const lexer_token& identifier_token, const identifier_with_multi_fn* fn,
+    std::span<const node_ref> args) -> node_ref
+{
+    auto& n = compiling_expr->add_node(compiled_expr::multi_call_kind, identifier_token);
+    n.multi_fn = fn;
+    for (auto arg : args)
+        n.args.push_back(arg.index);
+    return node_ref{compiling_expr->nodes.size() - 1};
+}
+
+auto calc_parser::assign_variable(const lexer_token& identifier_token, node_ref val) -> node_ref {
+    compiling_assigned.push_back(identifier_token.view);
+    auto& n = compiling_expr->add_node(compiled_expr::assign_kind, identifier_token);
+    n.lhs = val.index;
+    return node_ref{compiling_expr->nodes.size() - 1};
+}
+
+auto calc_parser::make_variable(const lexer_token& identifier_token) -> node_ref {
+    compiling_expr->add_node(compiled_expr::variable_kind, identifier_token);
+    return node_ref{compiling_expr->nodes.size() - 1};
+}
+
+auto calc_parser::make_constant(calc_val::variant_type val) -> node_ref {
+    auto& n = compiling_expr->add_node(compiled_expr::constant_kind, lexer_token{});
+    n.value = std::move(val);
+    return node_ref{compiling_expr->nodes.size() - 1};
+}
+
+auto calc_parser::compile(std::string_view input) -> compiled_expr {
+    auto expr = compiled_expr();
+    expr.source_ = input;
+    compile_into(expr, input);
+    if (failed()) {
+        auto error = std::move(*parse_error);
+        parse_error.reset();
+        throw error;
+    }
+    return expr;
+}
+
+auto calc_parser::compile_into(compiled_expr& expr, std::string_view input) -> void {
+// compiles input, which is expr.source_ or a view of the same text, into
+// expr. a parse error is recorded if compiling fails
+    expr.options_ = options();
+    expr.nodes.clear();
+    expr.internals_.clear();
+    expr.engine_ = compiled_expr::complex_engine;
+    expr.plan_.clear();
+    parse_error.reset();
+
+    compiling_expr = &expr;
+    compiling_assigned.clear();
+    auto lexer = lookahead_calc_lexer(input, default_number_radix);
+    auto root = math_expr<node_ref>(lexer);
+    compiling_expr = nullptr;
+    if (failed())
+        return;
+    if (lexer.peek_token().id == lexer_token::option) {
+        fail(calc_parse_error::option_must_preface_math_expr, lexer.peeked_token());
+        return;
+    }
+    if (lexer.get_token().id != lexer_token::end) {
+        fail(calc_parse_error::syntax_error, lexer.last_token());
+        return;
+    }
+
+    optimize(expr, root);
+    plan(expr);
+}
+
+static auto identical(const calc_val::variant_type& x, const calc_val::variant_type& y) -> bool {
+// unlike ==, distinguishes 0 and -0 (which may lead to different results)
+    if (x.index() != y.index() || x != y)
+        return false;
+    if (auto cx = std::get_if<calc_val::complex_type>(&x)) {
+        auto& cy = std::get<calc_val::complex_type>(y);
+        return signbit(cx->real()) == signbit(cy.real()) && signbit(cx->imag()) == signbit(cy.imag());
+    }
+    return true;
+}
+
+static auto value_hash(const calc_val::variant_type& x) -> std::size_t {
+    return std::visit([](const auto& x) -> std::size_t {
+        if constexpr (calc_val::is_complex_type<decltype(x)>())
+            return std::hash<calc_val::float_type>()(x.real()) * 31 + std::hash<calc_val::float_type>()(x.imag());
+        else
+            return std::hash<std::decay_t<decltype(x)>>()(x);
+    }, x) * 3 + x.index();
+}
+
+auto calc_parser::optimize(compiled_expr& expr, node_ref root) -> void {
+// folds operations whose operands are all constant, unless that fails (the
+// error is then reported when the expression is evaluated). shares nodes that
+// are identical and pure (don't depend on a variable assigned in the
+// expression). drops the nodes that are no longer used
+    using node = compiled_expr::node;
+    auto& nodes = expr.nodes;
+    auto assigned = std::set<std::string_view>();
+    for (auto& n : nodes)
+        if (n.kind == compiled_expr::assign_kind)
+            assigned.insert(expr.token(n).view);
+    auto optimized = std::vector<node>();
+    optimized.reserve(nodes.size());
+    auto new_index = std::vector<std::size_t>(nodes.size());
+    auto pure = std::vector<bool>();
+    pure.reserve(nodes.size());
+    auto shared = std::unordered_multimap<std::size_t, std::size_t>(); // node hash, index in optimized
+
+    auto is_constant = [&](std::size_t index) {return optimized[index].kind == compiled_expr::constant_kind;};
+    auto same = [&](const node& x, const node& y) {
+        if (x.kind != y.kind || x.op != y.op || x.lhs != y.lhs || x.rhs != y.rhs || x.fn != y.fn)
+            return false;
+        if (x.multi_fn != y.multi_fn || x.args != y.args)
+            return false;
+        if (x.kind == compiled_expr::constant_kind)
+            return identical(x.value, y.value);
+        if (x.kind == compiled_expr::variable_kind)
+            return expr.token(x).view == expr.token(y).view;
+        return true;
+    };
+    auto hash = [&](const node& n) {
+        auto h = std::size_t(n.kind) * 31 + n.op;
+        h = h * 31 + n.lhs;
+        h = h * 31 + n.rhs;
+        h = h * 31 + std::hash<const void*>()(n.fn);
+        h = h * 31 + std::hash<const void*>()(n.multi_fn);
+        for (auto arg : n.args)
+            h = h * 31 + arg;
+        if (n.kind == compiled_expr::constant_kind)
+            h = h * 31 + value_hash(n.value);
+        else if (n.kind == compiled_expr::variable_kind)
+            h = h * 31 + std::hash<std::string_view>()(expr.token(n).view);
+        return h;
+    };
+
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        auto n = std::move(nodes[i]);
+        auto is_pure = true;
+        switch (n.kind) {
+            case compiled_expr::constant_kind:
+                break;
+            case compiled_expr::variable_kind:
+                is_pure = !assigned.count(expr.token(n).view);
+                break;
+            case compiled_expr::assign_kind:
+                n.lhs = new_index[n.lhs];
+                is_pure = false;
+                break;
+            case compiled_expr::binary_kind:
+                n.lhs = new_index[n.lhs];
+                n.rhs = new_index[n.rhs];
+                is_pure = pure[n.lhs] && pure[n.rhs];
+                if (is_constant(n.lhs) && is_constant(n.rhs)) {
+                    auto val = binary_op(expr.token(n), n.op, optimized[n.lhs].value, optimized[n.rhs].value);
+                    if (!failed()) {
+                        n.kind = compiled_expr::constant_kind;
+                        n.lhs = n.rhs = 0;
+                        n.op = lexer_token::unspecified;
+                        n.value = std::move(val);
+                    }
+                }
+                break;
+            case compiled_expr::unary_kind:
+            case compiled_expr::call_kind:
+                n.lhs = new_index[n.lhs];
+                is_pure = pure[n.lhs];
+                if (is_constant(n.lhs)) {
+                    auto val = n.kind == compiled_expr::unary_kind
+                        ? unary_op(expr.token(n), n.op, optimized[n.lhs].value)
+                        : call_fn(expr.token(n), n.fn, optimized[n.lhs].value);
+                    if (!failed()) {
+                        n.kind = compiled_expr::constant_kind;
+                        n.lhs = 0;
+                        n.op = lexer_token::unspecified;
+                        n.fn = nullptr;
+                        n.value = std::move(val);
+                    }
+                }
+                break;
+            case compiled_expr::multi_call_kind:
+                for (auto& arg : n.args)
+                    arg = new_index[arg];
+                is_pure = std::all_of(n.args.begin(), n.args.end(), [&](auto arg) {return bool(pure[arg]);});
+                if (std::all_of(n.args.begin(), n.args.end(), is_constant)) {
+                    auto vals = std::vector<calc_val::variant_type>();
+                    for (auto arg : n.args)
+                        vals.push_back(optimized[arg].value);
+                    auto val = call_fn(expr.token(n), n.multi_fn, std::span<const calc_val::variant_type>(vals));
+                    if (!failed()) {
+                        n.kind = compiled_expr::constant_kind;
+                        n.multi_fn = nullptr;
+                        n.args.clear();
+                        n.value = std::move(val);
+                    }
+                }
+                break;
+        }
+        parse_error.reset();
+
+        if (is_pure) {
+            auto h = hash(n);
+            auto [first, last] = shared.equal_range(h);
+            auto itr = std::find_if(first, last, [&](const auto& elem) {return same(optimized[elem.second], n);});
+            if (itr != last) {
+                new_index[i] = itr->second;
+                continue;
+            }
+            shared.emplace(h, optimized.size());
+        }
+        new_index[i] = optimized.size();
+        optimized.push_back(std::move(n));
+        pure.push_back(is_pure);
+    }
+
+    // drop unused nodes (operands of folded operations)
+
+    auto used = std::vector<bool>(optimized.size());
+    used[new_index[root.index]] = true;
+    for (auto i = optimized.size(); i-- > 0;) {
+        if (!used[i])
+            continue;
+        auto& n = optimized[i];
+        if (n.kind == compiled_expr::assign_kind || n.kind == compiled_expr::unary_kind || n.kind == compiled_expr::call_kind)
+            used[n.lhs] = true;
+        else if (n.kind == compiled_expr::binary_kind)
+            used[n.lhs] = used[n.rhs] = true;
+        for (auto arg : n.args)
+            used[arg] = true;
+    }
+    auto compacted_index = std::vector<std::size_t>(optimized.size());
+    nodes.clear();
+    for (std::size_t i = 0; i < optimized.size(); ++i) {
+        if (!used[i])
+            continue;
+        auto& n = optimized[i];
+        n.lhs = compacted_index[n.lhs];
+        n.rhs = compacted_index[n.rhs];
+        for (auto& arg : n.args)
+            arg = compacted_index[arg];
+        compacted_index[i] = nodes.size();
+        nodes.push_back(std::move(n));
+    }
+    // the root is the last node used
+}
+
+auto calc_parser::shadowing_changed(const compiled_expr& expr) const -> bool {
+// whether a variable now shadows an internal identifier of expr that it
+// didn't when expr was compiled, or no longer shadows one that it did
+    return std::any_of(expr.internals_.begin(), expr.internals_.end(), [&](const auto& elem) {
+        return variables.contains(elem.first) != elem.second;
+    });
+}
+
+// planning
+
+enum value_kinds {int_kind, uint_kind, real_kind, other_kind};
+// the kinds of values of the int and real engines (other_kind is for the
+// complex engine)
+
+static auto is_real_operand(const calc_val::float_type& x) -> bool
+{return x != 0 && isfinite(x);}
+
+static auto value_kind(const calc_val::variant_type& x, calc_val::int_word_sizes int_word_size) -> value_kinds {
+    if (std::holds_alternative<calc_val::int_type>(x) && int_word_size <= calc_val::int_bits_128)
+        return int_kind;
+    if (std::holds_alternative<calc_val::uint_type>(x) && int_word_size <= calc_val::int_bits_128)
+        return uint_kind;
+    auto z = std::get_if<calc_val::complex_type>(&x);
+    return z && z->imag() == 0 && is_real_operand(z->real()) ? real_kind : other_kind;
+}
+
+static auto is_int_kind(value_kinds kind) -> bool
+{return kind == int_kind || kind == uint_kind;}
+
+auto calc_parser::plan(compiled_expr& expr) const -> void {
+// chooses the int engine if all the values of expr are ints and uints (of
+// words of up to 128 bits) and all its operations integer operations other
+// than >> of a uint, the real engine if all its values are real, finite and
+// not 0 and all its operations are +, -, *, / and functions with a real
+// overload, and otherwise the complex engine. variables are assumed to hold
+// values of the kinds they hold now
+    auto& nodes = expr.nodes;
+    auto kinds = std::vector<value_kinds>(nodes.size(), other_kind);
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        auto& n = nodes[i];
+        switch (n.kind) {
+            case compiled_expr::constant_kind:
+                kinds[i] = value_kind(n.value, int_word_size);
+                break;
+            case compiled_expr::variable_kind:
+                if (auto val = stored_value(expr.token(n).view))
+                    kinds[i] = value_kind(*val, int_word_size);
+                break;
+            case compiled_expr::unary_kind:
+                if (n.op == lexer_token::sub || (n.op == lexer_token::bnot && is_int_kind(kinds[n.lhs])))
+                    kinds[i] = kinds[n.lhs];
+                break;
+            case compiled_expr::binary_kind: {
+                auto l = kinds[n.lhs], r = kinds[n.rhs];
+                auto ints = is_int_kind(l) && is_int_kind(r);
+                auto common = l == int_kind && r == int_kind ? int_kind : uint_kind; // as int op uint is uint
+                switch (n.op) {
+                    case lexer_token::add:
+                    case lexer_token::sub:
+                    case lexer_token::mul:
+                    case lexer_token::div:
+                        if (l == real_kind && r == real_kind)
+                            kinds[i] = real_kind;
+                        else if (ints)
+                            kinds[i] = common;
+                        break;
+                    case lexer_token::mod:
+                    case lexer_token::band:
+                    case lexer_token::bor:
+                    case lexer_token::bxor:
+                        if (ints)
+                            kinds[i] = common;
+                        break;
+                    case lexer_token::shiftl:
+                    case lexer_token::pow:
+                        if (ints)
+                            kinds[i] = l;
+                        break;
+                    case lexer_token::shiftr:
+                        if (ints && l == int_kind)
+                            kinds[i] = int_kind;
+                        break;
+                    default:
+                        break;
+                }
+                break;
+            }
+            case compiled_expr::call_kind:
+                if (is_int_kind(kinds[n.lhs]) && n.fn->int_fn)
+                    kinds[i] = kinds[n.lhs];
+                else if (kinds[n.lhs] == real_kind && n.fn->fn && n.fn->real_fn)
+                    kinds[i] = real_kind;
+                break;
+            case compiled_expr::assign_kind:
+            case compiled_expr::multi_call_kind:
+                break;
+        }
+    }
+
+    auto describe = [&](const compiled_expr::node& n) {
+        auto token = expr.token(n);
+        return "'" + std::string(token.view) + "' at " + std::to_string(token.view_offset);
+    };
+    auto node_count = std::to_string(nodes.size()) + (nodes.size() == 1 ? " node" : " nodes");
+    auto variables_note = std::string();
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        if (nodes[i].kind == compiled_expr::variable_kind)
+            variables_note += (variables_note.empty() ? "; assumes " : ", ") + std::string(expr.token(nodes[i]).view)
+                + (kinds[i] == int_kind ? " is an int" : kinds[i] == uint_kind ? " is a uint" : " is real");
+    }
+
+    auto other = std::find(kinds.begin(), kinds.end(), other_kind);
+    if (other == kinds.end() && std::all_of(kinds.begin(), kinds.end(), is_int_kind)) {
+        for (std::size_t i = 0; i < nodes.size(); ++i)
+            nodes[i].is_signed = kinds[i] == int_kind;
+        expr.engine_ = compiled_expr::int_engine;
+        expr.plan_ = "int engine: " + node_count + ", "
+            + std::to_string(int_word_size) + "-bit words" + variables_note;
+        return;
+    }
+    if (other == kinds.end() && std::all_of(kinds.begin(), kinds.end(), [](auto kind) {return kind == real_kind;})) {
+        expr.engine_ = compiled_expr::real_engine;
+        expr.plan_ = "real engine: " + node_count + variables_note;
+        return;
+    }
+
+    expr.engine_ = compiled_expr::complex_engine;
+    expr.plan_ = "complex engine: ";
+    if (other == kinds.end()) {
+        expr.plan_ += "integers and real numbers are mixed";
+        return;
+    }
+    auto& n = nodes[other - kinds.begin()];
+    auto is_wide = [](const calc_val::variant_type* val) {return val && val->index() >= 3;};
+    switch (n.kind) {
+        case compiled_expr::constant_kind:
+            expr.plan_ += is_wide(&n.value) ? "a constant is an integer of more than 128 bits"
+                : "a constant isn't an integer or a real number other than 0, inf and nan";
+            break;
+        case compiled_expr::variable_kind: {
+            auto val = stored_value(expr.token(n).view);
+            expr.plan_ += describe(n) + (!val ? " is undefined" : is_wide(val) ? " is an integer of more than 128 bits"
+                : " isn't an integer or a real number other than 0, inf and nan");
+            break;
+        }
+        case compiled_expr::assign_kind:
+            expr.plan_ += describe(n) + " is assigned";
+            break;
+        case compiled_expr::multi_call_kind:
+            expr.plan_ += describe(n) + " takes a list of arguments";
+            break;
+        case compiled_expr::binary_kind:
+            if (is_int_kind(kinds[n.lhs]) != is_int_kind(kinds[n.rhs])) {
+                expr.plan_ += describe(n) + " has an integer and a real operand";
+                break;
+            }
+            [[fallthrough]];
+        default:
+            expr.plan_ += describe(n) + " isn't performed by the int or real engine";
+    }
+}
+
+auto calc_parser::run_ints(const compiled_expr& expr) -> std::optional<calc_val::variant_type> {
+// the int engine: the value of a node is the bits of an int or of a uint, as
+// the node's is_signed says, and the operations are those of apply_binary_op,
+// apply_unary_op and apply_fn for ints and uints. an operation that would
+// fail is left to the complex engine, which reports the error
+    auto& nodes = expr.nodes;
+    auto buf = std::array<std::byte, 2048>();
+    auto arena = std::pmr::monotonic_buffer_resource(buf.data(), buf.size(), memory->counter.upstream_resource());
+    auto vals = std::pmr::vector<calc_val::uint_type>(nodes.size(), &arena);
+    auto typed = [&](std::size_t index, auto fn) {
+    // fn of the value of node index as an int or as a uint
+        return nodes[index].is_signed ? fn(calc_val::int_type(vals[index])) : fn(vals[index]);
+    };
+
+    auto binary_op = [&](lexer_token::token_ids op, auto lval, auto rval) -> std::optional<calc_val::uint_type> {
+        using LVT = decltype(lval);
+        if constexpr (calc_val::is_signed_int_type<decltype(rval)>()) {
+            if ((op == lexer_token::shiftl || op == lexer_token::shiftr) && rval < 0)
+                return std::nullopt;
+        }
+        switch (op) {
+            case lexer_token::bor:
+                return lval | rval;
+            case lexer_token::bxor:
+                return lval ^ rval;
+            case lexer_token::band:
+                return lval & rval;
+            case lexer_token::shiftl:
+                return rval < int_word_size ? trim_if_int(lval << rval) : LVT(0);
+            case lexer_token::shiftr:
+                if constexpr (calc_val::is_signed_int_type<LVT>())
+                    return rval < int_word_size ? lval >> rval : lval < 0 ? LVT(-1) : LVT(0);
+                else
+                    return std::nullopt; // not planned
+            case lexer_token::add:
+                return trim_if_int(lval + rval);
+            case lexer_token::sub:
+                return trim_if_int(lval - rval);
+            case lexer_token::mul:
+                return trim_if_int(lval * rval);
+            case lexer_token::div:
+                if (rval == 0)
+                    return std::nullopt;
+                return trim_if_int(lval / rval);
+            case lexer_token::mod:
+                if (rval == 0)
+                    return std::nullopt;
+                return trim_if_int(lval % rval);
+            case lexer_token::pow:
+                return trim_if_int(calc_val::pow(lval, rval));
+            default:
+                return std::nullopt; // not planned
+        }
+    };
+
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        auto& n = nodes[i];
+        switch (n.kind) {
+            case compiled_expr::constant_kind:
+                vals[i] = n.is_signed ? calc_val::uint_type(std::get<calc_val::int_type>(n.value))
+                    : std::get<calc_val::uint_type>(n.value);
+                break;
+            case compiled_expr::variable_kind: {
+                auto val = stored_value(expr.token(n).view);
+                if (auto x = val && n.is_signed ? std::get_if<calc_val::int_type>(val) : nullptr)
+                    vals[i] = calc_val::uint_type(trim_if_int(*x));
+                else if (auto x = val && !n.is_signed ? std::get_if<calc_val::uint_type>(val) : nullptr)
+                    vals[i] = trim_if_int(*x);
+                else
+                    return std::nullopt;
+                break;
+            }
+            case compiled_expr::unary_kind:
+                vals[i] = typed(n.lhs, [&](auto val) -> calc_val::uint_type {
+                    return n.op == lexer_token::sub ? trim_if_int(-val) : trim_if_int(~val);
+                });
+                break;
+            case compiled_expr::binary_kind: {
+                auto val = typed(n.lhs, [&](auto lval) {
+                    return typed(n.rhs, [&](auto rval) {return binary_op(n.op, lval, rval);});
+                });
+                if (!val)
+                    return std::nullopt;
+                vals[i] = *val;
+                break;
+            }
+            case compiled_expr::call_kind: {
+                if (n.fn->domain == positive_real_domain && nodes[n.lhs].is_signed && calc_val::int_type(vals[n.lhs]) < 0)
+                    return std::nullopt;
+                vals[i] = typed(n.lhs, [&](auto val) -> calc_val::uint_type {
+                    using VT = decltype(val);
+                    return trim_if_int(VT(n.fn->int_fn(trim_if_int(calc_val::uint_type(val)), int_word_size)));
+                });
+                check_cancellation(expr.token(n));
+                if (failed())
+                    return calc_val::variant_type();
+                break;
+            }
+            default:
+                return std::nullopt; // not planned
+        }
+    }
+    if (nodes.back().is_signed)
+        return calc_val::int_type(vals.back());
+    return vals.back();
+}
+
+namespace {
+
+struct zero_signs {
+// the sign bits of the 0 imaginary parts of the complex engine's values for
+// operands a + bi and c + di, where a and c are real, finite and not 0 and b
+// and d are 0 or -0; they depend only on the signs of a, b, c and d, so they
+// are found once, by performing the operations on +-1 +-0i
+    bool neg[2]; // [b]
+    bool add[2][2]; // [b][d]
+    bool sub[2][2];
+    bool mul[2][2][2][2]; // [a][b][c][d]
+    bool div[2][2][2][2];
+    calc_val::float_type zeros[2]; // 0 and -0
+
+    zero_signs() {
+        zeros[0] = 0;
+        zeros[1] = -zeros[0];
+        auto z = [&](int real_sign, int imag_sign)
+        {return calc_val::complex_type(calc_val::float_type(real_sign ? -1 : 1), zeros[imag_sign]);};
+        auto sign = [](const calc_val::complex_type& x) -> bool {return signbit(x.imag());};
+        for (int b = 0; b < 2; ++b) {
+            neg[b] = sign(-z(0, b));
+            for (int d = 0; d < 2; ++d) {
+                add[b][d] = sign(z(0, b) + z(0, d));
+                sub[b][d] = sign(z(0, b) - z(0, d));
+                for (int a = 0; a < 2; ++a) {
+                    for (int c = 0; c < 2; ++c) {
+                        mul[a][b][c][d] = sign(z(a, b) * z(c, d));
+                        div[a][b][c][d] = sign(z(a, b) / z(c, d));
+                    }
+                }
+            }
+        }
+    }
+};
+
+} // namespace
+
+auto calc_parser::run_reals(const compiled_expr& expr) -> std::optional<calc_val::variant_type> {
+// the real engine: the value of a node is the real part of the complex
+// engine's value and the sign of its imaginary part, which is 0. as long as
+// the real parts are finite and not 0, the real part of a complex sum,
+// difference, product or quotient is the sum, difference, product or quotient
+// of the real parts (the imaginary parts only add 0s to it) and the sign of
+// the imaginary part is that of zero_signs. functions are applied by real_fn,
+// which gives both
+    static const auto signs = zero_signs();
+    auto& nodes = expr.nodes;
+    auto buf = std::array<std::byte, 4096>();
+    auto arena = std::pmr::monotonic_buffer_resource(buf.data(), buf.size(), memory->counter.upstream_resource());
+    auto vals = std::pmr::vector<calc_val::float_type>(nodes.size(), &arena);
+    auto imag_signs = std::pmr::vector<bool>(nodes.size(), false, &arena);
+    auto real_sign = [&](std::size_t index) -> bool {return vals[index] < 0;};
+
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        auto& n = nodes[i];
+        switch (n.kind) {
+            case compiled_expr::constant_kind:
+            case compiled_expr::variable_kind: {
+                auto val = n.kind == compiled_expr::constant_kind ? &n.value : stored_value(expr.token(n).view);
+                auto z = val ? std::get_if<calc_val::complex_type>(val) : nullptr;
+                if (!z || z->imag() != 0)
+                    return std::nullopt;
+                vals[i] = z->real();
+                imag_signs[i] = signbit(z->imag());
+                break;
+            }
+            case compiled_expr::unary_kind:
+                vals[i] = -vals[n.lhs];
+                imag_signs[i] = signs.neg[imag_signs[n.lhs]];
+                break;
+            case compiled_expr::binary_kind: {
+                auto a = real_sign(n.lhs), b = bool(imag_signs[n.lhs]);
+                auto c = real_sign(n.rhs), d = bool(imag_signs[n.rhs]);
+                switch (n.op) {
+                    case lexer_token::add:
+                        vals[i] = vals[n.lhs] + vals[n.rhs];
+                        imag_signs[i] = signs.add[b][d];
+                        break;
+                    case lexer_token::sub:
+                        vals[i] = vals[n.lhs] - vals[n.rhs];
+                        imag_signs[i] = signs.sub[b][d];
+                        break;
+                    case lexer_token::mul:
+                        vals[i] = vals[n.lhs] * vals[n.rhs];
+                        imag_signs[i] = signs.mul[a][b][c][d];
+                        break;
+                    case lexer_token::div:
+                        vals[i] = vals[n.lhs] / vals[n.rhs];
+                        imag_signs[i] = signs.div[a][b][c][d];
+                        break;
+                    default:
+                        return std::nullopt; // not planned
+                }
+                break;
+            }
+            case compiled_expr::call_kind:
+                if (n.fn->domain == positive_real_domain && vals[n.lhs] < 0)
+                    return std::nullopt;
+                if (auto z = real_fn_value(n.fn, vals[n.lhs], imag_signs[n.lhs])) {
+                    vals[i] = z->real();
+                    imag_signs[i] = signbit(z->imag());
+                } else
+                    return std::nullopt;
+                check_cancellation(expr.token(n));
+                if (failed())
+                    return calc_val::variant_type();
+                break;
+            default:
+                return std::nullopt; // not planned
+        }
+        if (!is_real_operand(vals[i]))
+            return std::nullopt;
+    }
+    return calc_val::complex_type(vals.back(), signs.zeros[imag_signs.back()]);
+}
+
+auto calc_parser::run(const compiled_expr& expr) -> calc_val::variant_type {
+// performs the operations of expr, with the engine chosen by plan or else
+// with the complex engine. the values of the nodes are temporaries of the
+// evaluation and live in an arena released as a whole on return
+    auto& nodes = expr.nodes;
+    assert(!nodes.empty());
+    switch (expr.engine_) {
+        case compiled_expr::int_engine:
+            if (auto val = run_ints(expr))
+                return std::move(*val);
+            break;
+        case compiled_expr::real_engine:
+            if (auto val = run_reals(expr))
+                return std::move(*val);
+            break;
+        case compiled_expr::complex_engine:
+            break;
+    }
+
+    auto buf = std::array<std::byte, 4096>();
+    auto arena = std::pmr::monotonic_buffer_resource(buf.data(), buf.size(), memory->counter.upstream_resource());
+    auto vals = std::pmr::vector<calc_val::variant_type>(nodes.size(), &arena);
+    auto operand = [&](std::size_t index) -> const calc_val::variant_type& {
+        return nodes[index].kind == compiled_expr::constant_kind ? nodes[index].value : vals[index];
+    };
+
+    for (std::size_t i = 0; i < nodes.size(); ++i) {
+        auto& n = nodes[i];
+        switch (n.kind) {
+            case compiled_expr::constant_kind:
+                break;
+            case compiled_expr::variable_kind:
+                vals[i] = variable_value(expr.token(n));
+                break;
+            case compiled_expr::assign_kind:
+                vals[i] = assign_variable(expr.token(n), operand(n.lhs));
+                break;
+            case compiled_expr::unary_kind:
+                vals[i] = unary_op(expr.token(n), n.op, operand(n.lhs));
+                break;
+            case compiled_expr::binary_kind:
+                vals[i] = binary_op(expr.token(n), n.op, operand(n.lhs), operand(n.rhs));
+                break;
+            case compiled_expr::call_kind:
+                vals[i] = call_fn(expr.token(n), n.fn, operand(n.lhs));
+                break;
+            case compiled_expr::multi_call_kind: {
+                auto args = std::vector<calc_val::variant_type>();
+                args.reserve(n.args.size());
+                for (auto arg : n.args)
+                    args.push_back(operand(arg));
+                vals[i] = call_fn(expr.token(n), n.multi_fn, std::span<const calc_val::variant_type>(args));
+                break;
+            }
+        }
+        if (failed())
+            return {};
+    }
+    return operand(nodes.size() - 1);
+}
+
+auto calc_parser::evaluate(compiled_expr& expr, variables_changed_callback variables_changed_)
+    -> calc_val::variant_type
+{
+    return value_or_throw(try_evaluate(expr, variables_changed_));
+}
+
+auto calc_parser::try_evaluate(compiled_expr& expr, variables_changed_callback variables_changed_)
+    -> evaluation_result
+{
+    variables_changed = variables_changed_;
+    auto cancellation_scope = calc_cancellation::scope(cancellation_);
+    parse_error.reset();
+    changed_variables_.clear();
+    auto result = evaluation_result();
+
+    if (expr.nodes.empty() || expr.options_ != options() || shadowing_changed(expr))
+        compile_into(expr, expr.source_);
+    if (!failed()) {
+        auto val = run(expr);
+        if (!failed()) {
+            last_val_pos->second = val;
+            result.value = std::move(val);
+        }
+    }
+    if (failed()) {
+        result.error = std::move(parse_error);
+        parse_error.reset();
+    }
+    deliver_variables_delta();
+    return result;
+}
+
+// validating
+
+auto calc_parser::assign_variable(const lexer_token& identifier_token, validated) -> validated {
+    classify_identifier(identifier_token, variable_class);
+    validating_state->assigned.push_back(identifier_token.view);
+    return {};
+}
+
+auto calc_parser::classify_identifier(const lexer_token& identifier_token, token_classes token_class) -> void {
+    validating_state->identifiers.emplace_back(identifier_token.view_offset, token_class);
+}
+
+static auto token_class_of(lexer_token::token_ids id) -> calc_parser::token_classes {
+// class of a token other than an identifier
+    switch (id) {
+        case lexer_token::number:
+            return calc_parser::number_class;
+        case lexer_token::identifier:
+            return calc_parser::identifier_class;
+        case lexer_token::lparen:
+        case lexer_token::rparen:
+        case lexer_token::comma:
+            return calc_parser::paren_class;
+        case lexer_token::help:
+        case lexer_token::del:
+            return calc_parser::keyword_class;
+        case lexer_token::option:
+            return calc_parser::option_class;
+        case lexer_token::unspecified:
+        case lexer_token::end:
+            return calc_parser::invalid_class;
+        default:
+            return calc_parser::operator_class;
+    }
+}
+
+auto calc_parser::validate(std::string_view input) -> validation_result {
+    auto saved_options = options();
+    auto out_options = output_options();
+    auto no_help = help_callback([] {});
+    auto state = validation_state();
+
+    validating_state = &state;
+    auto lexer = lookahead_calc_lexer(input, default_number_radix);
+    auto evaluated = input_expr<validated>(lexer, no_help, out_options);
+    validating_state = nullptr;
+    auto expression_radix = default_number_radix; // as set by options in the input
+    options(saved_options);
+
+    auto result = validation_result();
+    result.void_kind = evaluated.void_kind;
+    result.error = std::move(evaluated.error);
+
+    // classify all the tokens, including those after an error. the
+    // identifiers resolved were recorded in order of their offsets, except
+    // that an assignment's target follows the identifiers of its value
+    std::sort(state.identifiers.begin(), state.identifiers.end());
+    auto identifier_itr = state.identifiers.begin();
+    std::size_t base_offset = 0;
+    auto token_lexer = calc_lexer(input, saved_options.default_number_radix);
+    auto options_done = false;
+    for (;;) {
+        auto token = token_lexer.get_token();
+        auto offset = base_offset + token.view_offset;
+        if (token.id == lexer_token::end)
+            break;
+        auto token_class = token_class_of(token.id);
+        if (token.id == lexer_token::identifier) {
+            while (identifier_itr != state.identifiers.end() && identifier_itr->first < offset)
+                ++identifier_itr;
+            if (identifier_itr != state.identifiers.end() && identifier_itr->first == offset)
+                token_class = identifier_itr->second;
+        }
+
+        auto length = token.view.size();
+        auto restart = false;
+        if (token.id == lexer_token::unspecified && length == 0) {
+            // a character that starts no token; the lexer doesn't skip it
+            length = 1;
+            restart = true;
+        }
+        if (!options_done && token.id != lexer_token::option) {
+            // the tokens after the first one that follows the options are
+            // scanned with the radix the options set (see input_expr)
+            options_done = true;
+            restart = true;
+        }
+        result.tokens.push_back(classified_token{token_class, token.id, offset, length});
+        if (restart) {
+            base_offset = offset + length;
+            token_lexer = calc_lexer(input.substr(base_offset), expression_radix);
+        }
+    }
+
+    return result;
+}
+
+// formulas
+
+auto calc_parser::define_formula(
+    std::string_view identifier,
+    std::string_view formula_input,
+    variables_changed_callback variables_changed_
+) -> void
+{
+    variables_changed = variables_changed_;
+    auto cancellation_scope = calc_cancellation::scope(cancellation_);
+    parse_error.reset();
+    changed_variables_.clear();
+    auto throw_error = [&] {
+        auto error = std::move(*parse_error);
+        parse_error.reset();
+        throw error;
+    };
+
+    auto identifier_lexer = calc_lexer(identifier, default_number_radix);
+    auto identifier_token = identifier_lexer.get_token();
+    if (identifier_token.id != lexer_token::identifier)
+        fail(calc_parse_error::variable_identifier_expected, identifier_token);
+    else if (auto token = identifier_lexer.get_token(); token.id != lexer_token::end)
+        fail(calc_parse_error::syntax_error, token);
+    if (failed())
+        throw_error();
+
+    auto expr = std::make_shared<compiled_expr>();
+    expr->source_ = formula_input;
+    compile_into(*expr, formula_input);
+    if (failed())
+        throw_error();
+
+    for (auto& n : expr->nodes) {
+        if (n.kind == compiled_expr::assign_kind) {
+            fail(calc_parse_error::assignment_in_formula,
+                lexer_token{n.token_id, formula_input.substr(n.token_offset, n.token_length), n.token_offset});
+            throw_error();
+        }
+    }
+    auto dependencies = formula_dependencies(*expr);
+
+    // the formula would depend on itself if identifier is reachable from its
+    // dependencies through the dependencies of other formulas
+    auto visited = std::set<std::string_view>();
+    auto reaches_identifier = [&](auto& self, std::string_view name) -> bool {
+        if (name == identifier)
+            return true;
+        if (!visited.insert(name).second)
+            return false;
+        auto f = formulas.find(name);
+        if (!f)
+            return false;
+        return std::any_of(f->dependencies->begin(), f->dependencies->end(),
+            [&](const auto& dependency) {return self(self, dependency);});
+    };
+    for (auto& dependency : *dependencies) {
+        if (reaches_identifier(reaches_identifier, dependency)) {
+            fail(calc_parse_error::formula_cycle, identifier_token);
+            throw_error();
+        }
+    }
+
+    // evaluated from formula_input (rather than by running expr) so the view
+    // of the token of an error refers to formula_input
+    auto lexer = lookahead_calc_lexer(formula_input, default_number_radix);
+    auto val = math_expr<calc_val::variant_type>(lexer);
+    if (failed())
+        throw_error();
+    trim_int(val);
+
+    bind_formula(identifier, formula{std::move(expr), std::move(dependencies)});
+    store_variable(identifier_token, val);
+    deliver_variables_delta();
+    if (failed()) {
+        unbind_formula(identifier);
+        throw_error();
+    }
+}
+
+auto calc_parser::formula_source(std::string_view identifier) const -> std::optional<std::string_view> {
+    if (auto f = formulas.find(identifier))
+        return f->expr->source();
+    return std::nullopt;
+}
+
+auto calc_parser::formula_dependencies(const compiled_expr& expr) const -> std::shared_ptr<const dependency_list> {
+// the variables referenced by expr, sorted
+    auto dependencies = std::allocate_shared<dependency_list>(std::pmr::polymorphic_allocator<>(&memory->pool));
+    for (auto& n : expr.nodes) {
+        auto view = expr.token(n).view;
+        if (n.kind == compiled_expr::variable_kind && internals.find(view) == internals.end())
+            dependencies->emplace_back(view);
+    }
+    std::sort(dependencies->begin(), dependencies->end());
+    dependencies->erase(std::unique(dependencies->begin(), dependencies->end()), dependencies->end());
+    return dependencies;
+}
+
+auto calc_parser::bind_formula(std::string_view identifier, formula&& f) -> void {
+// binds identifier to f, replacing the formula it was bound to, if any
+    if (formulas.contains(identifier))
+        unbind_formula(identifier);
+    formulas.insert_or_assign(identifier, f);
+    for (std::string_view dependency : *f.dependencies) {
+        auto dependents_itr = dependents.find(dependency);
+        if (dependents_itr == dependents.end())
+            dependents_itr = dependents.emplace(dependency, std::pmr::set<std::pmr::string, std::less<>>()).first;
+        dependents_itr->second.emplace(identifier);
+    }
+}
+
+auto calc_parser::unbind_formula(std::string_view identifier) -> void {
+// the formula is erased first, as that may fail (it may need to copy nodes)
+    auto f = *formulas.find(identifier);
+    formulas.erase(identifier);
+    for (std::string_view dependency : *f.dependencies) {
+        auto dependents_itr = dependents.find(dependency);
+        assert(dependents_itr != dependents.end());
+        auto& dependent_set = dependents_itr->second;
+        dependent_set.erase(dependent_set.find(identifier));
+        if (dependents_itr->second.empty())
+            dependents.erase(dependents_itr);
+    }
+}
+
+auto calc_parser::rebuild_dependents() -> void {
+    dependents.clear();
+    for (auto& [identifier, f] : formulas) {
+        for (std::string_view dependency : *f.dependencies) {
+            auto dependents_itr = dependents.find(dependency);
+            if (dependents_itr == dependents.end())
+                dependents_itr = dependents.emplace(dependency, std::pmr::set<std::pmr::string, std::less<>>()).first;
+            dependents_itr->second.emplace(identifier);
+        }
+    }
+}
+
+auto calc_parser::formula_value(compiled_expr& expr) -> calc_val::variant_type {
+// value of a formula when it's recomputed; nan if that fails
+    assert(!failed());
+    if (expr.options_ != options() || shadowing_changed(expr))
+        compile_into(expr, expr.source_);
+    auto val = failed() ? calc_val::variant_type() : run(expr);
+    if (failed()) {
+        parse_error.reset();
+        return calc_val::complex_type(calc_val::nan, calc_val::nan);
+    }
+    trim_int(val);
+    return val;
+}
+
+auto calc_parser::recompute_dependents(const lexer_token& identifier_token) -> void {
+// if setting a recomputed value fails for lack of memory, that's reported for
+// identifier_token and the remaining formulas are not recomputed. recomputing
+// is not cancellable, so formulas don't end up with values of cancelled
+// evaluations
+    auto no_cancellation = calc_cancellation::scope(nullptr);
+    auto identifier = identifier_token.view;
+    if (dependents.find(identifier) == dependents.end())
+        return;
+
+    // the formulas that transitively depend on identifier, in reverse
+    // topological order (a formula follows those that depend on it)
+    auto order = std::vector<std::string_view>();
+    auto visited = std::set<std::string_view>();
+    auto visit = [&](auto& self, std::string_view name) -> void {
+        auto itr = dependents.find(name);
+        if (itr == dependents.end())
+            return;
+        for (auto& dependent : itr->second) {
+            if (visited.insert(dependent).second) {
+                self(self, dependent);
+                order.push_back(dependent);
+            }
+        }
+    };
+    visit(visit, identifier);
+
+    auto changed = std::set<std::string_view>{identifier};
+    for (auto itr = order.rbegin(); itr != order.rend(); ++itr) {
+        auto name = *itr;
+        auto formula = formulas.find(name);
+        assert(formula);
+        auto affected = std::any_of(formula->dependencies->begin(), formula->dependencies->end(),
+            [&](const auto& dependency) {return changed.count(dependency) != 0;});
+        if (!affected)
+            continue;
+        auto val = formula_value(*formula->expr);
+        auto variable = variables.find(name);
+        assert(variable);
+        if (*variable == val)
+            continue;
+        try {
+            variables.insert_or_assign(name, val);
+        } catch (const std::bad_alloc&) {
+            fail(calc_parse_error::out_of_memory, identifier_token);
+            return;
+        }
+        changed.insert(name);
+        note_variable_change(name, variable_modified);
+    }
+}
+
+// variable changes
+
+auto calc_parser::note_variable_change(std::string_view identifier, variable_changes change) -> void {
+// records a change of a variable for changed_variables() and for the delta to
+// be delivered. successive changes of a variable within the same delta are
+// merged
+    changed_variables_.emplace_back(identifier);
+    if (!variables_delta_fn)
+        return;
+
+    auto itr = pending_changes.find(identifier);
+    if (itr == pending_changes.end()) {
+        pending_changes.emplace(identifier, change);
+        return;
+    }
+    auto& pending = itr->second;
+    if (pending == variable_added && change == variable_removed)
+        pending_changes.erase(itr); // never existed as far as the receiver knows
+    else if (pending == variable_removed && change == variable_added)
+        pending = variable_modified;
+    else if (pending != variable_added)
+        pending = change;
+}
+
+auto calc_parser::deliver_variables_delta() -> void {
+    if (pending_changes.empty())
+        return;
+    auto delta = variables_delta();
+    delta.version = ++variables_version_;
+    for (auto& [identifier, change] : pending_changes) {
+        auto& names = change == variable_added ? delta.added
+            : change == variable_modified ? delta.modified
+            : delta.removed;
+        names.emplace_back(identifier);
+    }
+    pending_changes.clear();
+    variables_delta_fn(delta);
+}
+
+// checkpoints and forks
+
+auto calc_parser::checkpoint() const -> variables_state {
+    return variables_state(memory, variables, formulas);
+}
+
+auto calc_parser::restore(const variables_state& state) -> void {
+    assert(state.memory == memory);
+    changed_variables_.clear();
+
+    // the delta: both maps are sorted, and elements at the same address are
+    // in a node that the maps share and so are unchanged
+    auto old_itr = variables.begin();
+    auto new_itr = state.variables.begin();
+    while (old_itr != variables.end() || new_itr != state.variables.end()) {
+        if (new_itr == state.variables.end() || (old_itr != variables.end() && old_itr->first < new_itr->first)) {
+            note_variable_change(old_itr->first, variable_removed);
+            ++old_itr;
+        } else if (old_itr == variables.end() || new_itr->first < old_itr->first) {
+            note_variable_change(new_itr->first, variable_added);
+            ++new_itr;
+        } else {
+            if (&*old_itr != &*new_itr && old_itr->second != new_itr->second)
+                note_variable_change(old_itr->first, variable_modified);
+            ++old_itr;
+            ++new_itr;
+        }
+    }
+
+    variables = state.variables;
+    formulas = state.formulas;
+    rebuild_dependents();
+    deliver_variables_delta();
+}
+
+auto calc_parser::fork() const -> calc_parser {
+    return calc_parser(fork_tag(), *this);
+}
+
+auto calc_parser::variables_state::memory_usage() const -> persistent_map_usage {
+    auto result = variables.memory_usage();
+    auto formulas_usage = formulas.memory_usage();
+    result.nodes += formulas_usage.nodes;
+    result.bytes += formulas_usage.bytes;
+    result.exclusive_bytes += formulas_usage.exclusive_bytes;
+    return result;
+}
+
+// asynchronous evaluation
+
+auto calc_parser::evaluate_async(
+    calc_worker_pool& pool,
+    std::string input,
+    const output_options& out_options,
+    std::shared_ptr<const calc_cancellation> cancellation
+) -> std::future<async_result>
+{
+    auto promise = std::make_shared<std::promise<async_result>>();
+    auto future = promise->get_future();
+    auto shared_input = std::make_shared<const std::string>(std::move(input));
+    pool.submit([this, promise, shared_input, out_options, cancellation] {
+        auto previous_cancellation = std::exchange(cancellation_, cancellation.get());
+        try {
+            auto result = async_result{evaluation_result(), out_options, shared_input};
+            result.result = try_evaluate(*shared_input, [] {}, result.out_options);
+            cancellation_ = previous_cancellation;
+            promise->set_value(std::move(result));
+        } catch (...) {
+            cancellation_ = previous_cancellation;
+            promise->set_exception(std::current_exception());
+        }
+    });
+    return future;
+}
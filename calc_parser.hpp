@@ -4,14 +4,41 @@
 #include "variant_type.hpp"
 #include "lookahead_calc_lexer.hpp"
 #include "calc_args.hpp"
+#include "calc_memory_resource.hpp"
+#include "calc_parse_error.hpp"
+#include "calc_fn_memo.hpp"
+#include "calc_result_cache.hpp"
+#include "persistent_map.hpp"
+#include "calc_cancellation.hpp"
+#include "calc_worker_pool.hpp"
+#include "calc_token_buffer.hpp"
 #include <map>
+#include <set>
+#include <string>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <span>
+#include <cstdint>
 #include <functional>
+#include <future>
+#include <iterator>
+#include <utility>
+#include <vector>
 
 class calc_parser {
 public:
-    calc_parser();
+    explicit calc_parser(std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
     calc_parser(calc_val::number_type_codes default_number_type_code_,
-        calc_val::radices default_number_radix_, calc_val::int_word_sizes int_word_size_);
+        calc_val::radices default_number_radix_, calc_val::int_word_sizes int_word_size_,
+        std::pmr::memory_resource* upstream = std::pmr::get_default_resource());
+    // upstream: the resource from which the session's memory pool obtains its
+    // memory; variables and internal values are allocated from that pool, so
+    // destroying the parser releases the session's memory as a whole.
+    // note: a parser can be moved but not copied or assigned
+
+    calc_parser(calc_parser&&) = default;
+    auto operator=(calc_parser&&) -> calc_parser& = delete;
 
     using help_callback = std::function<void()>;
     using variables_changed_callback = std::function<void()>;
@@ -30,72 +57,690 @@ public:
     // side effects:
     // out_options is not used but may be updated
 
+    static constexpr std::size_t pretokenize_min_input_size = 256;
+    // input at least this long is tokenized up front (see calc_token_buffer)
+
+    auto evaluate(
+        calc_stream_lexer& input,
+        help_callback help_fn, // assumed to have a valid target
+        output_options& out_options,
+        variables_changed_callback variables_changed = variables_changed_callback()
+    ) -> calc_val::variant_type;
+    // as above but input is pulled from a stream (see calc_stream_lexer),
+    // which need not be contiguous or held in memory as a whole. the view of
+    // the token of a parse_error thrown refers to storage of input and is
+    // valid until input is used further
+
+    enum void_kinds {not_void, blank_input, help_input, delete_input, options_input};
+    // why no mathematical expression was evaluated: the input was blank, was
+    // "help", was a delete expression or consisted of options only
+
+    struct evaluation_result {
+        calc_val::variant_type value = calc_val::complex_type{}; // valid if has_value()
+        void_kinds void_kind = not_void;
+        std::optional<calc_parse_error> error = std::nullopt;
+
+        auto has_value() const -> bool {return void_kind == not_void && !error;}
+    };
+
+    auto try_evaluate(
+        std::string_view input,
+        help_callback help_fn, // assumed to have a valid target
+        output_options& out_options,
+        variables_changed_callback variables_changed = variables_changed_callback()
+    ) -> evaluation_result;
+    auto try_evaluate(
+        calc_stream_lexer& input,
+        help_callback help_fn, // assumed to have a valid target
+        output_options& out_options,
+        variables_changed_callback variables_changed = variables_changed_callback()
+    ) -> evaluation_result;
+    // as evaluate but the outcome, including a parse error or a void
+    // expression, is returned in the result instead of being thrown. the
+    // evaluation throws no exceptions internally either, so this is the
+    // cheaper call for input that is often blank or invalid. (exceptions from
+    // the callbacks, from a stream source or std::bad_alloc from outside the
+    // session pool still propagate)
+
+    class compiled_expr; // defined below
+
+    auto compile(std::string_view input) -> compiled_expr;
+    // compiles the math expression input (options, help and delete are not
+    // allowed) for repeated evaluation. operations whose operands are all
+    // constant are performed once here, with the parser's current options (so
+    // integer results are trimmed to the current int_word_size), and
+    // identical subexpressions that don't depend on an assignment are
+    // evaluated once per evaluation. the compiled expression is evaluated by
+    // the cheapest engine that gives the same values (see
+    // compiled_expr::engine). throws parse_error on a syntax error or
+    // an invalid number; errors that depend on operand values (e.g., integer
+    // division by 0) are reported when the expression is evaluated. the view
+    // of the token of a parse_error thrown refers to input
+
+    auto evaluate(compiled_expr& expr,
+        variables_changed_callback variables_changed = variables_changed_callback()) -> calc_val::variant_type;
+    auto try_evaluate(compiled_expr& expr,
+        variables_changed_callback variables_changed = variables_changed_callback()) -> evaluation_result;
+    // evaluates a compiled expression with the current values of variables and
+    // "last", and otherwise like evaluating its source. expr is recompiled
+    // first if the parser's options were changed since it was compiled, or if
+    // a variable was assigned or deleted that shadows one of its internal
+    // identifiers (pi, sin, ...), which may report a parse error. the view of
+    // the token of a parse error refers to the source held by expr
+
+    class incremental_input; // defined below
+
+    auto evaluate(incremental_input& input, help_callback help_fn, output_options& out_options,
+        variables_changed_callback variables_changed = variables_changed_callback()) -> calc_val::variant_type;
+    auto try_evaluate(incremental_input& input, help_callback help_fn, output_options& out_options,
+        variables_changed_callback variables_changed = variables_changed_callback()) -> evaluation_result;
+    // evaluates input (see incremental_input) with the same result as
+    // evaluating its source. the view of the token of a parse error refers to
+    // the source held by input and is valid until input is edited
+
     auto options() const -> parser_options;
     auto options(const parser_options&) -> void;
 
+    struct invalid_snapshot {}; // exception
+
+    auto save_snapshot(const output_options& out_options) const -> std::string;
+    auto save_snapshot(const char* path, const output_options& out_options) const -> void;
+    // binary snapshot of the session: its variables (and formulas), "last",
+    // options and out_options. numbers are stored in their binary form (the
+    // bits, exponent and sign of floating point numbers and the bytes of
+    // integers) so restoring them involves no conversion from text. the format
+    // depends on the machine's byte order and multiprecision limb size.
+    // the second overload writes the snapshot to a file; throws
+    // std::system_error on an i/o error
+
+    auto load_snapshot(std::string_view snapshot, output_options& out_options) -> void;
+    auto load_snapshot(const char* path, output_options& out_options) -> void;
+    // replaces the session's variables, formulas, "last" and options with those
+    // of a snapshot and sets out_options to the snapshot's; integer values are
+    // trimmed to the snapshot's word size. throws invalid_snapshot if the
+    // snapshot is malformed (including identifiers that aren't identifiers and
+    // formulas that define_formula would refuse) or was saved on an
+    // incompatible machine, in which case the session is unchanged.
+    // the second overload maps the file into memory and reads it in place;
+    // throws std::system_error on an i/o error
+
     auto last_val() const -> const calc_val::variant_type&
     {return std::get<calc_val::variant_type>(last_val_pos->second);}
 
     auto trimmed_last_val() const -> const calc_val::variant_type
     {auto val = last_val(); trim_int(val); return val;}
 
+    auto memory_usage() const -> calc_memory_resource::usage
+    {return memory->counter.memory_usage();}
+    // memory obtained from upstream by the session's pool
+
+    auto memory_limit(std::size_t limit) -> void {memory->counter.limit(limit);}
+    // limit (in bytes) for memory_usage().bytes_in_use; 0 means no limit.
+    // creating a variable that would exceed the limit is reported as
+    // calc_parse_error::out_of_memory
+
+    auto result_cache(calc_result_cache* cache) -> void {result_cache_ = cache;}
+    auto result_cache() const -> calc_result_cache* {return result_cache_;}
+    // cache (which may be shared with other parsers) consulted for math
+    // expressions that reference no variables and don't reference "last", and
+    // into which their values are stored; nullptr (the default) means no
+    // caching. the cache must outlive its use by the parser. input from a
+    // calc_stream_lexer is not cached
+
+    auto fn_memo(calc_fn_memo* memo) -> void {fn_memo_ = memo;}
+    auto fn_memo() const -> calc_fn_memo* {return fn_memo_;}
+    // memo (which may be shared with other parsers) of the values of the
+    // built-in functions of one argument and of "!" and "!!", consulted by
+    // evaluations and by compiled expressions; nullptr (the default) means
+    // none. the memo must outlive its use by the parser
+
+    static auto fn_memo_id(std::string_view identifier) -> std::optional<calc_fn_memo::fn_id>;
+    // id of the function or factorial operator ("!" or "!!") for
+    // calc_fn_memo::enable; nullopt if it isn't memoized (as the integer
+    // functions, e.g., popcount, aren't)
+
+    auto cancellation(const calc_cancellation* c) -> void {cancellation_ = c;}
+    auto cancellation() const -> const calc_cancellation* {return cancellation_;}
+    // cancellation checked by evaluate, try_evaluate and define_formula;
+    // nullptr (the default) means none. an evaluation that is cancelled fails
+    // with calc_parse_error::evaluation_cancelled or deadline_exceeded
+    // (assignments it made before then remain). recomputing the formulas that
+    // depend on an assigned variable is not cancellable. the cancellation must
+    // outlive its use by the parser
+
+    struct async_result {
+        evaluation_result result;
+        output_options out_options; // as updated by the evaluation
+        std::shared_ptr<const std::string> input; // the view of an error's token refers to this
+    };
+
+    auto evaluate_async(
+        calc_worker_pool& pool,
+        std::string input,
+        const output_options& out_options,
+        std::shared_ptr<const calc_cancellation> cancellation = nullptr
+    ) -> std::future<async_result>;
+    // try_evaluate run as a task of pool, with the given cancellation (so a
+    // frontend can abandon an evaluation that's no longer wanted, e.g.,
+    // because the input changed) and no help callback (help input gives a
+    // help_input void_kind). the parser must not be used, moved or destroyed
+    // until the future is ready. the future holds std::bad_alloc (or an
+    // exception from a variables delta handler) if one was thrown
+
+    enum token_classes {
+        number_class, variable_class, constant_class, function_class, undefined_class,
+        identifier_class, operator_class, paren_class, keyword_class, option_class, invalid_class};
+    // identifier_class: an identifier that validation didn't reach (it
+    // follows the error)
+
+    struct classified_token {
+        token_classes token_class;
+        lexer_token::token_ids id;
+        std::size_t offset = 0; // of the token's text in the input
+        std::size_t length = 0;
+    };
+
+    struct validation_result {
+        std::vector<classified_token> tokens; // all the tokens of the input, in order
+        void_kinds void_kind = not_void;
+        std::optional<calc_parse_error> error = std::nullopt; // the first error
+
+        auto is_valid() const -> bool {return !error;}
+    };
+
+    auto validate(std::string_view input) -> validation_result;
+    // parses the input as evaluate would and resolves its identifiers, but
+    // performs no operations and calls no functions, e.g., to check input as
+    // it's typed. integers are converted (which is cheap) so their range is
+    // checked; floating point numbers are only checked for syntax. errors that
+    // depend on values (e.g., a domain error or division by 0) are therefore
+    // not reported. an assignment makes its identifier a variable for the
+    // rest of the input. the session is unchanged: options in the input apply
+    // to the rest of the input only, and the help callback is not called. the
+    // view of the token of the error refers to input
+
 private:
-    using variables_map = std::map<std::string, calc_val::variant_type>;
+    using variables_map = persistent_map<calc_val::variant_type>;
+    // keyed by std::pmr::strings from the session's pool
 
 public:
-    using variables_pair = variables_map::value_type;
-    using variables_itr = variables_map::const_iterator;
-    auto variables_begin() const -> variables_itr {return variables.begin();}
-    auto variables_end() const -> variables_itr {return variables.end();}
+    using variables_pair = std::pair<const std::string, calc_val::variant_type>;
+    class variables_itr;
+    auto variables_begin() const -> variables_itr;
+    auto variables_end() const -> variables_itr;
+    // the variables in order of name
+
+    auto define_formula(
+        std::string_view identifier,
+        std::string_view formula,
+        variables_changed_callback variables_changed = variables_changed_callback()
+    ) -> void;
+    // binds the variable identifier to formula, a math expression without
+    // assignments, and sets the variable to its value. whenever a variable the
+    // formula depends on changes, the value is recomputed: the formulas that
+    // transitively depend on the changed variable are recomputed in
+    // dependency order, skipping those none of whose dependencies actually
+    // changed. if recomputing a formula fails (e.g., a dependency's new value
+    // is outside a function's domain) its variable is set to nan.
+    // assigning a value to the variable unbinds it from the formula; deleting
+    // a variable that a formula depends on is an error. "last" may be used in
+    // a formula but is not a dependency.
+    // throws parse_error if formula is invalid, can't be evaluated or would
+    // depend on itself; the view of the token of the parse_error refers to
+    // identifier or formula
+
+    auto formula_source(std::string_view identifier) const -> std::optional<std::string_view>;
+    // source of the formula bound to the variable identifier, if any
+
+    auto changed_variables() const -> const std::pmr::vector<std::pmr::string>& {return changed_variables_;}
+    // names of the variables that the last evaluation or define_formula set
+    // to a different value, recomputed to a different value or deleted, in
+    // the order in which that happened. the names are allocated from the
+    // session's pool (see memory_usage)
+
+    struct variables_delta {
+        std::vector<std::string> added;
+        std::vector<std::string> modified;
+        std::vector<std::string> removed;
+        std::uint64_t version = 0;
+    };
+    using variables_delta_callback = std::function<void(const variables_delta& delta)>;
+
+    auto variables_delta_handler(variables_delta_callback fn) -> void {variables_delta_fn = std::move(fn);}
+    // fn (if it has a target) is called at the end of each evaluation or
+    // define_formula that changed variables, with the names (each sorted) of
+    // the variables added, modified (by assignment or by recomputing a
+    // formula) and removed. unlike variables_changed_callback, which is called
+    // for every change and tells nothing about it, this allows a frontend to
+    // update just the variables concerned. delta.version is incremented for
+    // each delta, so a receiver can tell whether it has missed one
+
+    auto variables_version() const -> std::uint64_t {return variables_version_;}
+    // version of the last delta delivered; 0 if none
+
+    class variables_state; // defined below
+
+    auto checkpoint() const -> variables_state;
+    // the session's variables and formulas as they are now, for undo. O(1):
+    // the state shares the session's variable store, which copies the nodes
+    // that a later change would alter (O(log n) nodes per change) rather than
+    // change them in place
+    auto restore(const variables_state& state) -> void;
+    // sets the session's variables and formulas to those of state, which must
+    // come from this parser or a fork of it, and delivers the delta. the
+    // variables and formulas themselves are restored in O(1); computing the
+    // delta is O(n) and reindexing the formulas' dependencies is O(number of
+    // formulas)
+    auto fork() const -> calc_parser;
+    // a new session that starts with this one's variables, formulas, "last",
+    // options and result cache, and then changes independently. O(1) in the
+    // number of variables (the formulas' dependency index is copied). the
+    // fork shares this session's memory pool (which
+    // is released when the last of them is destroyed), so memory_usage and
+    // memory_limit concern them together and they must not be used
+    // concurrently. the fork has no delta handler
 
 private:
+    struct fork_tag {};
+    calc_parser(fork_tag, const calc_parser& parent);
     auto finish_construction() -> void;
 
     calc_val::number_type_codes default_number_type_code = calc_val::complex_code;
     calc_val::radices default_number_radix = calc_val::base10;
     calc_val::int_word_sizes int_word_size = calc_val::int_bits_128;
 
+    static auto value_or_throw(evaluation_result&& result) -> calc_val::variant_type;
+
+    // parse errors are recorded rather than thrown. the first error is kept
+    // and the productions return (with a meaningless value) as soon as
+    // failed() is true
+    std::optional<calc_parse_error> parse_error;
+    auto fail(calc_parse_error::error_codes error, const lexer_token& token,
+        lexer_token::token_ids expected_token_id = lexer_token::unspecified) -> calc_val::variant_type;
+    auto failed() const -> bool {return parse_error.has_value();}
+
+    struct identifier_with_unary_fn; // defined below
+    struct identifier_with_multi_fn; // ditto
+
+    // operations shared by the productions and by compiled expressions
+    auto binary_op(const lexer_token& op_token, lexer_token::token_ids op,
+        calc_val::variant_type lval, calc_val::variant_type rval) -> calc_val::variant_type;
+    auto unary_op(const lexer_token& op_token, lexer_token::token_ids op,
+        calc_val::variant_type val) -> calc_val::variant_type;
+    auto call_fn(const lexer_token& identifier_token, const identifier_with_unary_fn* fn,
+        const calc_val::variant_type& arg) -> calc_val::variant_type;
+    auto call_fn(const lexer_token& identifier_token, const identifier_with_multi_fn* fn,
+        std::span<const calc_val::variant_type> args) -> calc_val::variant_type;
+    // these four are the following followed by check_cancellation (the
+    // factorial operators and the functions of one argument through fn_memo_)
+    auto apply_binary_op(const lexer_token& op_token, lexer_token::token_ids op,
+        calc_val::variant_type lval, calc_val::variant_type rval) -> calc_val::variant_type;
+    auto apply_unary_op(const lexer_token& op_token, lexer_token::token_ids op,
+        calc_val::variant_type val) -> calc_val::variant_type;
+    auto apply_fn(const lexer_token& identifier_token, const identifier_with_unary_fn* fn,
+        const calc_val::variant_type& arg) -> calc_val::variant_type;
+    auto apply_fn(const lexer_token& identifier_token, const identifier_with_multi_fn* fn,
+        std::span<const calc_val::variant_type> args) -> calc_val::variant_type;
+    template <typename T> auto reduce_ints(const identifier_with_multi_fn* fn, std::span<const T> args) -> T;
+    auto int_args(const lexer_token& identifier_token, std::span<const calc_val::variant_type> args)
+        -> std::optional<std::vector<calc_val::variant_type>>;
+    auto check_cancellation(const lexer_token& token) -> void;
+    template <typename Apply> auto memoized(const lexer_token& token, std::optional<calc_fn_memo::fn_id> memo_id,
+        const calc_val::variant_type& arg, Apply apply) -> calc_val::variant_type;
+    static const calc_fn_memo::fn_id fac_memo_id; // the ids of the others are their unary_fn_table indexes
+    static const calc_fn_memo::fn_id dfac_memo_id;
+    std::size_t impure_count = 0; // of reads of variables and "last" and of assignments
+    auto assign_variable(const lexer_token& identifier_token, calc_val::variant_type val) -> calc_val::variant_type;
+    auto variable_value(const lexer_token& identifier_token) -> calc_val::variant_type;
+    auto stored_value(std::string_view identifier) const -> const calc_val::variant_type*;
+    // untrimmed value of a variable or of an internal value; nullptr if none
+    auto store_variable(const lexer_token& identifier_token, const calc_val::variant_type& val) -> void;
+
+    // validating: the productions instantiated for validated only parse,
+    // resolving identifiers into *validating_state
+    struct validated {};
+    struct validation_state {
+        std::vector<std::pair<std::size_t, token_classes>> identifiers; // offset and class of each identifier resolved
+        std::vector<std::string_view> assigned; // identifiers assigned so far
+    };
+    validation_state* validating_state = nullptr;
+    auto binary_op(const lexer_token&, lexer_token::token_ids, validated, validated) -> validated {return {};}
+    auto unary_op(const lexer_token&, lexer_token::token_ids, validated) -> validated {return {};}
+    auto call_fn(const lexer_token&, const identifier_with_unary_fn*, validated) -> validated {return {};}
+    auto call_fn(const lexer_token&, const identifier_with_multi_fn*, std::span<const validated>) -> validated {return {};}
+    auto assign_variable(const lexer_token& identifier_token, validated) -> validated;
+    auto classify_identifier(const lexer_token& identifier_token, token_classes token_class) -> void;
+
+    // compiling: the productions instantiated for node_ref append nodes to
+    // *compiling_expr via these overloads of the operations
+    struct node_ref {std::size_t index = 0;};
+    compiled_expr* compiling_expr = nullptr;
+    std::vector<std::string_view> compiling_assigned; // identifiers assigned so far
+    auto binary_op(const lexer_token& op_token, lexer_token::token_ids op, node_ref lval, node_ref rval) -> node_ref;
+    auto unary_op(const lexer_token& op_token, lexer_token::token_ids op, node_ref val) -> node_ref;
+    auto call_fn(const lexer_token& identifier_token, const identifier_with_unary_fn* fn, node_ref arg) -> node_ref;
+    auto call_fn(const lexer_token& identifier_token, const identifier_with_multi_fn* fn, std::span<const node_ref> args)
+        -> node_ref;
+    auto assign_variable(const lexer_token& identifier_token, node_ref val) -> node_ref;
+    auto make_variable(const lexer_token& identifier_token) -> node_ref;
+    auto make_constant(calc_val::variant_type val) -> node_ref;
+    auto compile_into(compiled_expr& expr, std::string_view input) -> void;
+
+    // evaluating incrementally: while evaluating an incremental_input, the
+    // values of its groups and function calls are looked up and kept here
+    incremental_input* incremental = nullptr;
+    auto reuse_value(lookahead_calc_lexer& lexer, std::size_t begin) -> const calc_val::variant_type*;
+    auto keep_value(lookahead_calc_lexer& lexer, std::size_t begin, std::size_t impure_count_before,
+        const calc_val::variant_type& val) -> void;
+    auto optimize(compiled_expr& expr, node_ref root) -> void;
+    auto shadowing_changed(const compiled_expr& expr) const -> bool;
+    auto plan(compiled_expr& expr) const -> void;
+    auto run(const compiled_expr& expr) -> calc_val::variant_type;
+    auto run_ints(const compiled_expr& expr) -> std::optional<calc_val::variant_type>;
+    auto run_reals(const compiled_expr& expr) -> std::optional<calc_val::variant_type>;
+    // nullopt if the int or real engine can't give the complex engine's value
+    // (see plan), which is then computed by run
+
     // parser productions
+    // Value is calc_val::variant_type to evaluate, node_ref to compile or
+    // validated to validate
+    template <typename Value> auto input_expr(lookahead_calc_lexer& lexer, help_callback& help,
+        output_options& out_options, std::string_view cacheable_input = {}) -> evaluation_result;
+    // cacheable_input: the input scanned by lexer if its math expression may
+    // be looked up in and stored into result_cache_
     auto assumed_delete_expr(lookahead_calc_lexer& lexer) -> void;
-    auto math_expr(lookahead_calc_lexer& lexer)-> calc_val::variant_type;
-    auto bxor_expr(lookahead_calc_lexer& lexer) -> calc_val::variant_type;
-    auto band_expr(lookahead_calc_lexer& lexer) -> calc_val::variant_type;
-    auto shift_expr(lookahead_calc_lexer& lexer) -> calc_val::variant_type;
-    auto additive_expr(lookahead_calc_lexer& lexer) -> calc_val::variant_type;
-    auto term(lookahead_calc_lexer& lexer)-> calc_val::variant_type;
-    auto factor(lookahead_calc_lexer& lexer)-> calc_val::variant_type;
-    auto base(lookahead_calc_lexer& lexer)-> calc_val::variant_type;
-    auto assumed_identifier_expr(lookahead_calc_lexer& lexer)-> calc_val::variant_type;
-    auto group(lookahead_calc_lexer& lexer) -> calc_val::variant_type;
+    template <typename Value> auto math_expr(lookahead_calc_lexer& lexer)-> Value;
+    template <typename Value> auto bxor_expr(lookahead_calc_lexer& lexer) -> Value;
+    template <typename Value> auto band_expr(lookahead_calc_lexer& lexer) -> Value;
+    template <typename Value> auto shift_expr(lookahead_calc_lexer& lexer) -> Value;
+    template <typename Value> auto additive_expr(lookahead_calc_lexer& lexer) -> Value;
+    template <typename Value> auto term(lookahead_calc_lexer& lexer)-> Value;
+    template <typename Value> auto factor(lookahead_calc_lexer& lexer)-> Value;
+    template <typename Value> auto base(lookahead_calc_lexer& lexer)-> Value;
+    template <typename Value> auto assumed_identifier_expr(lookahead_calc_lexer& lexer)-> Value;
+    template <typename Value> auto group(lookahead_calc_lexer& lexer) -> Value;
+    template <typename Value> auto arguments(lookahead_calc_lexer& lexer, const identifier_with_multi_fn* fn)
+        -> std::vector<Value>;
+    template <typename Value> auto number(lookahead_calc_lexer& lexer, bool is_negative) -> Value;
     std::string number_buf;
     auto assumed_number(lookahead_calc_lexer& lexer, bool is_negative) -> calc_val::variant_type;
+    auto validate_number(lookahead_calc_lexer& lexer, bool is_negative) -> void;
+    struct number_literal {
+        const_string_itr digits; // the token without its prefix
+        calc_val::number_type_codes type_code;
+        calc_val::radices radix;
+    };
+    auto scan_number_literal(std::string_view token_view) const -> number_literal;
+    auto int_number(const lexer_token& token, const number_literal& literal, bool is_negative) -> calc_val::variant_type;
+    auto wide_int_number(const lexer_token& token, const number_literal& literal, bool is_negative) -> calc_val::variant_type;
 
     auto trim_if_int(const calc_val::complex_type& x) const -> calc_val::complex_type;
     auto trim_if_int(const calc_val::float_type& x) const -> calc_val::float_type;
     auto trim_if_int(const calc_val::uint_type& x) const -> calc_val::uint_type;
     auto trim_if_int(const calc_val::int_type& x) const -> calc_val::int_type;
+    auto trim_if_int(const calc_val::wide_uint_type& x) const -> calc_val::wide_uint_type;
+    auto trim_if_int(const calc_val::wide_int_type& x) const -> calc_val::wide_int_type;
     auto trim_int(calc_val::variant_type& val) const -> void;
+    auto try_to_make_int_if_complex(calc_val::variant_type& val) const -> void;
+
+    enum domains {any_domain, real_domain, positive_real_domain};
+    // argument domains of functions that are not defined for all complex
+    // numbers; checked before the function is called
+    static auto in_domain(domains domain, const calc_val::variant_type& val) -> bool;
 
     using unary_fn = calc_val::complex_type (*)(const calc_val::complex_type&);
+    using real_unary_fn = calc_val::complex_type (*)(const calc_val::float_type& x, bool negative_zero);
+    using int_unary_fn = calc_val::max_uint_type (*)(calc_val::max_uint_type word, unsigned word_size);
     struct identifier_with_unary_fn {
+    // a function with overloads chosen by the argument's type: int_fn for int
+    // and uint arguments, real_fn for other finite, nonzero arguments with no
+    // imaginary part that are in real_fn_domain (see real_functions.hpp), and
+    // fn for the rest. an integer function (null fn) takes only whole real
+    // arguments, converted to int, and fails with
+    // calc_parse_error::wide_int_fn_unsupported for word sizes above 128 bits
         const char* identifier;
         unary_fn fn;
+        domains domain;
+        real_unary_fn real_fn = nullptr;
+        domains real_fn_domain = any_domain;
+        int_unary_fn int_fn = nullptr; // see int_functions.hpp
     };
     static identifier_with_unary_fn unary_fn_table[];
+    static auto real_fn_value(const identifier_with_unary_fn* fn, const calc_val::float_type& x, bool negative_zero)
+        -> std::optional<calc_val::complex_type>;
+    // fn's value by real_fn, or nullopt where fn is to be used instead
 
-    using var_poly_type = std::variant<calc_val::variant_type, unary_fn>;
-    using internals_map = std::map<std::string, var_poly_type>;
+    enum multi_fns {
+        min_fn, max_fn, sum_fn, prod_fn, mean_fn, gcd_fn, lcm_fn, hypot_fn, atan2_fn, rotl_fn, rotr_fn,
+        powmod_fn, mulmod_fn, invmod_fn};
+    struct identifier_with_multi_fn {
+    // a function of a list of arguments (see apply_fn). the integer ones
+    // (gcd, lcm, rotl, rotr, powmod, mulmod and invmod) fail with
+    // calc_parse_error::wide_int_fn_unsupported for word sizes above 128 bits
+        const char* identifier;
+        multi_fns fn;
+        std::size_t min_args;
+        std::size_t max_args;
+    };
+    static identifier_with_multi_fn multi_fn_table[];
+
+    struct session_memory {
+        calc_memory_resource counter;
+        std::pmr::unsynchronized_pool_resource pool{&counter};
+        explicit session_memory(std::pmr::memory_resource* upstream) : counter{upstream} {}
+    };
+    std::shared_ptr<session_memory> memory; // must precede the containers that use it
+    // shared with forks and variables_states
+
+    using var_poly_type = std::variant<calc_val::variant_type, const identifier_with_unary_fn*,
+        const identifier_with_multi_fn*>;
+    using internals_map = std::pmr::map<std::pmr::string, var_poly_type, std::less<>>;
     // an internals_map element may hold a single value (calc_val::variant_type)
-    // or a function pointer (unary_fn).
+    // or a pointer to a unary_fn_table or multi_fn_table entry.
 
-    internals_map internals;
+    internals_map internals{&memory->pool};
     internals_map::iterator last_val_pos = internals.end();
 
-    variables_map variables;
+    variables_map variables{&memory->pool};
 
     variables_changed_callback variables_changed = variables_changed_callback();
+    std::pmr::vector<std::pmr::string> changed_variables_{&memory->pool};
+
+    enum variable_changes {variable_added, variable_modified, variable_removed};
+    variables_delta_callback variables_delta_fn = variables_delta_callback();
+    std::uint64_t variables_version_ = 0;
+    std::pmr::map<std::pmr::string, variable_changes, std::less<>> pending_changes{&memory->pool}; // merged changes not yet delivered
+    auto note_variable_change(std::string_view identifier, variable_changes change) -> void;
+    auto deliver_variables_delta() -> void;
+
+    using dependency_list = std::pmr::vector<std::pmr::string>; // sorted variable identifiers
+    struct formula {
+        std::shared_ptr<compiled_expr> expr; // shared by the copies of formulas
+        std::shared_ptr<const dependency_list> dependencies; // likewise; allocated from the session's pool
+    };
+    using formulas_map = persistent_map<formula>;
+    formulas_map formulas{&memory->pool};
+    std::pmr::map<std::pmr::string, std::pmr::set<std::pmr::string, std::less<>>, std::less<>> dependents{&memory->pool};
+    // dependents[x] is the set of variables whose formulas depend on x
+    auto formula_dependencies(const compiled_expr& expr) const -> std::shared_ptr<const dependency_list>;
+    auto bind_formula(std::string_view identifier, formula&& f) -> void;
+    auto unbind_formula(std::string_view identifier) -> void;
+    auto rebuild_dependents() -> void;
+    auto recompute_dependents(const lexer_token& identifier_token) -> void;
+    auto formula_value(compiled_expr& expr) -> calc_val::variant_type;
+
+    calc_result_cache* result_cache_ = nullptr;
+    calc_fn_memo* fn_memo_ = nullptr;
+    const calc_cancellation* cancellation_ = nullptr;
+    auto result_cache_key(std::string_view expression_input) const -> std::optional<calc_result_cache::key_type>;
+};
+
+class calc_parser::compiled_expr {
+// a math expression compiled by calc_parser::compile. it holds a copy of the
+// source and the operations of the expression as a list of nodes in the
+// order in which they are performed; a node's operands are earlier nodes.
+// a compiled expression is not tied to the parser that compiled it; any
+// parser can evaluate it
+public:
+    compiled_expr() = default;
+
+    auto source() const -> std::string_view {return source_;}
+    auto options() const -> const parser_options& {return options_;}
+    auto node_count() const -> std::size_t {return nodes.size();}
+    // number of nodes left after optimization; a constant expression has one
+
+    enum engines {int_engine, real_engine, complex_engine};
+    auto engine() const -> engines {return engine_;}
+    auto explain() const -> const std::string& {return plan_;}
+    // the engine that evaluates the expression and why it was chosen (or why
+    // a cheaper one wasn't). the int engine performs integer operations on
+    // words of up to 128 bits and the real engine real operations on floats,
+    // without the general (variant) values of the complex engine. either
+    // gives the value the complex engine would give, bit for bit, or hands
+    // the evaluation over to it: the int engine if a variable no longer holds
+    // an integer of the kind it held when the expression was compiled or an
+    // operation would fail, the real engine if a value isn't real, finite and
+    // nonzero or a function's argument is outside its real domain. the engine
+    // is chosen again when the expression is recompiled, as it is when a
+    // variable comes to shadow one of its internal identifiers or no longer
+    // does (see calc_parser::evaluate)
+
+private:
+    friend class calc_parser;
+
+    enum node_kinds {constant_kind, variable_kind, assign_kind, unary_kind, binary_kind, call_kind, multi_call_kind};
+    struct node {
+        node_kinds kind = constant_kind;
+        lexer_token::token_ids op = lexer_token::unspecified; // unary_kind and binary_kind
+        std::size_t lhs = 0; // operand index; not for constant_kind or variable_kind
+        std::size_t rhs = 0; // binary_kind
+        const identifier_with_unary_fn* fn = nullptr; // call_kind
+        const identifier_with_multi_fn* multi_fn = nullptr; // multi_call_kind
+        std::vector<std::size_t> args; // operand indexes; multi_call_kind
+        calc_val::variant_type value = calc_val::complex_type{}; // constant_kind
+        lexer_token::token_ids token_id = lexer_token::unspecified; // token of the operator, function or variable
+        bool is_signed = false; // int_engine: the value is an int (else a uint)
+        std::size_t token_offset = 0;
+        std::size_t token_length = 0;
+    };
+
+    std::string source_;
+    parser_options options_;
+    std::vector<node> nodes;
+    engines engine_ = complex_engine;
+    std::string plan_;
+    std::vector<std::pair<std::string, bool>> internals_;
+    // the internal identifiers (functions and constants) of the source and
+    // whether a variable shadowed each when the expression was compiled
+
+    auto add_node(node_kinds kind, const lexer_token& token) -> node&;
+    auto note_internal(std::string_view identifier, bool shadowed) -> void;
+
+    auto token(const node& n) const -> lexer_token
+    {return lexer_token{n.token_id, std::string_view(source_).substr(n.token_offset, n.token_length), n.token_offset};}
+};
 
-    std::string tmp_key; // to mitigate memory allocations when looking up a key in variables or internals
+class calc_parser::variables_itr {
+// input iterator over the variables as variables_pairs, which are converted
+// from the session's entries (whose keys are allocated from its pool) when
+// dereferenced. invalidated by a change of the variables
+public:
+    using iterator_category = std::input_iterator_tag;
+    using value_type = variables_pair;
+    using difference_type = std::ptrdiff_t;
+    using reference = variables_pair;
+
+    struct pointer {
+        variables_pair pair;
+        auto operator->() const -> const variables_pair* {return &pair;}
+    };
+
+    variables_itr() = default;
+
+    auto operator*() const -> reference {return variables_pair(itr->first, itr->second);}
+    auto operator->() const -> pointer {return pointer{**this};}
+    auto operator++() -> variables_itr& {++itr; return *this;}
+    auto operator++(int) -> variables_itr {auto old = *this; ++itr; return old;}
+    auto operator==(const variables_itr& other) const -> bool {return itr == other.itr;}
+    auto operator!=(const variables_itr& other) const -> bool {return itr != other.itr;}
+
+private:
+    friend class calc_parser;
+    explicit variables_itr(variables_map::const_iterator itr_) : itr{itr_} {}
+    variables_map::const_iterator itr;
+};
+
+inline auto calc_parser::variables_begin() const -> variables_itr {return variables_itr(variables.begin());}
+inline auto calc_parser::variables_end() const -> variables_itr {return variables_itr(variables.end());}
+
+class calc_parser::incremental_input {
+// input that's edited in place (e.g., by a gui as it's typed) and evaluated
+// after each edit. it keeps the input's tokens and the values of its groups
+// and function calls that depend on no variable (or "last") and make no
+// assignment. an edit scans again only the tokens near it and discards the
+// values of the groups and calls that contain it; the next evaluation skips
+// over the groups and calls whose values were kept. so after a small edit of
+// a long input only the subexpressions on the path from the edit to the top
+// level are parsed and evaluated again (the top level itself always is).
+// input that starts with an option is evaluated as a whole
+public:
+    incremental_input() = default;
+    explicit incremental_input(std::string_view input) : source_{input} {}
+
+    incremental_input(const incremental_input&) = delete;
+    auto operator=(const incremental_input&) -> incremental_input& = delete;
+    // the tokens refer to source_
+
+    auto source() const -> std::string_view {return source_;}
+
+    auto replace(std::size_t offset, std::size_t length, std::string_view text) -> void;
+    // replaces length characters of the source at offset with text; offset
+    // and length are clamped to the source
+    auto assign(std::string_view input) -> void;
+    // replaces the source with input, as an edit of the part of the source
+    // between the prefix and the suffix it has in common with input
+
+    auto reused_values() const -> std::size_t {return reused_values_;}
+    // number of values reused by the last evaluation
+
+private:
+    friend class calc_parser;
+
+    struct kept_value {
+        std::size_t end = 0; // index of the token after the group or call
+        calc_val::variant_type value;
+    };
+
+    std::string source_;
+    std::optional<calc_token_buffer> tokens; // scanned when first evaluated
+    parser_options options_; // with which the tokens were scanned and the values computed
+    std::map<std::size_t, kept_value> values; // by index of the first token
+    std::size_t reused_values_ = 0;
+
+    auto prepare(const parser_options& options) -> void;
+    // scans the tokens if they weren't, or were with other options
+};
+
+class calc_parser::variables_state {
+// the variables and formulas of a session at some point (see
+// calc_parser::checkpoint). holds a reference to the session's memory pool,
+// so it may outlive the parser but must not be used concurrently with it
+public:
+    auto memory_usage() const -> persistent_map_usage;
+    // memory held by the state's variables and formulas; exclusive_bytes is
+    // the memory that only this state holds (e.g., values since changed in
+    // the session), which destroying it would release. O(n)
+
+private:
+    friend class calc_parser;
+
+    variables_state(std::shared_ptr<session_memory> memory_, const variables_map& variables_,
+        const formulas_map& formulas_)
+        : memory{std::move(memory_)}, variables{variables_}, formulas{formulas_} {}
+
+    std::shared_ptr<session_memory> memory; // must precede the maps
+    variables_map variables;
+    formulas_map formulas;
 };
 
 #endif // CALC_PARSER_HPP
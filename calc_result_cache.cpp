@@ -0,0 +1,79 @@
+#include "calc_result_cache.hpp"
+#include <algorithm>
+
+calc_result_cache::calc_result_cache(std::size_t memory_cap, std::size_t shard_count_)
+:
+    shards{std::make_unique<shard[]>(std::max<std::size_t>(shard_count_, 1))},
+    shard_count{std::max<std::size_t>(shard_count_, 1)},
+    shard_memory_cap{memory_cap / shard_count}
+{}
+
+auto calc_result_cache::entry_size(const key_type& key) -> std::size_t {
+    // list node and index node overheads are estimates; the values are of
+    // fixed size (multiprecision types with inline storage)
+    return sizeof(entry) + 2 * sizeof(void*) // list node
+        + sizeof(std::string_view) + sizeof(lru_list::iterator) + 2 * sizeof(void*) // index node
+        + (key.size() > sizeof(key_type) ? key.size() + 1 : 0); // key beyond small-string storage
+}
+
+auto calc_result_cache::find(const key_type& key) -> std::optional<calc_val::variant_type> {
+    auto& s = shard_for(key);
+    auto lock = std::lock_guard(s.mutex);
+    auto itr = s.index.find(key);
+    if (itr == s.index.end()) {
+        misses.fetch_add(1, std::memory_order_relaxed);
+        return std::nullopt;
+    }
+    hits.fetch_add(1, std::memory_order_relaxed);
+    s.entries.splice(s.entries.begin(), s.entries, itr->second); // make most recently used
+    return itr->second->value;
+}
+
+auto calc_result_cache::insert(const key_type& key, const calc_val::variant_type& value) -> void {
+    auto size = entry_size(key);
+    if (size > shard_memory_cap)
+        return;
+
+    auto& s = shard_for(key);
+    auto lock = std::lock_guard(s.mutex);
+    if (auto itr = s.index.find(key); itr != s.index.end()) {
+        // another thread inserted it meanwhile; the value is necessarily the same
+        s.entries.splice(s.entries.begin(), s.entries, itr->second);
+        return;
+    }
+
+    while (s.bytes_in_use + size > shard_memory_cap) {
+        auto& lru = s.entries.back();
+        s.bytes_in_use -= entry_size(lru.key);
+        s.index.erase(lru.key);
+        s.entries.pop_back();
+    }
+
+    s.entries.push_front(entry{key, value});
+    s.index.emplace(s.entries.front().key, s.entries.begin());
+    s.bytes_in_use += size;
+}
+
+auto calc_result_cache::clear() -> void {
+    for (std::size_t i = 0; i < shard_count; ++i) {
+        auto& s = shards[i];
+        auto lock = std::lock_guard(s.mutex);
+        s.index.clear();
+        s.entries.clear();
+        s.bytes_in_use = 0;
+    }
+}
+
+auto calc_result_cache::stats() const -> statistics {
+    auto result = statistics{};
+    result.hits = hits.load(std::memory_order_relaxed);
+    result.misses = misses.load(std::memory_order_relaxed);
+    result.memory_cap = shard_memory_cap * shard_count;
+    for (std::size_t i = 0; i < shard_count; ++i) {
+        auto& s = shards[i];
+        auto lock = std::lock_guard(s.mutex);
+        result.entries += s.entries.size();
+        result.bytes_in_use += s.bytes_in_use;
+    }
+    return result;
+}
@@ -0,0 +1,82 @@
+#ifndef CALC_RESULT_CACHE_HPP
+#define CALC_RESULT_CACHE_HPP
+
+#include "variant_type.hpp"
+#include <atomic>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+class calc_result_cache {
+// cache of the values of math expressions, shared by any number of
+// calc_parsers, which may be used concurrently on different threads. entries
+// are keyed by a string that calc_parser builds from the expression's token
+// stream (so whitespace does not matter) and the parser options in effect;
+// calc_parser only caches expressions whose value depends on nothing else
+// (i.e., that don't reference or assign variables or "last").
+// the cache is split into shards, each with its own lock and least recently
+// used list, so that threads looking up different expressions rarely contend.
+// the memory cap is divided evenly among the shards; a shard evicts its least
+// recently used entries when an insertion would exceed its share
+public:
+    static constexpr std::size_t default_shard_count = 16;
+    static constexpr std::size_t default_memory_cap = 4 * 1024 * 1024;
+
+    explicit calc_result_cache(std::size_t memory_cap = default_memory_cap,
+        std::size_t shard_count = default_shard_count);
+    // memory_cap: approximate limit in bytes of the memory held by the
+    // entries (keys, values and bookkeeping)
+
+    calc_result_cache(const calc_result_cache&) = delete;
+    auto operator=(const calc_result_cache&) -> calc_result_cache& = delete;
+
+    using key_type = std::string;
+
+    auto find(const key_type& key) -> std::optional<calc_val::variant_type>;
+    auto insert(const key_type& key, const calc_val::variant_type& value) -> void;
+    auto clear() -> void;
+
+    struct statistics {
+        std::uint64_t hits = 0;
+        std::uint64_t misses = 0;
+        std::size_t entries = 0;
+        std::size_t bytes_in_use = 0;
+        std::size_t memory_cap = 0;
+
+        auto hit_rate() const -> double
+        {return hits + misses ? static_cast<double>(hits) / static_cast<double>(hits + misses) : 0;}
+        // of the lookups, 0 if there were none
+    };
+    auto stats() const -> statistics;
+
+private:
+    struct entry {
+        key_type key;
+        calc_val::variant_type value;
+    };
+    using lru_list = std::list<entry>; // most recently used first
+
+    struct shard {
+        mutable std::mutex mutex;
+        lru_list entries;
+        std::unordered_map<std::string_view, lru_list::iterator> index; // views refer to entries' keys
+        std::size_t bytes_in_use = 0;
+    };
+
+    std::unique_ptr<shard[]> shards;
+    std::size_t shard_count;
+    std::size_t shard_memory_cap;
+    std::atomic<std::uint64_t> hits = 0;
+    std::atomic<std::uint64_t> misses = 0;
+
+    auto shard_for(const key_type& key) -> shard&
+    {return shards[std::hash<std::string_view>()(key) % shard_count];}
+    static auto entry_size(const key_type& key) -> std::size_t;
+};
+
+#endif // CALC_RESULT_CACHE_HPP
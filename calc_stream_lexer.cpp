@@ -0,0 +1,84 @@
+#include "calc_stream_lexer.hpp"
+#include <cerrno>
+#include <system_error>
+#include <unistd.h>
+
+static constexpr std::size_t lookahead_guard = 4;
+// a token is accepted only if at least this many characters follow it in the
+// window (or the source is exhausted); calc_lexer looks at most 3 characters
+// past the end of a token to decide where the token ends (e.g., "1e+5")
+
+calc_stream_lexer::calc_stream_lexer(source_fn source_, std::size_t chunk_size_)
+    : source{std::move(source_)}, chunk_size{chunk_size_ ? chunk_size_ : default_chunk_size}
+{
+    window.reserve(chunk_size + lookahead_guard);
+}
+
+auto calc_stream_lexer::fd_source(int fd) -> source_fn {
+    return [fd](char* buf, std::size_t size) -> std::size_t {
+        for (;;) {
+            auto n = ::read(fd, buf, size);
+            if (n >= 0)
+                return static_cast<std::size_t>(n);
+            if (errno != EINTR)
+                throw std::system_error(errno, std::generic_category(), "read");
+        }
+    };
+}
+
+auto calc_stream_lexer::pull_chunk() -> void {
+    window.erase(0, window_pos);
+    window_offset += window_pos;
+    window_pos = 0;
+
+    auto size = window.size();
+    window.resize(size + chunk_size);
+    auto n = source(window.data() + size, chunk_size);
+    assert(n <= chunk_size);
+    window.resize(size + n);
+    if (!n)
+        at_eof = true;
+}
+
+auto calc_stream_lexer::get_token() -> lexer_token {
+    for (;;) {
+        auto lexer = calc_lexer(std::string_view(window).substr(window_pos), default_number_radix_);
+        auto token = lexer.get_token();
+        auto token_end = window_pos + token.view_offset + token.view.size();
+        if (at_eof || window.size() - token_end >= lookahead_guard) {
+            auto offset = window_offset + window_pos + token.view_offset;
+            window_pos = token_end;
+            return lexer_token{token.id, stable_view(token), offset};
+        }
+        pull_chunk(); // token may continue past the window or depend on what follows; rescan
+    }
+}
+
+auto calc_stream_lexer::stable_view(const lexer_token& token) -> std::string_view {
+    static constexpr std::string_view spellings[] = {
+        "+", "-", "*", "**", "/", "%", "(", ")", "!", "!!", "<<", ">>", "&", "|",
+        "^", "^|", "~", "=", "help", "delete", ","};
+
+    switch (token.id) {
+        case lexer_token::end:
+        case lexer_token::unspecified:
+            return {};
+        case lexer_token::identifier:
+            if (auto itr = identifiers.find(token.view); itr != identifiers.end())
+                return *itr;
+            return *identifiers.emplace(token.view).first;
+        case lexer_token::number:
+        case lexer_token::option:
+        case lexer_token::mfac:
+            break;
+        default:
+            for (auto spelling : spellings)
+                if (spelling == token.view)
+                    return spelling;
+            assert(false); // missed one; fallthru to ring
+    }
+
+    auto& text = ring[ring_pos++ % ring_size];
+    text.assign(token.view);
+    return text;
+}
@@ -0,0 +1,63 @@
+#ifndef CALC_STREAM_LEXER_HPP
+#define CALC_STREAM_LEXER_HPP
+
+#include "calc_lexer.hpp"
+#include <array>
+#include <functional>
+#include <set>
+#include <string>
+
+class calc_stream_lexer {
+// scans tokens from input that is pulled in chunks from a source (a callback
+// or a file descriptor) instead of from one contiguous string, so a very long
+// expression can be evaluated without materializing it. the input is held in
+// a window that is compacted as tokens are consumed; it only grows beyond the
+// chunk size to hold a token that is longer than that. tokens spanning chunk
+// boundaries are handled by pulling more input and rescanning.
+// the views of the tokens returned refer to storage owned by the lexer:
+// identifiers are interned (so the storage grows with the number of distinct
+// identifiers, not with the length of the input), tokens with fixed spellings
+// refer to static text, and other tokens (numbers, options, multifactorials)
+// are held in a small ring that is reused, so their views remain valid only
+// until ring_size more tokens are scanned. that suffices for
+// lookahead_calc_lexer, which holds at most three tokens
+public:
+    using source_fn = std::function<auto (char* buf, std::size_t size) -> std::size_t>;
+    // reads up to size characters into buf and returns the number read; 0
+    // means the end of the input
+
+    static constexpr std::size_t default_chunk_size = 64 * 1024;
+
+    explicit calc_stream_lexer(source_fn source_, std::size_t chunk_size_ = default_chunk_size);
+
+    static auto fd_source(int fd) -> source_fn;
+    // source that reads from a file descriptor; throws std::system_error on a
+    // read error
+
+    auto get_token() -> lexer_token;
+    // view_offset of the token returned is its offset from the start of the
+    // stream
+
+    void default_number_radix(calc_val::radices default_number_radix)
+    {default_number_radix_ = default_number_radix;}
+
+    static constexpr std::size_t ring_size = 4;
+
+private:
+    source_fn source;
+    std::size_t chunk_size;
+    calc_val::radices default_number_radix_ = calc_val::base10;
+
+    std::string window; // unconsumed input
+    std::size_t window_pos = 0; // position of the next character to scan in window
+    lexer_token::offset_type window_offset = 0; // stream offset of window[0]
+    bool at_eof = false;
+    auto pull_chunk() -> void;
+
+    std::set<std::string, std::less<>> identifiers;
+    std::array<std::string, ring_size> ring;
+    std::size_t ring_pos = 0;
+    auto stable_view(const lexer_token& token) -> std::string_view;
+};
+
+#endif // CALC_STREAM_LEXER_HPP
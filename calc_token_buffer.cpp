@@ -0,0 +1,85 @@
+#include "calc_token_buffer.hpp"
+
+calc_token_buffer::calc_token_buffer(std::string_view input, calc_val::radices default_number_radix,
+    std::pmr::memory_resource* resource)
+:
+    input_{input}, tokens{resource}
+{
+    assert(input.size() <= max_input_size);
+    tokens.reserve(input.size() / 4 + 2); // rough estimate to avoid most regrowth
+    tokenize_from(0, default_number_radix);
+}
+
+auto calc_token_buffer::tokenize_from(std::size_t offset, calc_val::radices default_number_radix) -> void {
+    auto lexer = calc_lexer(input_.substr(offset), default_number_radix);
+    for (;;) {
+        auto t = lexer.get_token();
+        tokens.push_back(token{
+            static_cast<std::uint32_t>(t.view_offset + offset),
+            static_cast<std::uint32_t>(t.view.size()),
+            static_cast<std::uint8_t>(t.id)});
+        if (t.id == lexer_token::end || t.id == lexer_token::unspecified)
+            break;
+    }
+}
+
+auto calc_token_buffer::retokenize_from(std::size_t index, calc_val::radices default_number_radix) -> void {
+    if (index >= tokens.size())
+        return; // last token is end or unspecified; nothing further to scan
+    std::size_t offset = 0;
+    if (index) {
+        auto& prev = tokens[index - 1];
+        offset = prev.offset + prev.length;
+    }
+    tokens.resize(index);
+    tokenize_from(offset, default_number_radix);
+}
+
+auto calc_token_buffer::replace(std::string_view new_input, std::size_t offset, std::size_t removed_length,
+    std::size_t inserted_length, calc_val::radices default_number_radix) -> replaced_tokens
+{
+    assert(new_input.size() <= max_input_size);
+    input_ = new_input;
+
+    // the first token that may change is the first whose scan may have
+    // examined a changed character. the last token (end or unspecified) is
+    // always scanned again, as it may move
+    std::size_t first = 0;
+    while (first + 1 < tokens.size() && tokens[first].offset + tokens[first].length + lexer_lookahead < offset)
+        ++first;
+    std::size_t scan_offset = 0;
+    if (first) {
+        auto& prev = tokens[first - 1];
+        scan_offset = prev.offset + prev.length;
+    }
+
+    auto removed_end = offset + removed_length;
+    auto delta = static_cast<std::ptrdiff_t>(inserted_length) - static_cast<std::ptrdiff_t>(removed_length);
+    auto moved_offset = [&](const token& t) {return static_cast<std::ptrdiff_t>(t.offset) + delta;};
+
+    auto scanned = std::pmr::vector<token>(tokens.get_allocator());
+    auto old_end = first;
+    auto lexer = calc_lexer(input_.substr(scan_offset), default_number_radix);
+    for (;;) {
+        auto t = lexer.get_token();
+        auto t_offset = static_cast<std::ptrdiff_t>(t.view_offset + scan_offset);
+        while (old_end < tokens.size() && (tokens[old_end].offset < removed_end || moved_offset(tokens[old_end]) < t_offset))
+            ++old_end;
+        if (old_end < tokens.size() && moved_offset(tokens[old_end]) == t_offset)
+            break; // the tokens from old_end on are the same
+        scanned.push_back(token{
+            static_cast<std::uint32_t>(t_offset),
+            static_cast<std::uint32_t>(t.view.size()),
+            static_cast<std::uint8_t>(t.id)});
+        if (t.id == lexer_token::end || t.id == lexer_token::unspecified) {
+            old_end = tokens.size();
+            break;
+        }
+    }
+
+    for (auto i = old_end; i < tokens.size(); ++i)
+        tokens[i].offset = static_cast<std::uint32_t>(moved_offset(tokens[i]));
+    auto position = tokens.erase(tokens.begin() + first, tokens.begin() + old_end);
+    tokens.insert(position, scanned.begin(), scanned.end());
+    return replaced_tokens{first, old_end, first + scanned.size()};
+}
@@ -0,0 +1,78 @@
+#ifndef CALC_TOKEN_BUFFER_HPP
+#define CALC_TOKEN_BUFFER_HPP
+
+#include "calc_lexer.hpp"
+#include <cstdint>
+#include <limits>
+#include <memory_resource>
+#include <vector>
+
+class calc_token_buffer {
+// tokenizes a whole input string up front (using calc_lexer) into a compact
+// token array. intended for long inputs, where scanning in one tight loop and
+// then stepping through the array by index is cheaper than lexing on demand
+// and shuffling full lexer_tokens through the lookahead slots
+public:
+    struct token {
+        std::uint32_t offset; // offset of token from start of input string
+        std::uint32_t length;
+        std::uint8_t id; // lexer_token::token_ids
+    };
+    static_assert(lexer_token::comma <= std::numeric_limits<decltype(token::id)>::max());
+
+    static constexpr std::size_t max_input_size = std::numeric_limits<std::uint32_t>::max();
+
+    calc_token_buffer(std::string_view input, calc_val::radices default_number_radix,
+        std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+    // input: the view must be valid for the lifetime of the class instance, and
+    // its size must not exceed max_input_size.
+    // the token array always ends with an end token or, if the input could not
+    // be completely tokenized, with the unspecified token at which calc_lexer
+    // stopped
+
+    auto size() const -> std::size_t {return tokens.size();}
+    auto operator[](std::size_t index) const -> const token&
+    {return tokens[index < tokens.size() ? index : tokens.size() - 1];}
+    // an index past the last token refers to the last token, mirroring
+    // calc_lexer, which keeps returning the token it stopped at
+
+    auto lexer_token_at(std::size_t index) const -> lexer_token;
+
+    auto retokenize_from(std::size_t index, calc_val::radices default_number_radix) -> void;
+    // rescans the tokens from index onward with a different default number
+    // radix; this mirrors calc_lexer::default_number_radix, which affects only
+    // tokens not yet scanned
+
+    struct replaced_tokens {
+        std::size_t first = 0; // index of the first token replaced
+        std::size_t old_end = 0; // tokens [first, old_end) were replaced
+        std::size_t new_end = 0; // by tokens [first, new_end)
+    };
+
+    auto replace(std::string_view new_input, std::size_t offset, std::size_t removed_length,
+        std::size_t inserted_length, calc_val::radices default_number_radix) -> replaced_tokens;
+    // updates the tokens for an edit of the input: new_input is the input with
+    // removed_length characters at offset replaced by inserted_length
+    // characters. only the tokens near the edit are scanned again, up to the
+    // first token that starts where a token after the edit started (from
+    // there on the tokens are the same, so they are just moved).
+    // default_number_radix must be the one the tokens were scanned with
+
+    auto input() const -> std::string_view {return input_;}
+
+private:
+    static constexpr std::size_t lexer_lookahead = 3;
+    // number of characters past the end of a token that calc_lexer may
+    // examine to find where the token ends (e.g., "e+1" after a number)
+
+    std::string_view input_;
+    std::pmr::vector<token> tokens;
+    auto tokenize_from(std::size_t offset, calc_val::radices default_number_radix) -> void;
+};
+
+inline auto calc_token_buffer::lexer_token_at(std::size_t index) const -> lexer_token {
+    auto& t = (*this)[index];
+    return lexer_token{static_cast<lexer_token::token_ids>(t.id), input_.substr(t.offset, t.length), t.offset};
+}
+
+#endif // CALC_TOKEN_BUFFER_HPP
@@ -0,0 +1,42 @@
+#include "calc_worker_pool.hpp"
+#include <algorithm>
+
+calc_worker_pool::calc_worker_pool(std::size_t thread_count) {
+    thread_count = std::max<std::size_t>(thread_count, 1);
+    threads.reserve(thread_count);
+    for (std::size_t i = 0; i < thread_count; ++i)
+        threads.emplace_back([this] {run();});
+}
+
+calc_worker_pool::~calc_worker_pool() {
+    {
+        auto lock = std::lock_guard(mutex);
+        stopping = true;
+    }
+    task_available.notify_all();
+    for (auto& thread : threads)
+        thread.join();
+}
+
+auto calc_worker_pool::submit(task t) -> void {
+    {
+        auto lock = std::lock_guard(mutex);
+        tasks.push_back(std::move(t));
+    }
+    task_available.notify_one();
+}
+
+auto calc_worker_pool::run() -> void {
+    for (;;) {
+        auto t = task();
+        {
+            auto lock = std::unique_lock(mutex);
+            task_available.wait(lock, [this] {return stopping || !tasks.empty();});
+            if (tasks.empty())
+                return; // stopping
+            t = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        t();
+    }
+}
@@ -0,0 +1,40 @@
+#ifndef CALC_WORKER_POOL_HPP
+#define CALC_WORKER_POOL_HPP
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class calc_worker_pool {
+// fixed set of threads that run submitted tasks in submission order. used by
+// calc_parser::evaluate_async; may be shared by any number of parsers
+public:
+    explicit calc_worker_pool(std::size_t thread_count = std::thread::hardware_concurrency());
+    // a thread_count of 0 is taken as 1
+    ~calc_worker_pool();
+    // runs the tasks still queued, then joins the threads
+
+    calc_worker_pool(const calc_worker_pool&) = delete;
+    auto operator=(const calc_worker_pool&) -> calc_worker_pool& = delete;
+
+    using task = std::function<void()>;
+    auto submit(task t) -> void;
+    // t must not throw
+
+    auto thread_count() const -> std::size_t {return threads.size();}
+
+private:
+    std::mutex mutex;
+    std::condition_variable task_available;
+    std::deque<task> tasks;
+    bool stopping = false;
+    std::vector<std::thread> threads; // must follow the members the threads use
+
+    auto run() -> void;
+};
+
+#endif // CALC_WORKER_POOL_HPP
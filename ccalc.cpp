@@ -0,0 +1,174 @@
+#include "ccalc.h"
+#include "calc_outputter.hpp"
+#include "calc_parser.hpp"
+#include <ostream>
+#include <streambuf>
+
+// the c interface (see ccalc.h)
+
+static_assert(int(CCALC_NO_ERROR) == int(calc_parse_error::no_error)
+    && int(CCALC_OUT_OF_MEMORY_ERROR) == int(calc_parse_error::out_of_memory)
+    && int(CCALC_INTERNAL_PARSE_ERROR) == int(calc_parse_error::internal_error)
+    && CCALC_INTERNAL_PARSE_ERROR + 1 == calc_parse_error::error_txt.size(),
+    "ccalc_error_code must match calc_parse_error::error_codes");
+
+namespace {
+
+class output_buffer : public std::streambuf {
+// stream buffer writing to a caller's fixed size buffer; counts what doesn't fit
+public:
+    auto reset(char* begin, std::size_t size) -> void {
+        setp(begin, begin + size);
+        overflowed_ = 0;
+    }
+    auto written() const -> std::size_t {return static_cast<std::size_t>(pptr() - pbase());}
+    auto overflowed() const -> std::size_t {return overflowed_;}
+
+protected:
+    auto overflow(int_type c) -> int_type override {
+        if (!traits_type::eq_int_type(c, traits_type::eof()))
+            ++overflowed_;
+        return traits_type::not_eof(c);
+    }
+
+private:
+    std::size_t overflowed_ = 0;
+};
+
+auto valid_options(const ccalc_options& options) -> bool {
+    auto valid_radix = [](unsigned radix) {
+        return radix == calc_val::base2 || radix == calc_val::base8 || radix == calc_val::base10
+            || radix == calc_val::base16;
+    };
+    return (options.number_type == calc_val::complex_code || options.number_type == calc_val::uint_code
+            || options.number_type == calc_val::int_code)
+        && valid_radix(options.radix) && valid_radix(options.output_radix)
+        && (options.int_word_size == calc_val::int_bits_8 || options.int_word_size == calc_val::int_bits_16
+            || options.int_word_size == calc_val::int_bits_32 || options.int_word_size == calc_val::int_bits_64
+            || options.int_word_size == calc_val::int_bits_128 || options.int_word_size == calc_val::int_bits_256
+            || options.int_word_size == calc_val::int_bits_512 || options.int_word_size == calc_val::int_bits_1024)
+        && options.output_fp_normalized <= 1;
+}
+
+auto set_error(ccalc_result* first, ccalc_result* last, calc_parse_error::error_codes error) -> void {
+    for (; first != last; ++first)
+        *first = ccalc_result{CCALC_ERROR, 0, static_cast<std::uint16_t>(error), 0, 0, 0};
+}
+
+} // namespace
+
+struct ccalc_session {
+    calc_parser parser;
+    output_options out_options;
+    output_buffer buffer;
+    std::ostream out{&buffer};
+    calc_parser::help_callback help = [] {};
+};
+
+extern "C" {
+
+auto ccalc_session_create() -> ccalc_session* {
+    try {
+        return new ccalc_session;
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+auto ccalc_session_destroy(ccalc_session* session) -> void {
+    delete session;
+}
+
+auto ccalc_session_get_options(const ccalc_session* session, ccalc_options* options) -> int {
+    if (!session || !options)
+        return CCALC_INVALID_ARGUMENT;
+    auto parser_options_ = session->parser.options();
+    options->number_type = static_cast<std::uint8_t>(parser_options_.default_number_type_code);
+    options->radix = static_cast<std::uint8_t>(parser_options_.default_number_radix);
+    options->int_word_size = static_cast<std::uint16_t>(parser_options_.int_word_size);
+    options->output_radix = static_cast<std::uint8_t>(session->out_options.output_radix);
+    options->output_fp_normalized = session->out_options.output_fp_normalized;
+    options->precision = session->out_options.precision;
+    return CCALC_OK;
+}
+
+auto ccalc_session_set_options(ccalc_session* session, const ccalc_options* options) -> int {
+    if (!session || !options || !valid_options(*options))
+        return CCALC_INVALID_ARGUMENT;
+    auto parser_options_ = parser_options();
+    parser_options_.default_number_type_code = static_cast<calc_val::number_type_codes>(options->number_type);
+    parser_options_.default_number_radix = static_cast<calc_val::radices>(options->radix);
+    parser_options_.int_word_size = static_cast<calc_val::int_word_sizes>(options->int_word_size);
+    session->parser.options(parser_options_);
+    session->out_options.output_radix = static_cast<calc_val::radices>(options->output_radix);
+    session->out_options.output_fp_normalized = options->output_fp_normalized;
+    session->out_options.precision = options->precision;
+    return CCALC_OK;
+}
+
+auto ccalc_evaluate_batch(
+    ccalc_session* session,
+    const char* input,
+    const size_t* offsets,
+    size_t count,
+    ccalc_result* results,
+    char* output,
+    size_t output_size,
+    size_t* output_needed
+) -> int
+{
+    if (!session || (count && (!input || !offsets || !results)) || (output_size && !output))
+        return CCALC_INVALID_ARGUMENT;
+    for (std::size_t i = 0; i < count; ++i)
+        if (offsets[i] > offsets[i + 1])
+            return CCALC_INVALID_ARGUMENT;
+
+    auto& buffer = session->buffer;
+    auto used = std::size_t(0); // of output
+    auto needed = std::size_t(0);
+    auto status = CCALC_OK;
+    for (std::size_t i = 0; i < count; ++i) {
+        auto& result = results[i];
+        result = ccalc_result{CCALC_VOID, 0, CCALC_NO_ERROR, 0, used, 0};
+        auto expression = std::string_view(input + offsets[i], offsets[i + 1] - offsets[i]);
+        try {
+            auto evaluated = session->parser.try_evaluate(expression, session->help, session->out_options);
+            if (evaluated.error) {
+                result.kind = CCALC_ERROR;
+                result.error_code = static_cast<std::uint16_t>(evaluated.error->error());
+                result.error_offset = static_cast<std::uint32_t>(evaluated.error->token().view_offset);
+            } else if (evaluated.void_kind == calc_parser::not_void) {
+                result.kind = CCALC_VALUE;
+                buffer.reset(output + used, output_size - used);
+                session->out << calc_outputter(session->out_options)(evaluated.value);
+                result.output_length = buffer.written();
+                used += buffer.written();
+                needed += buffer.written() + buffer.overflowed();
+                if (buffer.overflowed()) {
+                    result.output_truncated = 1;
+                    status = CCALC_OUTPUT_TRUNCATED;
+                    output_size = used; // the values that follow are left empty
+                }
+            }
+        } catch (const std::bad_alloc&) {
+            set_error(results + i, results + count, calc_parse_error::out_of_memory);
+            status = CCALC_OUT_OF_MEMORY;
+            break;
+        } catch (...) {
+            set_error(results + i, results + count, calc_parse_error::internal_error);
+            status = CCALC_INTERNAL_ERROR;
+            break;
+        }
+    }
+    if (output_needed)
+        *output_needed = needed;
+    return status;
+}
+
+auto ccalc_error_text(int error_code) -> const char* {
+    if (error_code < 0 || static_cast<std::size_t>(error_code) >= calc_parse_error::error_txt.size())
+        return nullptr;
+    return calc_parse_error::error_txt[error_code];
+}
+
+} // extern "C"
@@ -0,0 +1,112 @@
+#ifndef CCALC_H
+#define CCALC_H
+
+// c interface to calc_parser and calc_outputter, for use from c and from
+// other languages' foreign function interfaces. no c++ exception crosses it:
+// every function reports failure by its return value.
+//
+// a session is a calc_parser with its output options. a session may be used
+// by one thread at a time; different sessions may be used concurrently.
+// expressions are read in place from the caller's buffer and values are
+// formatted straight into the caller's output buffer
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CCALC_API_VERSION 1
+
+typedef struct ccalc_session ccalc_session;
+
+enum ccalc_status {
+    CCALC_OK,
+    CCALC_OUTPUT_TRUNCATED, // the output buffer was too small for every result
+    CCALC_INVALID_ARGUMENT,
+    CCALC_OUT_OF_MEMORY,
+    CCALC_INTERNAL_ERROR
+};
+
+enum ccalc_error_code {
+// as calc_parse_error::error_codes, in the same order
+    CCALC_NO_ERROR, CCALC_SYNTAX_ERROR, CCALC_NUMBER_EXPECTED, CCALC_UNDEFINED_IDENTIFIER,
+    CCALC_TOKEN_EXPECTED, CCALC_INTEGER_NUMBER_EXPECTED, CCALC_OUT_OF_RANGE,
+    CCALC_INVALID_NUMBER, CCALC_INVALID_OPERAND, CCALC_INVALID_LEFT_OPERAND,
+    CCALC_INVALID_RIGHT_OPERAND,
+    CCALC_NEGATIVE_SHIFT_INVALID, CCALC_INTEGER_DIVISION_BY_0,
+    CCALC_MFAC_UNSUPPORTED, CCALC_INVALID_OPTION, CCALC_TOO_MANY_OPTIONS,
+    CCALC_OPTION_MUST_PREFACE_MATH_EXPR,
+    CCALC_UNEXPECTED_END_OF_INPUT, CCALC_INVALID_SHIFT_ARG,
+    CCALC_OP_DOMAIN_POSITIVE_REAL_ONLY,
+    CCALC_OP_DOMAIN_REAL_ONLY,
+    CCALC_VARIABLE_IDENTIFIER_EXPECTED, CCALC_CANT_DELETE_INTERNAL,
+    CCALC_HELP_INVALID_HERE, CCALC_FORMULA_CYCLE, CCALC_VARIABLE_USED_BY_FORMULA,
+    CCALC_ASSIGNMENT_IN_FORMULA, CCALC_EVALUATION_CANCELLED, CCALC_DEADLINE_EXCEEDED,
+    CCALC_WIDE_INT_FN_UNSUPPORTED, CCALC_OUT_OF_MEMORY_ERROR, CCALC_INTERNAL_PARSE_ERROR
+};
+
+enum ccalc_result_kind {
+    CCALC_VALUE, // the output holds the formatted value
+    CCALC_VOID, // blank input, help, delete or options only; the output is empty
+    CCALC_ERROR // error_code and error_offset are set; the output is empty
+};
+
+typedef struct ccalc_options {
+    uint8_t number_type; // 0 complex, 1 uint, 2 int (as calc_val::number_type_codes)
+    uint8_t radix; // 2, 8, 10 or 16: radix of numbers without a prefix
+    uint16_t int_word_size; // 8, 16, 32, 64, 128, 256, 512 or 1024
+    uint8_t output_radix; // 2, 8, 10 or 16
+    uint8_t output_fp_normalized; // 0 or 1
+    uint32_t precision; // significant digits of floating point output
+} ccalc_options;
+
+typedef struct ccalc_result {
+    uint8_t kind; // a ccalc_result_kind
+    uint8_t output_truncated; // 1 if the output didn't fit in what was left of the output buffer
+    uint16_t error_code; // a ccalc_error_code
+    uint32_t error_offset; // offset in the expression of the token with the error
+    size_t output_offset; // offset in the output buffer of the formatted value
+    size_t output_length;
+} ccalc_result;
+
+ccalc_session* ccalc_session_create(void);
+// returns null if out of memory
+
+void ccalc_session_destroy(ccalc_session* session);
+// session may be null
+
+int ccalc_session_get_options(const ccalc_session* session, ccalc_options* options);
+int ccalc_session_set_options(ccalc_session* session, const ccalc_options* options);
+// set_options returns CCALC_INVALID_ARGUMENT, leaving the session unchanged, if
+// an option is out of range. expressions may change the options too
+
+int ccalc_evaluate_batch(
+    ccalc_session* session,
+    const char* input,
+    const size_t* offsets,
+    size_t count,
+    ccalc_result* results,
+    char* output,
+    size_t output_size,
+    size_t* output_needed);
+// evaluates count expressions in order, expression i being input[offsets[i]]
+// up to input[offsets[i + 1]] (offsets has count + 1 elements), and sets
+// results[i] for it. formatted values are written one after another to
+// output, without terminators. if they don't all fit, every expression is
+// still evaluated, the values that don't fit are truncated (the first to
+// overflow) or empty (the rest), and CCALC_OUTPUT_TRUNCATED is returned.
+// *output_needed (if output_needed isn't null) is set to the size the output
+// buffer needed to be. CCALC_OUT_OF_MEMORY and CCALC_INTERNAL_ERROR end the
+// batch early; the results of expressions not evaluated are set to
+// CCALC_ERROR with the corresponding error code
+
+const char* ccalc_error_text(int error_code);
+// static text for a ccalc_error_code, or null if it isn't one
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CCALC_H
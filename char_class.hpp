@@ -0,0 +1,107 @@
+#ifndef CHAR_CLASS_HPP
+#define CHAR_CLASS_HPP
+
+// ascii character classification for the lexer. unlike the <cctype>
+// functions these are not locale dependent and are safe for negative char
+// values (non-ascii bytes simply belong to no class). the skip_ functions
+// scan a run of characters of a class 16 at a time where sse2 is available
+
+#include <array>
+#include <cstdint>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace calc_val {
+
+namespace helper { // implementation helpers; not meant for public use
+    enum char_class_bits : std::uint8_t {
+        space_bit = 1, digit_bit = 2, alpha_bit = 4, underscore_bit = 8};
+
+    constexpr auto char_class_lut = [] {
+        std::array<std::uint8_t, 256> lut{};
+        for (auto c : {' ', '\t', '\n', '\v', '\f', '\r'})
+            lut[static_cast<unsigned char>(c)] = space_bit;
+        for (auto c = '0'; c <= '9'; ++c)
+            lut[static_cast<unsigned char>(c)] = digit_bit;
+        for (auto c = 'a'; c <= 'z'; ++c)
+            lut[static_cast<unsigned char>(c)] = alpha_bit;
+        for (auto c = 'A'; c <= 'Z'; ++c)
+            lut[static_cast<unsigned char>(c)] = alpha_bit;
+        lut['_'] = underscore_bit;
+        return lut;
+    }();
+
+    inline auto char_class(char c) -> std::uint8_t
+    {return char_class_lut[static_cast<unsigned char>(c)];}
+}
+
+inline auto is_space(char c) -> bool {return helper::char_class(c) & helper::space_bit;}
+inline auto is_digit10(char c) -> bool {return helper::char_class(c) & helper::digit_bit;}
+inline auto is_alpha(char c) -> bool {return helper::char_class(c) & helper::alpha_bit;}
+inline auto is_alnum(char c) -> bool {return helper::char_class(c) & (helper::alpha_bit | helper::digit_bit);}
+inline auto is_identifier_char(char c) -> bool
+{return helper::char_class(c) & (helper::alpha_bit | helper::digit_bit | helper::underscore_bit);}
+
+inline auto to_lower(char c) -> char
+{return is_alpha(c) ? static_cast<char>(c | 0x20) : c;}
+
+#if defined(__SSE2__)
+namespace helper {
+    template <typename Match, typename IsChar>
+    inline auto skip_while(const char* p, const char* end, Match match, IsChar is_char) -> const char* {
+    // match(v) returns a byte mask of the bytes in v that belong to the class
+        for (; end - p >= 16; p += 16) {
+            auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            auto mask = static_cast<unsigned>(_mm_movemask_epi8(match(v))) ^ 0xffffu;
+            if (mask)
+                return p + __builtin_ctz(mask);
+        }
+        while (p < end && is_char(*p))
+            ++p;
+        return p;
+    }
+
+    inline auto in_range(__m128i v, char lo, char hi) -> __m128i {
+    // signed comparisons; bytes >= 0x80 are negative and thus never in range
+    // of the ascii bounds used here
+        return _mm_and_si128(
+            _mm_cmpgt_epi8(v, _mm_set1_epi8(static_cast<char>(lo - 1))),
+            _mm_cmplt_epi8(v, _mm_set1_epi8(static_cast<char>(hi + 1))));
+    }
+}
+
+inline auto skip_space(const char* p, const char* end) -> const char* {
+    return helper::skip_while(p, end, [](__m128i v) {
+        return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), helper::in_range(v, '\t', '\r'));
+    }, is_space);
+}
+
+inline auto skip_digits10(const char* p, const char* end) -> const char* {
+    return helper::skip_while(p, end, [](__m128i v) {
+        return helper::in_range(v, '0', '9');
+    }, is_digit10);
+}
+
+inline auto skip_identifier_chars(const char* p, const char* end) -> const char* {
+    return helper::skip_while(p, end, [](__m128i v) {
+        auto lower = _mm_or_si128(v, _mm_set1_epi8(0x20));
+        return _mm_or_si128(
+            _mm_or_si128(helper::in_range(lower, 'a', 'z'), helper::in_range(v, '0', '9')),
+            _mm_cmpeq_epi8(v, _mm_set1_epi8('_')));
+    }, is_identifier_char);
+}
+#else
+inline auto skip_space(const char* p, const char* end) -> const char*
+{while (p < end && is_space(*p)) ++p; return p;}
+
+inline auto skip_digits10(const char* p, const char* end) -> const char*
+{while (p < end && is_digit10(*p)) ++p; return p;}
+
+inline auto skip_identifier_chars(const char* p, const char* end) -> const char*
+{while (p < end && is_identifier_char(*p)) ++p; return p;}
+#endif
+
+} // namespace calc_val
+
+#endif // CHAR_CLASS_HPP
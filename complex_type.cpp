@@ -1,4 +1,5 @@
 #include "complex_type.hpp"
+#include "calc_cancellation.hpp"
 #include <boost/math/constants/constants.hpp>
 
 namespace calc_val {
@@ -7,6 +8,8 @@ auto helper::pow_uint_e(const complex_type& z_in, max_uint_type e) -> complex_ty
     auto z = z_in;
     auto z_ = (e & 1) ? z : complex_type(1);
     while (e >>= 1) {
+        if (cancellation_requested())
+            break;
         z *= z;
         if (e & 1)
             z_ *= z;
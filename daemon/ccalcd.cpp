@@ -0,0 +1,441 @@
+// ccalcd: hosts calc_parser sessions for local clients over a unix domain
+// socket (see ccalcd_protocol.hpp).
+// usage: ccalcd [-s socket_path] [-t threads] [-m session_memory_limit]
+//
+// the main thread runs an epoll loop that accepts connections, reads
+// requests and writes the responses that couldn't be written at once.
+// requests are evaluated by a calc_worker_pool; each session is a strand: its
+// requests are queued and run one after another by one task at a time, so
+// sessions run concurrently but a session's requests run in order
+
+#include "ccalcd_protocol.hpp"
+#include "calc_parser.hpp"
+#include "calc_outputter.hpp"
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+struct connection {
+    explicit connection(int fd_) : fd{fd_} {}
+
+    const int fd;
+    std::string in; // received bytes not yet parsed; used by the loop only
+    bool read_closed = false; // the client shut down its side; used by the loop only
+
+    std::mutex mutex; // for the members below
+    std::string out; // responses not yet written
+    bool closed = false; // fd is closed; responses are discarded
+    std::size_t in_flight = 0; // requests not yet answered
+};
+
+struct job {
+    std::shared_ptr<connection> conn;
+    ccalcd::request request;
+};
+
+struct session {
+    calc_parser parser;
+    output_options out_options;
+    std::deque<job> jobs; // guarded by server::sessions_mutex
+    bool running = false; // ditto; a task of the pool is running the jobs
+};
+
+class server {
+public:
+    server(const char* socket_path, std::size_t thread_count, std::size_t session_memory_limit);
+    ~server();
+    auto run() -> void;
+
+private:
+    std::string socket_path;
+    std::size_t session_memory_limit;
+    int listen_fd = -1;
+    int epoll_fd = -1;
+    int wake_fd = -1; // eventfd by which workers wake the loop
+    int signal_fd = -1;
+    std::unordered_map<int, std::shared_ptr<connection>> connections;
+
+    std::mutex woken_mutex;
+    std::vector<std::shared_ptr<connection>> woken; // connections the loop must attend to
+
+    std::mutex sessions_mutex;
+    std::unordered_map<std::uint64_t, std::shared_ptr<session>> sessions;
+
+    calc_worker_pool pool; // must follow the members the tasks use
+
+    auto accept_connections() -> void;
+    auto read_requests(const std::shared_ptr<connection>& conn) -> void;
+    auto attend(const std::shared_ptr<connection>& conn) -> void;
+    auto close_connection(const std::shared_ptr<connection>& conn) -> void;
+    auto watch(const connection& conn, bool out) -> void;
+
+    auto dispatch(const std::shared_ptr<connection>& conn, ccalcd::request&& request) -> void;
+    auto run_session(const std::shared_ptr<session>& s) -> void;
+    auto evaluate(session& s, const ccalcd::request& request) -> ccalcd::response;
+    auto respond(const std::shared_ptr<connection>& conn, const ccalcd::response& response) -> void;
+    auto wake(const std::shared_ptr<connection>& conn) -> void;
+};
+
+auto stop_signals() -> sigset_t {
+// blocked in every thread and received by the loop's signalfd
+    sigset_t signals;
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    return signals;
+}
+
+[[noreturn]] auto fail_system(const char* what) -> void {
+    std::cerr << "ccalcd: " << what << ": " << std::strerror(errno) << "\n";
+    std::exit(EXIT_FAILURE);
+}
+
+auto send_some(int fd, std::string& out) -> bool {
+// sends as much of out as the socket takes and removes it from out; returns
+// false if the connection is broken
+    while (!out.empty()) {
+        auto n = ::send(fd, out.data(), out.size(), MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        out.erase(0, static_cast<std::size_t>(n));
+    }
+    return true;
+}
+
+server::server(const char* socket_path_, std::size_t thread_count, std::size_t session_memory_limit_)
+:
+    socket_path{socket_path_}, session_memory_limit{session_memory_limit_}, pool{thread_count}
+{
+    auto address = sockaddr_un();
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "ccalcd: socket path is too long\n";
+        std::exit(EXIT_FAILURE);
+    }
+    std::strcpy(address.sun_path, socket_path.c_str());
+
+    listen_fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0)
+        fail_system("socket");
+    ::unlink(socket_path.c_str()); // a stale socket of an earlier run
+    auto old_mask = ::umask(0077); // only the user may connect
+    auto bound = ::bind(listen_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address));
+    ::umask(old_mask);
+    if (bound < 0)
+        fail_system("bind");
+    if (::listen(listen_fd, SOMAXCONN) < 0)
+        fail_system("listen");
+
+    epoll_fd = ::epoll_create1(EPOLL_CLOEXEC);
+    wake_fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    auto signals = stop_signals();
+    signal_fd = ::signalfd(-1, &signals, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (epoll_fd < 0 || wake_fd < 0 || signal_fd < 0)
+        fail_system("epoll/eventfd/signalfd");
+
+    for (auto fd : {listen_fd, wake_fd, signal_fd}) {
+        auto event = epoll_event();
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+            fail_system("epoll_ctl");
+    }
+}
+
+server::~server() {
+    auto conns = std::vector<std::shared_ptr<connection>>();
+    for (auto& [fd, conn] : connections)
+        conns.push_back(conn);
+    for (auto& conn : conns)
+        close_connection(conn);
+    ::close(listen_fd);
+    ::unlink(socket_path.c_str());
+}
+
+auto server::run() -> void {
+// the loop's epoll data is the fd; a connection is found by its fd
+    epoll_event events[64];
+    for (;;) {
+        auto n = ::epoll_wait(epoll_fd, events, std::size(events), -1);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            fail_system("epoll_wait");
+        }
+        for (int i = 0; i < n; ++i) {
+            auto fd = events[i].data.fd;
+            if (fd == signal_fd)
+                return;
+            if (fd == listen_fd)
+                accept_connections();
+            else if (fd == wake_fd) {
+                std::uint64_t count;
+                [[maybe_unused]] auto r = ::read(wake_fd, &count, sizeof(count));
+                auto conns = decltype(woken)();
+                {
+                    auto lock = std::lock_guard(woken_mutex);
+                    conns.swap(woken);
+                }
+                for (auto& conn : conns)
+                    attend(conn);
+            } else if (auto itr = connections.find(fd); itr != connections.end()) {
+                auto conn = itr->second;
+                if (events[i].events & (EPOLLHUP | EPOLLERR))
+                    close_connection(conn); // the client is gone; its responses can't be delivered
+                else if (events[i].events & EPOLLIN)
+                    read_requests(conn);
+                if (events[i].events & EPOLLOUT)
+                    attend(conn);
+            }
+        }
+    }
+}
+
+auto server::accept_connections() -> void {
+    for (;;) {
+        auto fd = ::accept4(listen_fd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED)
+                continue;
+            return; // EAGAIN, or out of descriptors, in which case the client waits
+        }
+        auto conn = std::make_shared<connection>(fd);
+        connections.emplace(fd, conn);
+        auto event = epoll_event();
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        if (::epoll_ctl(epoll_fd, EPOLL_CTL_ADD, fd, &event) < 0)
+            close_connection(conn);
+    }
+}
+
+auto server::read_requests(const std::shared_ptr<connection>& conn) -> void {
+    char buf[64 * 1024];
+    for (;;) {
+        auto n = ::recv(conn->fd, buf, sizeof(buf), 0);
+        if (n > 0) {
+            conn->in.append(buf, static_cast<std::size_t>(n));
+            continue;
+        }
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            break;
+        // end of input or error: answer the requests received, then close
+        conn->read_closed = true;
+        break;
+    }
+
+    auto in = std::string_view(conn->in);
+    try {
+        while (auto frame = ccalcd::next_frame(in))
+            dispatch(conn, ccalcd::parse_request(*frame));
+    } catch (const ccalcd::invalid_frame&) {
+        close_connection(conn); // the rest of the input can't be framed
+        return;
+    }
+    conn->in.erase(0, conn->in.size() - in.size());
+
+    if (conn->read_closed) {
+        watch(*conn, false);
+        attend(conn);
+    }
+}
+
+auto server::attend(const std::shared_ptr<connection>& conn) -> void {
+// writes the connection's pending responses, and closes it once the client
+// has finished and every request has been answered
+    auto lock = std::unique_lock(conn->mutex);
+    if (conn->closed)
+        return;
+    if (!send_some(conn->fd, conn->out)) {
+        lock.unlock();
+        close_connection(conn);
+        return;
+    }
+    auto done = conn->read_closed && conn->in_flight == 0 && conn->out.empty();
+    auto out_pending = !conn->out.empty();
+    lock.unlock();
+    if (done)
+        close_connection(conn);
+    else
+        watch(*conn, out_pending);
+}
+
+auto server::watch(const connection& conn, bool out) -> void {
+    auto event = epoll_event();
+    event.events = (conn.read_closed ? 0u : EPOLLIN) | (out ? EPOLLOUT : 0u);
+    event.data.fd = conn.fd;
+    ::epoll_ctl(epoll_fd, EPOLL_CTL_MOD, conn.fd, &event);
+}
+
+auto server::close_connection(const std::shared_ptr<connection>& conn) -> void {
+    {
+        auto lock = std::lock_guard(conn->mutex);
+        if (conn->closed)
+            return;
+        conn->closed = true;
+        ::close(conn->fd); // also removes it from the epoll set
+    }
+    connections.erase(conn->fd);
+}
+
+auto server::dispatch(const std::shared_ptr<connection>& conn, ccalcd::request&& request) -> void {
+    {
+        auto lock = std::lock_guard(conn->mutex);
+        ++conn->in_flight;
+    }
+
+    auto s = std::shared_ptr<session>();
+    auto start = false;
+    {
+        auto lock = std::lock_guard(sessions_mutex);
+        auto& slot = sessions[request.session];
+        if (!slot) {
+            slot = std::make_shared<session>();
+            if (session_memory_limit)
+                slot->parser.memory_limit(session_memory_limit);
+        }
+        s = slot;
+        if (request.flags & ccalcd::close_session)
+            sessions.erase(request.session); // s and its queued jobs live on
+        s->jobs.push_back(job{conn, std::move(request)});
+        start = !s->running;
+        s->running = true;
+    }
+    if (start)
+        pool.submit([this, s] {run_session(s);});
+}
+
+auto server::run_session(const std::shared_ptr<session>& s) -> void {
+    for (;;) {
+        auto j = job();
+        {
+            auto lock = std::lock_guard(sessions_mutex);
+            if (s->jobs.empty()) {
+                s->running = false;
+                return;
+            }
+            j = std::move(s->jobs.front());
+            s->jobs.pop_front();
+        }
+        respond(j.conn, evaluate(*s, j.request));
+        auto lock = std::lock_guard(j.conn->mutex);
+        if (--j.conn->in_flight == 0 && j.conn->read_closed && !j.conn->closed)
+            wake(j.conn); // to be closed
+    }
+}
+
+auto server::evaluate(session& s, const ccalcd::request& request) -> ccalcd::response {
+    auto response = ccalcd::response();
+    response.id = request.id;
+    if (request.flags & ccalcd::has_options) {
+        s.parser.options(request.options);
+        s.out_options = request.out_options;
+    }
+
+    try {
+        auto result = s.parser.try_evaluate(request.expression, [] {}, s.out_options);
+        if (result.error) {
+            response.status = ccalcd::error_status;
+            response.error_offset = static_cast<std::uint32_t>(result.error->token().view_offset);
+            response.text = result.error->error_str();
+        } else if (result.void_kind != calc_parser::not_void)
+            response.status = ccalcd::void_status;
+        else {
+            auto text = std::ostringstream();
+            text << calc_outputter(s.out_options)(result.value);
+            response.text = std::move(text).str();
+        }
+    } catch (const std::bad_alloc&) {
+        response.status = ccalcd::error_status;
+        response.text = "Error: out of memory.";
+    } catch (...) { // as the c api's internal_error; the session lives on
+        response.status = ccalcd::error_status;
+        response.text = "Error: internal error.";
+    }
+    return response;
+}
+
+auto server::respond(const std::shared_ptr<connection>& conn, const ccalcd::response& response) -> void {
+// writes the response at once if nothing is pending before it; what the
+// socket doesn't take is left to the loop
+    auto lock = std::lock_guard(conn->mutex);
+    if (conn->closed)
+        return;
+    auto was_empty = conn->out.empty();
+    ccalcd::append_frame(conn->out, response);
+    if (was_empty) {
+        send_some(conn->fd, conn->out); // a broken connection is noticed by the loop
+        if (!conn->out.empty())
+            wake(conn);
+    }
+}
+
+auto server::wake(const std::shared_ptr<connection>& conn) -> void {
+    {
+        auto lock = std::lock_guard(woken_mutex);
+        woken.push_back(conn);
+    }
+    std::uint64_t one = 1;
+    [[maybe_unused]] auto r = ::write(wake_fd, &one, sizeof(one));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto socket_path = std::string();
+    if (auto dir = std::getenv("XDG_RUNTIME_DIR"))
+        socket_path = std::string(dir) + "/ccalcd.sock";
+    else
+        socket_path = "/tmp/ccalcd.sock";
+    std::size_t thread_count = std::thread::hardware_concurrency();
+    std::size_t session_memory_limit = 0;
+
+    int opt;
+    while ((opt = ::getopt(argc, argv, "s:t:m:")) != -1) {
+        switch (opt) {
+            case 's':
+                socket_path = optarg;
+                break;
+            case 't':
+                thread_count = std::strtoul(optarg, nullptr, 10);
+                break;
+            case 'm':
+                session_memory_limit = std::strtoul(optarg, nullptr, 10);
+                break;
+            default:
+                std::cerr << "usage: ccalcd [-s socket_path] [-t threads] [-m session_memory_limit]\n";
+                return EXIT_FAILURE;
+        }
+    }
+
+    auto signals = stop_signals();
+    pthread_sigmask(SIG_BLOCK, &signals, nullptr); // before the pool's threads are started
+    auto s = server(socket_path.c_str(), thread_count, session_memory_limit);
+    s.run();
+    return EXIT_SUCCESS;
+}
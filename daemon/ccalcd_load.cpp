@@ -0,0 +1,210 @@
+// ccalcd_load: load generator for ccalcd.
+// usage: ccalcd_load [-s socket_path] [-c connections] [-n requests] [-b batch] [-e expression]...
+//
+// each connection runs on its own thread with its own session and sends its
+// requests in batches of -b pipelined requests, reading the batch's responses
+// before sending the next. the expressions given by -e (or a default mix)
+// are sent in turn. reports the throughput and the batch latencies
+
+#include "ccalcd_protocol.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+using std::chrono::steady_clock;
+
+struct load_options {
+    std::string socket_path;
+    std::size_t connections = 4;
+    std::size_t requests = 100000; // per connection
+    std::size_t batch = 64;
+    std::vector<std::string> expressions;
+};
+
+struct connection_stats {
+    std::size_t responses = 0;
+    std::size_t errors = 0; // error_status responses
+    bool failed = false; // the connection broke
+    std::vector<double> batch_latencies; // in microseconds
+};
+
+auto connect_to(const std::string& socket_path) -> int {
+    auto address = sockaddr_un();
+    address.sun_family = AF_UNIX;
+    if (socket_path.size() >= sizeof(address.sun_path))
+        return -1;
+    std::strcpy(address.sun_path, socket_path.c_str());
+    auto fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd >= 0 && ::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        ::close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+auto send_all(int fd, std::string_view out) -> bool {
+    while (!out.empty()) {
+        auto n = ::send(fd, out.data(), out.size(), MSG_NOSIGNAL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return false;
+        out.remove_prefix(static_cast<std::size_t>(n));
+    }
+    return true;
+}
+
+auto run_connection(const load_options& options, std::uint64_t session, connection_stats& stats) -> void {
+    auto fd = connect_to(options.socket_path);
+    if (fd < 0) {
+        stats.failed = true;
+        return;
+    }
+
+    auto out = std::string();
+    auto in = std::string();
+    char buf[64 * 1024];
+    auto next_expression = session; // connections start at different expressions
+    for (std::size_t sent = 0; sent < options.requests && !stats.failed; ) {
+        auto batch = std::min(options.batch, options.requests - sent);
+        out.clear();
+        for (std::size_t i = 0; i < batch; ++i) {
+            auto r = ccalcd::request();
+            r.id = static_cast<std::uint32_t>(sent + i);
+            r.session = session;
+            r.expression = options.expressions[next_expression++ % options.expressions.size()];
+            ccalcd::append_frame(out, r);
+        }
+        sent += batch;
+
+        auto start = steady_clock::now();
+        if (!send_all(fd, out)) {
+            stats.failed = true;
+            break;
+        }
+        for (std::size_t received = 0; received < batch; ) {
+            auto n = ::recv(fd, buf, sizeof(buf), 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0) {
+                stats.failed = true;
+                break;
+            }
+            in.append(buf, static_cast<std::size_t>(n));
+            auto view = std::string_view(in);
+            try {
+                while (auto frame = ccalcd::next_frame(view)) {
+                    if (ccalcd::parse_response(*frame).status == ccalcd::error_status)
+                        ++stats.errors;
+                    ++received;
+                    ++stats.responses;
+                }
+            } catch (const ccalcd::invalid_frame&) {
+                stats.failed = true;
+                break;
+            }
+            in.erase(0, in.size() - view.size());
+        }
+        stats.batch_latencies.push_back(
+            std::chrono::duration<double, std::micro>(steady_clock::now() - start).count());
+    }
+    ::close(fd);
+}
+
+auto percentile(std::vector<double>& sorted, double p) -> double {
+    if (sorted.empty())
+        return 0;
+    return sorted[std::min(sorted.size() - 1, static_cast<std::size_t>(p * sorted.size()))];
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    auto options = load_options();
+    if (auto dir = std::getenv("XDG_RUNTIME_DIR"))
+        options.socket_path = std::string(dir) + "/ccalcd.sock";
+    else
+        options.socket_path = "/tmp/ccalcd.sock";
+
+    int opt;
+    while ((opt = ::getopt(argc, argv, "s:c:n:b:e:")) != -1) {
+        switch (opt) {
+            case 's':
+                options.socket_path = optarg;
+                break;
+            case 'c':
+                options.connections = std::max(1ul, std::strtoul(optarg, nullptr, 10));
+                break;
+            case 'n':
+                options.requests = std::strtoul(optarg, nullptr, 10);
+                break;
+            case 'b':
+                options.batch = std::max(1ul, std::strtoul(optarg, nullptr, 10));
+                break;
+            case 'e':
+                options.expressions.push_back(optarg);
+                break;
+            default:
+                std::cerr << "usage: ccalcd_load [-s socket_path] [-c connections] [-n requests] [-b batch]"
+                    " [-e expression]...\n";
+                return EXIT_FAILURE;
+        }
+    }
+    if (options.expressions.empty())
+        options.expressions = {
+            "1 + 2 * 3",
+            "sqrt(2) * pi / 4",
+            "sin(0.5)^2 + cos(0.5)^2",
+            "x = 12345678901234567890 * 3",
+            "x % 97 + exp(1.5)",
+            "(1 + 2i) * (3 - 4i)",
+            "0x7f << 4 | 0b1010",
+            "1 / 0",
+        };
+
+    auto stats = std::vector<connection_stats>(options.connections);
+    auto threads = std::vector<std::thread>();
+    auto start = steady_clock::now();
+    for (std::size_t i = 0; i < options.connections; ++i)
+        threads.emplace_back(run_connection, std::cref(options), i + 1, std::ref(stats[i]));
+    for (auto& t : threads)
+        t.join();
+    auto seconds = std::chrono::duration<double>(steady_clock::now() - start).count();
+
+    auto responses = std::size_t(0);
+    auto errors = std::size_t(0);
+    auto failed = std::size_t(0);
+    auto latencies = std::vector<double>();
+    for (auto& s : stats) {
+        responses += s.responses;
+        errors += s.errors;
+        failed += s.failed;
+        latencies.insert(latencies.end(), s.batch_latencies.begin(), s.batch_latencies.end());
+    }
+    std::sort(latencies.begin(), latencies.end());
+    auto mean = latencies.empty() ? 0.0 : std::accumulate(latencies.begin(), latencies.end(), 0.0) / latencies.size();
+
+    std::cout << std::fixed << std::setprecision(1)
+        << responses << " responses (" << errors << " errors) in " << seconds << " s: "
+        << responses / seconds << " requests/s\n"
+        << "batch latency (" << options.batch << " requests): mean " << mean << " us, p50 "
+        << percentile(latencies, 0.5) << " us, p99 " << percentile(latencies, 0.99) << " us\n";
+    if (failed) {
+        std::cout << failed << " connections failed\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
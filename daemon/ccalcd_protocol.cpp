@@ -0,0 +1,148 @@
+#include "ccalcd_protocol.hpp"
+
+namespace ccalcd {
+
+namespace {
+
+template <typename T>
+auto put(std::string& out, T x) -> void {
+    for (std::size_t i = 0; i < sizeof(T); ++i)
+        out += static_cast<char>(static_cast<std::uint8_t>(x >> (8 * i)));
+}
+
+class frame_reader {
+// reads the fields of a frame; throws invalid_frame if the frame is too short
+// or a field is invalid
+public:
+    explicit frame_reader(std::string_view frame) : in{frame} {}
+
+    template <typename T>
+    auto get() -> T {
+        if (in.size() < sizeof(T))
+            throw invalid_frame();
+        T x = 0;
+        for (std::size_t i = 0; i < sizeof(T); ++i)
+            x |= static_cast<T>(static_cast<std::uint8_t>(in[i])) << (8 * i);
+        in.remove_prefix(sizeof(T));
+        return x;
+    }
+
+    auto get_number_type_code() -> calc_val::number_type_codes {
+        auto code = get<std::uint8_t>();
+        if (code != calc_val::complex_code && code != calc_val::uint_code && code != calc_val::int_code)
+            throw invalid_frame();
+        return static_cast<calc_val::number_type_codes>(code);
+    }
+
+    auto get_radix() -> calc_val::radices {
+        auto radix = get<std::uint8_t>();
+        if (radix != calc_val::base2 && radix != calc_val::base8 && radix != calc_val::base10 && radix != calc_val::base16)
+            throw invalid_frame();
+        return static_cast<calc_val::radices>(radix);
+    }
+
+    auto get_int_word_size() -> calc_val::int_word_sizes {
+        auto size = get<std::uint16_t>();
+        if (size != calc_val::int_bits_8 && size != calc_val::int_bits_16 && size != calc_val::int_bits_32
+                && size != calc_val::int_bits_64 && size != calc_val::int_bits_128 && size != calc_val::int_bits_256
+                && size != calc_val::int_bits_512 && size != calc_val::int_bits_1024)
+            throw invalid_frame();
+        return static_cast<calc_val::int_word_sizes>(size);
+    }
+
+    auto rest() -> std::string_view {auto r = in; in = {}; return r;}
+
+private:
+    std::string_view in;
+};
+
+auto begin_frame(std::string& out) -> std::size_t {
+// appends a placeholder for the size of a frame; returns its position
+    auto position = out.size();
+    put<std::uint32_t>(out, 0);
+    return position;
+}
+
+auto end_frame(std::string& out, std::size_t position) -> void {
+    auto size = static_cast<std::uint32_t>(out.size() - position - sizeof(std::uint32_t));
+    for (std::size_t i = 0; i < sizeof(size); ++i)
+        out[position + i] = static_cast<char>(static_cast<std::uint8_t>(size >> (8 * i)));
+}
+
+} // namespace
+
+auto append_frame(std::string& out, const request& r) -> void {
+    auto position = begin_frame(out);
+    put(out, r.id);
+    put(out, r.session);
+    put(out, r.flags);
+    if (r.flags & has_options) {
+        put<std::uint8_t>(out, r.options.default_number_type_code);
+        put<std::uint8_t>(out, r.options.default_number_radix);
+        put<std::uint16_t>(out, r.options.int_word_size);
+        put<std::uint8_t>(out, r.out_options.output_radix);
+        put<std::uint8_t>(out, r.out_options.output_fp_normalized);
+        put<std::uint32_t>(out, r.out_options.precision);
+    }
+    out += r.expression;
+    end_frame(out, position);
+}
+
+auto append_frame(std::string& out, const response& r) -> void {
+    auto position = begin_frame(out);
+    put(out, r.id);
+    put<std::uint8_t>(out, r.status);
+    if (r.status == error_status)
+        put(out, r.error_offset);
+    out += r.text;
+    end_frame(out, position);
+}
+
+auto next_frame(std::string_view& in) -> std::optional<std::string_view> {
+    if (in.size() < sizeof(std::uint32_t))
+        return std::nullopt;
+    auto size = frame_reader(in).get<std::uint32_t>();
+    if (size > max_frame_size)
+        throw invalid_frame();
+    if (in.size() - sizeof(std::uint32_t) < size)
+        return std::nullopt;
+    auto frame = in.substr(sizeof(std::uint32_t), size);
+    in.remove_prefix(sizeof(std::uint32_t) + size);
+    return frame;
+}
+
+auto parse_request(std::string_view frame) -> request {
+    auto reader = frame_reader(frame);
+    auto r = request();
+    r.id = reader.get<std::uint32_t>();
+    r.session = reader.get<std::uint64_t>();
+    r.flags = reader.get<std::uint8_t>();
+    if (r.flags & ~(has_options | close_session))
+        throw invalid_frame();
+    if (r.flags & has_options) {
+        r.options.default_number_type_code = reader.get_number_type_code();
+        r.options.default_number_radix = reader.get_radix();
+        r.options.int_word_size = reader.get_int_word_size();
+        r.out_options.output_radix = reader.get_radix();
+        r.out_options.output_fp_normalized = reader.get<std::uint8_t>() != 0;
+        r.out_options.precision = reader.get<std::uint32_t>();
+    }
+    r.expression = reader.rest();
+    return r;
+}
+
+auto parse_response(std::string_view frame) -> response {
+    auto reader = frame_reader(frame);
+    auto r = response();
+    r.id = reader.get<std::uint32_t>();
+    auto status = reader.get<std::uint8_t>();
+    if (status != value_status && status != void_status && status != error_status)
+        throw invalid_frame();
+    r.status = static_cast<response_statuses>(status);
+    if (r.status == error_status)
+        r.error_offset = reader.get<std::uint32_t>();
+    r.text = reader.rest();
+    return r;
+}
+
+} // namespace ccalcd
@@ -0,0 +1,74 @@
+#ifndef CCALCD_PROTOCOL_HPP
+#define CCALCD_PROTOCOL_HPP
+
+// frames of the ccalcd protocol. integers are little-endian. a frame is its
+// size (u32: the number of bytes that follow) followed by
+//
+// request:  id (u32), session (u64), flags (u8),
+//           [ number type code (u8), radix (u8), int word size (u16),
+//             output radix (u8), output fp normalized (u8), precision (u32) ],
+//           expression (the rest of the frame)
+// response: id (u32), status (u8), [ error offset (u32) ],
+//           text (the rest of the frame)
+//
+// the options (in brackets) are present if flags has has_options; they are
+// set for the session before the expression is evaluated, as if by
+// calc_parser::options and by replacing the session's output options. if
+// flags has close_session the session is discarded after the request (a later
+// request with the same id starts a new session).
+// a response has the id of its request. its text is the value formatted with
+// the session's output options for value_status, empty for void_status, and
+// the error message for error_status, in which case the error offset (the
+// offset of the error's token in the expression) precedes it.
+// a client may send any number of requests without waiting for responses.
+// the requests of a session are evaluated in the order received; responses
+// to requests of different sessions may arrive in any order
+
+#include "calc_args.hpp"
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace ccalcd {
+
+constexpr std::size_t max_frame_size = 1 << 20;
+
+enum request_flags : std::uint8_t {has_options = 1, close_session = 2};
+
+enum response_statuses : std::uint8_t {value_status, void_status, error_status};
+
+struct request {
+    std::uint32_t id = 0;
+    std::uint64_t session = 0;
+    std::uint8_t flags = 0;
+    parser_options options; // if flags has has_options
+    output_options out_options; // ditto
+    std::string expression;
+};
+
+struct response {
+    std::uint32_t id = 0;
+    response_statuses status = value_status;
+    std::uint32_t error_offset = 0; // if status is error_status
+    std::string text;
+};
+
+struct invalid_frame {}; // exception
+
+auto append_frame(std::string& out, const request& r) -> void;
+auto append_frame(std::string& out, const response& r) -> void;
+// append r, as a frame, to out
+
+auto next_frame(std::string_view& in) -> std::optional<std::string_view>;
+// if in starts with a complete frame, removes it from in and returns its
+// bytes after the size. throws invalid_frame if the frame's size exceeds
+// max_frame_size
+
+auto parse_request(std::string_view frame) -> request;
+auto parse_response(std::string_view frame) -> response;
+// frame is as returned by next_frame; throws invalid_frame if it's malformed
+
+} // namespace ccalcd
+
+#endif // CCALCD_PROTOCOL_HPP
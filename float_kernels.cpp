@@ -0,0 +1,749 @@
+#include "float_kernels.hpp"
+
+#if CALC_FLOAT_KERNELS
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstdint>
+#include <utility>
+
+namespace calc_val {
+
+namespace helper {
+
+using std::uint64_t;
+using u128 = unsigned __int128;
+using float_backend = boost::multiprecision::backends::cpp_bin_float<100>;
+using complex_backend = boost::multiprecision::backends::complex_adaptor<float_backend>;
+
+constexpr unsigned n_bits = float_backend::bit_count;
+constexpr unsigned n_limbs = (n_bits + 63) / 64;
+static_assert(n_bits == 334 && n_limbs == 6);
+
+using significand = std::array<uint64_t, n_limbs>;
+
+struct unpacked {
+    significand bits; // the top bit (n_bits - 1) is 1, or all are 0 for 0 (of either sign)
+    long long exponent; // of the top bit, as in cpp_bin_float
+    bool sign;
+
+    friend auto operator==(const unpacked& x, const unpacked& y) -> bool = default;
+};
+
+static inline auto is_normal(const float_backend& x) -> bool {
+// finite, not 0, and with the top bit of the significand set. boost's own
+// arithmetic is sometimes on floats that aren't, as the partial sums of its
+// conversion from double, whose exponent starts at 0 with a significand of 0
+    return x.exponent() <= float_backend::max_exponent && x.bits().size() == n_limbs
+        && x.bits().limbs()[n_limbs - 1] >> (n_bits - 1) % 64;
+}
+
+static inline auto is_ordinary(const float_backend& x) -> bool
+{return is_normal(x) || x.exponent() == float_backend::exponent_zero;}
+
+static inline auto unpack(const float_backend& x) -> unpacked {
+    assert(is_ordinary(x));
+    auto r = unpacked{{}, x.exponent(), x.sign()};
+    if (is_normal(x))
+        std::copy_n(x.bits().limbs(), n_limbs, r.bits.begin());
+    return r;
+}
+
+static inline auto fits(const unpacked& x) -> bool // neither overflows nor underflows
+{return !x.bits.back() || (x.exponent <= float_backend::max_exponent && x.exponent >= float_backend::min_exponent);}
+
+static inline auto pack(float_backend& res, const unpacked& x) -> bool {
+// false, leaving res alone, if x doesn't fit
+    if (!x.bits.back()) {
+        res.bits() = boost::multiprecision::limb_type(0);
+        res.exponent() = float_backend::exponent_zero;
+        res.sign() = x.sign;
+        return true;
+    }
+    if (!fits(x))
+        return false;
+    res.bits().resize(n_limbs, n_limbs);
+    std::copy(x.bits.begin(), x.bits.end(), res.bits().limbs());
+    res.exponent() = static_cast<float_backend::exponent_type>(x.exponent);
+    res.sign() = x.sign;
+    return true;
+}
+
+template <std::size_t N>
+static inline auto top_bit(const std::array<uint64_t, N>& x) -> unsigned { // x != 0
+    auto i = N;
+    while (!x[--i])
+        ;
+    return i * 64 + 63 - __builtin_clzll(x[i]);
+}
+
+template <std::size_t N>
+static auto round_to_significand(const std::array<uint64_t, N>& x, long long& exponent) -> significand {
+// x (not 0) to n_bits bits, rounded to nearest even as boost's copy_and_round
+// rounds; exponent is that of bit 0 of x on entry and of the top bit on return
+    auto msb = top_bit(x);
+    exponent += msb;
+    auto r = significand{};
+    if (msb < n_bits - 1) { // exact; only after cancellation
+        auto shift = n_bits - 1 - msb;
+        auto limbs = shift / 64, bits = shift % 64;
+        for (auto i = limbs; i < n_limbs; ++i) {
+            auto k = i - limbs;
+            r[i] = bits ? x[k] << bits | (k ? x[k - 1] >> (64 - bits) : 0) : x[k];
+        }
+        return r;
+    }
+
+    auto shift = msb - (n_bits - 1);
+    auto limbs = shift / 64, bits = shift % 64;
+    for (unsigned i = 0; i < n_limbs; ++i) {
+        auto k = i + limbs;
+        auto next = k + 1 < N ? x[k + 1] : 0;
+        r[i] = bits ? x[k] >> bits | next << (64 - bits) : x[k];
+    }
+    if (!shift)
+        return r;
+
+    auto round_pos = shift - 1;
+    auto round = x[round_pos / 64] >> (round_pos % 64) & 1;
+    auto sticky = x[round_pos / 64] & ((uint64_t(1) << (round_pos % 64)) - 1);
+    for (unsigned i = 0; i < round_pos / 64; ++i)
+        sticky |= x[i];
+    if (round && (sticky || r[0] & 1)) {
+        for (auto& limb : r) {
+            if (++limb)
+                break;
+        }
+        if (r.back() >> (n_bits % 64)) { // all ones rounded up to the next power of 2
+            r.back() >>= 1;
+            ++exponent;
+        }
+    }
+    return r;
+}
+
+static inline auto negated(unpacked x) -> unpacked {
+    x.sign = !x.sign;
+    return x;
+}
+
+static auto mul(const unpacked& x, const unpacked& y) -> unpacked {
+// schoolbook; the 36 limb products are unrolled by the compiler
+    if (!x.bits.back() || !y.bits.back())
+        return unpacked{{}, 0, x.sign != y.sign};
+    auto p = std::array<uint64_t, 2 * n_limbs>{};
+    for (unsigned i = 0; i < n_limbs; ++i) {
+        auto carry = uint64_t(0);
+        for (unsigned j = 0; j < n_limbs; ++j) {
+            auto t = static_cast<u128>(x.bits[i]) * y.bits[j] + p[i + j] + carry;
+            p[i + j] = static_cast<uint64_t>(t);
+            carry = static_cast<uint64_t>(t >> 64);
+        }
+        p[i + n_limbs] = carry;
+    }
+    auto r = unpacked{{}, x.exponent + y.exponent - 2 * (n_bits - 1), x.sign != y.sign};
+    r.bits = round_to_significand(p, r.exponent);
+    return r;
+}
+
+static inline auto reciprocal(uint64_t d) -> uint64_t // d has its top bit set
+{return static_cast<uint64_t>(~u128(0) / d);}
+
+static inline auto div_2by1(uint64_t u1, uint64_t u0, uint64_t d, uint64_t v, uint64_t& r) -> uint64_t {
+// <u1, u0> / d for u1 < d, with v = reciprocal(d): 2 limb products instead of
+// a 128-bit division (moller and granlund's division by invariant integers)
+    auto q = static_cast<u128>(v) * u1 + (static_cast<u128>(u1) << 64 | u0);
+    auto q1 = static_cast<uint64_t>(q >> 64) + 1, q0 = static_cast<uint64_t>(q);
+    r = u0 - q1 * d;
+    if (r > q0) {
+        --q1;
+        r += d;
+    }
+    if (r >= d) {
+        ++q1;
+        r -= d;
+    }
+    return q1;
+}
+
+static auto div(const unpacked& x, const unpacked& y) -> unpacked {
+// y not 0. knuth's algorithm d, with the significands shifted so the top bit
+// of y is the top bit of its top limb and x shifted n_limbs limbs further, so
+// the quotient has 384 or 385 bits; a remainder that isn't 0 is the sticky bit
+    if (!x.bits.back())
+        return unpacked{{}, 0, x.sign != y.sign};
+    constexpr auto shift = 63 - (n_bits - 1) % 64;
+    auto v = significand{};
+    auto u = std::array<uint64_t, 2 * n_limbs + 1>{};
+    for (unsigned i = 0; i < n_limbs; ++i) {
+        v[i] = y.bits[i] << shift | (i ? y.bits[i - 1] >> (64 - shift) : 0);
+        u[i + n_limbs] = x.bits[i] << shift | (i ? x.bits[i - 1] >> (64 - shift) : 0);
+    }
+    auto d = v[n_limbs - 1], d_reciprocal = reciprocal(d);
+    auto q = std::array<uint64_t, n_limbs + 1>{};
+    for (auto j = n_limbs + 1; j-- > 0;) {
+        auto qhat = ~uint64_t(0), rhat = uint64_t(0);
+        auto rhat_overflow = false;
+        if (u[j + n_limbs] < d)
+            qhat = div_2by1(u[j + n_limbs], u[j + n_limbs - 1], d, d_reciprocal, rhat);
+        else { // u[j + n_limbs] == d
+            rhat = u[j + n_limbs - 1] + d;
+            rhat_overflow = rhat < d;
+        }
+        while (!rhat_overflow && static_cast<u128>(qhat) * v[n_limbs - 2]
+                > (static_cast<u128>(rhat) << 64 | u[j + n_limbs - 2])) {
+            --qhat;
+            rhat += d;
+            rhat_overflow = rhat < d;
+        }
+
+        auto carry = uint64_t(0), borrow = uint64_t(0);
+        for (unsigned i = 0; i < n_limbs; ++i) {
+            auto p = static_cast<u128>(qhat) * v[i] + carry;
+            carry = static_cast<uint64_t>(p >> 64);
+            auto t = static_cast<u128>(u[i + j]) - static_cast<uint64_t>(p) - borrow;
+            u[i + j] = static_cast<uint64_t>(t);
+            borrow = static_cast<uint64_t>(t >> 64) & 1;
+        }
+        auto t = static_cast<u128>(u[j + n_limbs]) - carry - borrow;
+        u[j + n_limbs] = static_cast<uint64_t>(t);
+        if (static_cast<uint64_t>(t >> 64) & 1) { // qhat was 1 too big
+            --qhat;
+            carry = 0;
+            for (unsigned i = 0; i < n_limbs; ++i) {
+                auto s = static_cast<u128>(u[i + j]) + v[i] + carry;
+                u[i + j] = static_cast<uint64_t>(s);
+                carry = static_cast<uint64_t>(s >> 64);
+            }
+            u[j + n_limbs] += carry;
+        }
+        q[j] = qhat;
+    }
+    q[0] |= std::any_of(u.begin(), u.begin() + n_limbs, [](auto limb) {return limb != 0;});
+
+    auto r = unpacked{{}, x.exponent - y.exponent - 64 * n_limbs, x.sign != y.sign};
+    r.bits = round_to_significand(q, r.exponent);
+    return r;
+}
+
+static auto div(const unpacked& x, uint64_t n) -> unpacked {
+// n not 0. x shifted up 2 limbs, so the quotient has at least 397 bits, and
+// divided a limb at a time; a remainder that isn't 0 is the sticky bit
+    if (!x.bits.back())
+        return x;
+    auto shift = static_cast<unsigned>(__builtin_clzll(n));
+    auto d = n << shift, d_reciprocal = reciprocal(d);
+    auto u = std::array<uint64_t, n_limbs + 3>{};
+    for (unsigned i = 0; i < n_limbs; ++i) {
+        u[i + 2] |= x.bits[i] << shift;
+        u[i + 3] = shift ? x.bits[i] >> (64 - shift) : 0;
+    }
+    auto q = std::array<uint64_t, n_limbs + 3>{};
+    auto rem = uint64_t(0);
+    for (auto i = u.size(); i-- > 0;)
+        q[i] = div_2by1(rem, u[i], d, d_reciprocal, rem);
+    q[0] |= rem != 0;
+
+    auto r = unpacked{{}, x.exponent - (n_bits - 1) - 128, x.sign};
+    r.bits = round_to_significand(q, r.exponent);
+    return r;
+}
+
+static auto less(const significand& x, const significand& y) -> bool {
+    for (auto i = n_limbs; i-- > 0;) {
+        if (x[i] != y[i])
+            return x[i] < y[i];
+    }
+    return false;
+}
+
+static auto add(const unpacked& x, const unpacked& y, unpacked& r) -> bool {
+// false for a difference that boost approximates (of numbers more than n_bits
+// apart). the smaller operand is aligned to the larger with a limb of bits
+// below it, and any bits shifted out of that are or'ed into its bottom bit:
+// that keeps whether the exact result is a tie, and the rounding of both sum
+// and difference (which shifts left by at most 1 bit when it needs rounding)
+    if (!x.bits.back() || !y.bits.back()) { // as boost: 0 + 0 is -0 only if both are
+        r = y.bits.back() ? y : x.bits.back() ? x : unpacked{{}, 0, x.sign && y.sign};
+        return true;
+    }
+    auto a = &x, b = &y;
+    auto subtract = x.sign != y.sign;
+    if (a->exponent < b->exponent || (subtract && a->exponent == b->exponent && less(a->bits, b->bits)))
+        std::swap(a, b);
+    auto d = a->exponent - b->exponent;
+    if (d > static_cast<long long>(n_bits)) {
+        if (subtract)
+            return false;
+        r = *a;
+        return true;
+    }
+
+    using accumulator = std::array<uint64_t, n_limbs + 1>;
+    auto acc = accumulator{}, addend = accumulator{};
+    std::copy(a->bits.begin(), a->bits.end(), acc.begin() + 1);
+    auto limbs = static_cast<unsigned>(d) / 64, bits = static_cast<unsigned>(d) % 64;
+    auto sticky = uint64_t(0);
+    for (unsigned i = 0; i + limbs < addend.size(); ++i) {
+        auto k = i + limbs; // in b->bits, of the limb above addend[i]
+        auto lo = k ? b->bits[k - 1] : 0;
+        auto hi = k < n_limbs ? b->bits[k] : 0;
+        addend[i] = bits ? lo >> bits | hi << (64 - bits) : lo;
+    }
+    if (limbs)
+        sticky = bits ? b->bits[limbs - 1] << (64 - bits) : 0;
+    for (unsigned i = 0; i + 1 < limbs; ++i)
+        sticky |= b->bits[i];
+    addend[0] |= sticky != 0;
+
+    if (subtract) {
+        auto borrow = uint64_t(0);
+        for (unsigned i = 0; i < acc.size(); ++i) {
+            auto t = static_cast<u128>(acc[i]) - addend[i] - borrow;
+            acc[i] = static_cast<uint64_t>(t);
+            borrow = static_cast<uint64_t>(t >> 64) & 1;
+        }
+        if (std::all_of(acc.begin(), acc.end(), [](auto limb) {return !limb;})) {
+            r = unpacked{{}, 0, false};
+            return true;
+        }
+    } else {
+        auto carry = uint64_t(0);
+        for (unsigned i = 0; i < acc.size(); ++i) {
+            auto t = static_cast<u128>(acc[i]) + addend[i] + carry;
+            acc[i] = static_cast<uint64_t>(t);
+            carry = static_cast<uint64_t>(t >> 64);
+        }
+    }
+    r.exponent = a->exponent - (n_bits - 1) - 64;
+    r.bits = round_to_significand(acc, r.exponent);
+    r.sign = a->sign;
+    return true;
+}
+
+static auto add(float_backend& res, const float_backend& a, const float_backend& b, bool b_sign) -> bool {
+// res = a + b, with the sign of b replaced by b_sign; false if boost is to do it
+    if (!is_ordinary(a) || !is_ordinary(b))
+        return false;
+    auto y = unpack(b);
+    y.sign = b_sign;
+    auto r = unpacked();
+    return add(unpack(a), y, r) && pack(res, r);
+}
+
+static auto mul(float_backend& res, const float_backend& a, const float_backend& b) -> bool {
+    if (!is_ordinary(a) || !is_ordinary(b))
+        return false;
+    return pack(res, mul(unpack(a), unpack(b)));
+}
+
+static auto div(float_backend& res, const float_backend& a, const float_backend& b) -> bool {
+    if (!is_ordinary(a) || !is_normal(b))
+        return false;
+    return pack(res, div(unpack(a), unpack(b)));
+}
+
+static auto div(float_backend& res, const float_backend& a, uint64_t n, bool negate) -> bool {
+// res = a / n, negated if negate (for a negative divisor, as boost does it)
+    if (!is_ordinary(a) || !n)
+        return false;
+    auto r = div(unpack(a), n);
+    r.sign ^= negate;
+    return pack(res, r);
+}
+
+static auto mul_add(float_backend& res, const float_backend& a, const float_backend& b, bool negate) -> bool {
+// the product is rounded, as it would be in a float, but stays unpacked
+    if (!is_ordinary(res) || !is_ordinary(a) || !is_ordinary(b))
+        return false;
+    auto p = mul(unpack(a), unpack(b));
+    if (!fits(p))
+        return false;
+    p.sign ^= negate;
+    auto r = unpacked();
+    return add(unpack(res), p, r) && pack(res, r);
+}
+
+static auto complex_mul(complex_backend& res, const complex_backend& z) -> bool {
+// res *= z as boost computes it, (ac - bd) + (ad + bc)i with each product and
+// sum rounded, but without making floats of the products. the products of a
+// 0 part are 0s, so multiplying by a real or imaginary number is 2 of the 4
+// limb products; squaring is 3, as ad and bc are equal and their sum is ad
+// with the exponent 1 more
+    if (!is_ordinary(res.real_data()) || !is_ordinary(res.imag_data())
+            || !is_ordinary(z.real_data()) || !is_ordinary(z.imag_data()))
+        return false;
+    auto a = unpack(res.real_data()), b = unpack(res.imag_data());
+    auto c = unpack(z.real_data()), d = unpack(z.imag_data());
+    auto square = a == c && b == d;
+    auto ac = mul(a, c), bd = mul(b, d), ad = mul(a, d);
+    auto bc = square ? ad : mul(b, c);
+    auto re = unpacked(), im = unpacked();
+    if (!fits(ac) || !fits(bd) || !fits(ad) || !fits(bc) || !add(ac, negated(bd), re))
+        return false;
+    if (square && ad.bits.back()) {
+        im = ad;
+        ++im.exponent;
+    } else if (!add(ad, bc, im))
+        return false;
+    if (!fits(re) || !fits(im))
+        return false;
+    pack(res.real_data(), re);
+    pack(res.imag_data(), im);
+    return true;
+}
+
+static auto complex_div(complex_backend& res, const complex_backend& z) -> bool {
+// res /= z for an imaginary z (boost divides by a real z's real part itself).
+// boost's smith's algorithm then has c/d = 0 and a denominator of d, so it is
+// ((a * 0 + b) / d) + ((b * 0 - a) / d)i: 2 divisions instead of 3, and no
+// products. the 0s keep the signs boost gives them
+    if (z.real_data().exponent() != float_backend::exponent_zero || !is_normal(z.imag_data())
+            || !is_ordinary(res.real_data()) || !is_ordinary(res.imag_data()))
+        return false;
+    auto a = unpack(res.real_data()), b = unpack(res.imag_data());
+    auto ratio_sign = z.real_data().sign() != z.imag_data().sign();
+    auto re = unpacked(), im = unpacked();
+    add(unpacked{{}, 0, a.sign != ratio_sign}, b, re);
+    add(unpacked{{}, 0, b.sign != ratio_sign}, negated(a), im);
+    auto d = z.imag_data(); // z may be res
+    auto numerator = float_backend();
+    pack(numerator, re);
+    eval_divide(res.real_data(), numerator, d);
+    pack(numerator, im);
+    eval_divide(res.imag_data(), numerator, d);
+    return true;
+}
+
+using boost::multiprecision::limb_type;
+using boost::multiprecision::signed_limb_type;
+
+struct trig_reduction {
+// of x (normal) as boost's sin and cos reduce it: by the nearest lower
+// multiple of pi, then to pi - xx if above pi/2. the results are kept too, so
+// sin and cos of the same x (exp of an imaginary number, tan of a complex
+// number, or the same call again) reduce x and sum their series once
+    float_backend x;
+    float_backend xx; // in [0, pi/2], or a rounding error below 0
+    float_backend t; // pi/2 - xx
+    bool sin_negate, cos_negate;
+    bool sin_beyond, cos_beyond; // x is too big to reduce: sin is 0 and cos is 1
+    bool cos_pi_half; // xx was exactly pi/2 before it was reflected
+    bool has_sin, has_cos;
+    float_backend sin, cos;
+};
+
+static auto tenth() -> const float_backend& {
+// boost's threshold of its series about 0 and pi/2
+    static const auto x = float_backend(float(1e-1));
+    return x;
+}
+
+static auto reduce(trig_reduction& r, const float_backend& x) -> void {
+    using boost::multiprecision::default_ops::get_constant_one_over_epsilon;
+    using boost::multiprecision::default_ops::get_constant_pi;
+    using boost::multiprecision::default_ops::eval_fmod;
+    using boost::multiprecision::default_ops::eval_get_sign;
+    using boost::multiprecision::default_ops::eval_ldexp;
+    using boost::multiprecision::default_ops::eval_trunc;
+    const auto& pi = get_constant_pi<float_backend>();
+    r.x = x;
+    r.xx = x;
+    r.sin_negate = r.cos_negate = r.sin_beyond = r.cos_beyond = r.has_sin = r.has_cos = false;
+    if (x.sign()) {
+        r.xx.negate();
+        r.sin_negate = true;
+    }
+    if (r.xx.compare(pi) > 0) {
+        auto n = float_backend(), n_pi = float_backend(), parity = float_backend();
+        eval_divide(n, r.xx, pi);
+        eval_trunc(n, n);
+        parity = limb_type(2);
+        eval_fmod(parity, n, parity);
+        eval_multiply(n_pi, n, pi);
+        const auto& limit = get_constant_one_over_epsilon<float_backend>();
+        r.sin_beyond = n_pi.compare(limit) > 0;
+        r.cos_beyond = n.compare(limit) > 0;
+        eval_subtract(r.xx, n_pi);
+        if (eval_get_sign(parity)) {
+            r.sin_negate = !r.sin_negate;
+            r.cos_negate = !r.cos_negate;
+        }
+    }
+    auto half_pi = float_backend();
+    eval_ldexp(half_pi, pi, -1);
+    auto com = r.xx.compare(half_pi);
+    if (com > 0) {
+        eval_subtract(r.xx, pi, r.xx);
+        r.cos_negate = !r.cos_negate;
+    }
+    r.cos_pi_half = com == 0;
+    eval_subtract(r.t, half_pi, r.xx);
+}
+
+static auto hyp0f1(float_backend* res[2], const float_backend* b[2], const float_backend& x) -> void {
+// boost's hyp0F1 series of 1 or 2 (res[1] null if 1) values of b for the
+// same x, sharing their powers of x over n!
+    using boost::multiprecision::default_ops::eval_add;
+    using boost::multiprecision::default_ops::eval_get_sign;
+    using boost::multiprecision::default_ops::eval_increment;
+    using boost::multiprecision::default_ops::eval_ldexp;
+    constexpr auto digits = static_cast<int>(n_bits);
+    constexpr auto series_limit = digits < 100 ? 100 : digits;
+    auto x_pow_n_div_n_fact = x;
+    float_backend pochham_b[2], bp[2], tol[2], term;
+    bool done[2] = {false, res[1] == nullptr};
+    for (auto i = 0; i < 2 && res[i]; ++i) {
+        pochham_b[i] = *b[i];
+        bp[i] = *b[i];
+        eval_divide(*res[i], x_pow_n_div_n_fact, pochham_b[i]);
+        eval_add(*res[i], limb_type(1));
+        tol[i] = limb_type(1);
+        eval_ldexp(tol[i], tol[i], 1 - digits);
+        eval_multiply(tol[i], *res[i]);
+        if (eval_get_sign(tol[i]) < 0)
+            tol[i].negate();
+    }
+    auto n = signed_limb_type(2);
+    for (; n < series_limit && !(done[0] && done[1]); ++n) {
+        eval_multiply(x_pow_n_div_n_fact, x);
+        eval_divide(x_pow_n_div_n_fact, n);
+        for (auto i = 0; i < 2; ++i) {
+            if (done[i])
+                continue;
+            eval_increment(bp[i]);
+            eval_multiply(pochham_b[i], bp[i]);
+            eval_divide(term, x_pow_n_div_n_fact, pochham_b[i]);
+            eval_add(*res[i], term);
+            if (eval_get_sign(term) < 0)
+                term.negate();
+            done[i] = term.compare(tol[i]) <= 0;
+        }
+    }
+    if (!(done[0] && done[1]))
+        BOOST_THROW_EXCEPTION(std::runtime_error("H0F1 Failed to Converge"));
+}
+
+static auto hyp0f1(float_backend& res, double b, const float_backend& x) -> void {
+    auto b_ = float_backend(b);
+    float_backend* r[2] = {&res, nullptr};
+    const float_backend* b2[2] = {&b_, nullptr};
+    hyp0f1(r, b2, x);
+}
+
+static auto series_arg(float_backend& t, const float_backend& v) -> void { // t = -v^2 / 4
+    eval_multiply(t, v, v);
+    eval_divide(t, signed_limb_type(-4));
+}
+
+static auto sin_reduced(float_backend& res, float_backend xx, const float_backend& t) -> void {
+// boost's sin of xx and t = pi/2 - xx, past its reduction and before its sign
+    using boost::multiprecision::default_ops::eval_get_sign;
+    auto u = float_backend();
+    if (!eval_get_sign(xx))
+        res = limb_type(0);
+    else if (!eval_get_sign(t))
+        res = limb_type(1);
+    else if (xx.compare(tenth()) < 0) {
+        series_arg(u, xx);
+        hyp0f1(res, 1.5, u);
+        eval_multiply(res, xx);
+    } else if (t.compare(tenth()) < 0) {
+        series_arg(u, t);
+        hyp0f1(res, 0.5, u);
+    } else { // the series of xx / 3^9, then the triple angle formula 9 times
+        eval_divide(xx, signed_limb_type(19683));
+        series_arg(u, xx);
+        hyp0f1(res, 1.5, u);
+        eval_multiply(res, xx);
+        auto res3 = float_backend();
+        for (auto k = 0; k < 9; ++k) {
+            eval_multiply(res3, res, limb_type(3));
+            eval_multiply(u, res, res);
+            eval_multiply(u, res);
+            eval_multiply(u, limb_type(4));
+            eval_subtract(res, res3, u);
+        }
+    }
+}
+
+static auto cos_reduced(float_backend& res, const trig_reduction& r) -> void {
+// boost's cos, past its reduction and before its sign: the series about 0
+// near 0, else its own sin of pi/2 - xx
+    using boost::multiprecision::default_ops::eval_get_sign;
+    if (!eval_get_sign(r.xx))
+        res = signed_limb_type(1);
+    else if (r.cos_pi_half)
+        res = signed_limb_type(0);
+    else if (r.xx.compare(tenth()) < 0) {
+        auto u = float_backend();
+        series_arg(u, r.xx);
+        hyp0f1(res, 0.5, u);
+    } else if (!eval_get_sign(r.t)) // as boost's sin of 0
+        res = r.t;
+    else {
+        using boost::multiprecision::default_ops::get_constant_pi;
+        using boost::multiprecision::default_ops::eval_ldexp;
+        auto t = float_backend();
+        eval_ldexp(t, get_constant_pi<float_backend>(), -1);
+        eval_subtract(t, r.t);
+        sin_reduced(res, r.t, t);
+    }
+}
+
+static auto sin_cos(const float_backend& x, float_backend* s, float_backend* c) -> void {
+// sin and/or cos (s or c null if not wanted) of x (normal), bit for bit as
+// boost's; s or c may be x. recent reductions are kept by each thread, keyed
+// on the bits of x
+    thread_local std::array<trig_reduction, 4> recent = {};
+    thread_local auto next = 0u;
+    auto found = std::find_if(recent.begin(), recent.end(), [&](const trig_reduction& r) {
+        return r.x.exponent() == x.exponent() && r.x.sign() == x.sign() && r.x.bits().compare(x.bits()) == 0;
+    });
+    auto& r = found != recent.end() ? *found : recent[next++ % recent.size()];
+    if (found == recent.end())
+        reduce(r, x);
+
+    auto want_sin = s && !r.has_sin, want_cos = c && !r.has_cos;
+    if (want_sin && r.sin_beyond)
+        r.sin = limb_type(0);
+    if (want_cos && r.cos_beyond)
+        r.cos = limb_type(1);
+    want_sin &= !r.sin_beyond;
+    want_cos &= !r.cos_beyond;
+    using boost::multiprecision::default_ops::eval_get_sign;
+    if (want_sin && want_cos && eval_get_sign(r.xx) && r.xx.compare(tenth()) < 0) {
+        // both are series about 0 of the same argument
+        auto u = float_backend(), b_sin = float_backend(1.5), b_cos = float_backend(0.5);
+        series_arg(u, r.xx);
+        float_backend* res[2] = {&r.sin, &r.cos};
+        const float_backend* b[2] = {&b_sin, &b_cos};
+        hyp0f1(res, b, u);
+        eval_multiply(r.sin, r.xx);
+    } else {
+        if (want_sin)
+            sin_reduced(r.sin, r.xx, r.t);
+        if (want_cos)
+            cos_reduced(r.cos, r);
+    }
+    if (want_sin && r.sin_negate)
+        r.sin.negate();
+    if (want_cos && r.cos_negate)
+        r.cos.negate();
+    r.has_sin |= s != nullptr;
+    r.has_cos |= c != nullptr;
+    if (s)
+        *s = r.sin;
+    if (c)
+        *c = r.cos;
+}
+
+static auto complex_exp(complex_backend& res, const complex_backend& z) -> bool {
+// as boost's: e^a * (cos(b) + sin(b)i), from 1 reduction of b
+    if (!is_normal(z.imag_data()))
+        return false;
+    using boost::multiprecision::default_ops::eval_exp;
+    using boost::multiprecision::default_ops::eval_is_zero;
+    auto a = z.real_data(), e = float_backend();
+    sin_cos(z.imag_data(), &res.imag_data(), &res.real_data());
+    eval_exp(e, a);
+    if (eval_is_zero(res.real_data()))
+        eval_multiply(res.imag_data(), e);
+    else if (eval_is_zero(res.imag_data()))
+        eval_multiply(res.real_data(), e);
+    else {
+        eval_multiply(res.real_data(), e);
+        eval_multiply(res.imag_data(), e);
+    }
+    return true;
+}
+
+} // namespace helper
+
+} // namespace calc_val
+
+namespace boost::multiprecision::backends {
+
+void eval_add(cpp_bin_float<100>& res, const cpp_bin_float<100>& a, const cpp_bin_float<100>& b) {
+    if (!calc_val::helper::add(res, a, b, b.sign()))
+        eval_add<100, digit_base_10, void, int, 0, 0>(res, a, b);
+}
+
+void eval_subtract(cpp_bin_float<100>& res, const cpp_bin_float<100>& a, const cpp_bin_float<100>& b) {
+    if (!calc_val::helper::add(res, a, b, !b.sign()))
+        eval_subtract<100, digit_base_10, void, int, 0, 0>(res, a, b);
+}
+
+void eval_multiply(cpp_bin_float<100>& res, const cpp_bin_float<100>& a, const cpp_bin_float<100>& b) {
+    if (!calc_val::helper::mul(res, a, b))
+        eval_multiply<100, digit_base_10, void, int, 0, 0>(res, a, b);
+}
+
+void eval_divide(cpp_bin_float<100>& res, const cpp_bin_float<100>& a, const cpp_bin_float<100>& b) {
+    if (!calc_val::helper::div(res, a, b))
+        eval_divide<100, digit_base_10, void, int, 0, 0>(res, a, b);
+}
+
+void eval_divide(cpp_bin_float<100>& res, const cpp_bin_float<100>& a, limb_type n) {
+    if (!calc_val::helper::div(res, a, n, false))
+        eval_divide<100, digit_base_10, void, int, 0, 0, limb_type>(res, a, n);
+}
+
+void eval_divide(cpp_bin_float<100>& res, const cpp_bin_float<100>& a, signed_limb_type n) {
+    if (!calc_val::helper::div(res, a, boost::multiprecision::detail::unsigned_abs(n), n < 0))
+        eval_divide<100, digit_base_10, void, int, 0, 0, signed_limb_type>(res, a, n);
+}
+
+void eval_multiply_add(cpp_bin_float<100>& res, const cpp_bin_float<100>& a, const cpp_bin_float<100>& b) {
+    if (!calc_val::helper::mul_add(res, a, b, false))
+        default_ops::eval_multiply_add(res, a, b);
+}
+
+void eval_multiply_subtract(cpp_bin_float<100>& res, const cpp_bin_float<100>& a, const cpp_bin_float<100>& b) {
+    if (!calc_val::helper::mul_add(res, a, b, true))
+        default_ops::eval_multiply_subtract(res, a, b);
+}
+
+void eval_sin(cpp_bin_float<100>& res, const cpp_bin_float<100>& x) {
+    if (calc_val::helper::is_normal(x))
+        calc_val::helper::sin_cos(x, &res, nullptr);
+    else
+        default_ops::eval_sin(res, x);
+}
+
+void eval_cos(cpp_bin_float<100>& res, const cpp_bin_float<100>& x) {
+    if (calc_val::helper::is_normal(x))
+        calc_val::helper::sin_cos(x, nullptr, &res);
+    else
+        default_ops::eval_cos(res, x);
+}
+
+void eval_tan(cpp_bin_float<100>& res, const cpp_bin_float<100>& x) {
+    if (!calc_val::helper::is_normal(x)) {
+        default_ops::eval_tan(res, x);
+        return;
+    }
+    auto c = cpp_bin_float<100>();
+    calc_val::helper::sin_cos(x, &res, &c);
+    eval_divide(res, res, c);
+}
+
+void eval_multiply(complex_adaptor<cpp_bin_float<100>>& res, const complex_adaptor<cpp_bin_float<100>>& z) {
+    if (!calc_val::helper::complex_mul(res, z))
+        eval_multiply<cpp_bin_float<100>>(res, z);
+}
+
+void eval_divide(complex_adaptor<cpp_bin_float<100>>& res, const complex_adaptor<cpp_bin_float<100>>& z) {
+    if (!calc_val::helper::complex_div(res, z))
+        eval_divide<cpp_bin_float<100>>(res, z);
+}
+
+void eval_exp(complex_adaptor<cpp_bin_float<100>>& res, const complex_adaptor<cpp_bin_float<100>>& z) {
+    if (!calc_val::helper::complex_exp(res, z))
+        eval_exp<cpp_bin_float<100>>(res, z);
+}
+
+} // namespace boost::multiprecision::backends
+
+#endif // CALC_FLOAT_KERNELS
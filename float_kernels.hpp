@@ -0,0 +1,65 @@
+#ifndef FLOAT_KERNELS_HPP
+#define FLOAT_KERNELS_HPP
+
+// arithmetic kernels for the backend of float_type (cpp_bin_float<100>), whose
+// significand is 334 bits, in 6 64-bit limbs. they are plain overloads of
+// boost's eval_ functions in the backend's namespace, so adl prefers them to
+// boost's templates everywhere the backend is used: in the operators of
+// float_type and complex_type and in boost's elementary functions.
+// results are bit for bit those of boost 1.74: products, sums and quotients
+// are rounded once, to nearest even, as boost rounds them, and 0s get boost's
+// signs; what
+// boost treats specially (inf, nan, its own unnormalized intermediates,
+// results that overflow or underflow and differences of numbers more than 334
+// bits apart) is handed on to boost's templates.
+// the multiply-add kernels round twice, as boost's eval_multiply_add does, but
+// don't make a float of the product.
+// complex_type (complex_adaptor of the backend) has kernels for multiplication
+// and division that are also bit for bit boost's: multiplication skips the
+// products of 0 parts and one of the 2 equal products of a square, and
+// division by an imaginary number skips the 0 quotient in boost's algorithm.
+// sin, cos, tan and complex exp (so also complex sin, cos, tan and pow) share
+// one kernel that follows boost's sin and cos step for step, but reduces the
+// argument once for both and sums both series about 0 together; each thread
+// keeps its last few reductions and their results, keyed on the argument's
+// bits, so sin and cos of the same argument cost one reduction.
+// building with -DCALC_FLOAT_KERNELS=0 leaves all arithmetic to boost
+
+#include <boost/multiprecision/cpp_bin_float.hpp>
+#include <boost/multiprecision/complex_adaptor.hpp>
+
+#ifndef CALC_FLOAT_KERNELS
+#define CALC_FLOAT_KERNELS 1
+#endif
+
+#if CALC_FLOAT_KERNELS
+
+namespace boost::multiprecision::backends {
+
+void eval_add(cpp_bin_float<100>& res, const cpp_bin_float<100>& a, const cpp_bin_float<100>& b);
+void eval_subtract(cpp_bin_float<100>& res, const cpp_bin_float<100>& a, const cpp_bin_float<100>& b);
+void eval_multiply(cpp_bin_float<100>& res, const cpp_bin_float<100>& a, const cpp_bin_float<100>& b);
+void eval_divide(cpp_bin_float<100>& res, const cpp_bin_float<100>& a, const cpp_bin_float<100>& b);
+void eval_divide(cpp_bin_float<100>& res, const cpp_bin_float<100>& a, limb_type n);
+void eval_divide(cpp_bin_float<100>& res, const cpp_bin_float<100>& a, signed_limb_type n);
+// res may be a or b
+
+void eval_multiply_add(cpp_bin_float<100>& res, const cpp_bin_float<100>& a, const cpp_bin_float<100>& b);
+void eval_multiply_subtract(cpp_bin_float<100>& res, const cpp_bin_float<100>& a, const cpp_bin_float<100>& b);
+// res += a * b and res -= a * b
+
+void eval_sin(cpp_bin_float<100>& res, const cpp_bin_float<100>& x);
+void eval_cos(cpp_bin_float<100>& res, const cpp_bin_float<100>& x);
+void eval_tan(cpp_bin_float<100>& res, const cpp_bin_float<100>& x);
+// res may be x
+
+void eval_multiply(complex_adaptor<cpp_bin_float<100>>& res, const complex_adaptor<cpp_bin_float<100>>& z);
+void eval_divide(complex_adaptor<cpp_bin_float<100>>& res, const complex_adaptor<cpp_bin_float<100>>& z);
+void eval_exp(complex_adaptor<cpp_bin_float<100>>& res, const complex_adaptor<cpp_bin_float<100>>& z);
+// res may be z
+
+} // namespace boost::multiprecision::backends
+
+#endif // CALC_FLOAT_KERNELS
+
+#endif // FLOAT_KERNELS_HPP
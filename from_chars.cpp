@@ -11,40 +11,27 @@ static inline auto make_from_chars_result(decltype(std::from_chars_result::ptr)
     return r;
 }
 
-auto from_chars(const char* begin, const char* end, float_type& out_num, unsigned radix) -> std::from_chars_result {
-// specialized variation of std::from_chars for converting a floating point
-// number. some differences from std::from_chars:
-// - specifically for converting to calc_val::float_type
-// - does not recognize leading minus sign
-// - does not have std::chars_format parameter, has radix parameter instead
-// - if radix != 10 then exponent is specified with 'p'/'P' instead of ''e'/'E',
-//   and exponent is a power of 2 expressed in decimal
-// - 0x and 0X prefixes are not recognized in any case 
-    enum class scanning {whole, fraction, exponent} scan_state = scanning::whole;
-    float_type num = 0;
-    float_type frac_place = 1;
-    float_type exponent = 0; // float_type so overflow results in inf;
-                             // float_type is presumably large enough to
-                             // handle full range of exponent
+enum class scanning {whole, fraction, exponent};
+
+template <typename DigitFn>
+static auto scan_float_chars(const char* begin, const char* end, unsigned radix, DigitFn on_digit,
+    bool& negative_exponent) -> std::from_chars_result
+// scans a floating point number as described for from_chars, calling
+// on_digit(scan_state, digit) for each digit
+{
+    auto scan_state = scanning::whole;
     auto digits = false;
     auto exponent_digits = false;
-    bool negative_exponent = false;
+    negative_exponent = false;
     auto scan_radix = radix;
     auto pos = begin;
 
     for (; pos < end; ++pos) {
         auto digit = digit_ord(*pos, scan_radix);
         if (digit != -1) {
-            if (scan_state == scanning::whole)
-                num = num * radix + digit;
-            else if (scan_state == scanning::fraction) {
-                frac_place /= radix;
-                num += digit * frac_place;
-            } else {
-                assert(scan_state == scanning::exponent);
-                exponent = exponent * 10 + digit;
+            on_digit(scan_state, digit);
+            if (scan_state == scanning::exponent)
                 exponent_digits = true;
-            }
             digits = true;
         } else {
             if (*pos == '.' && scan_state == scanning::whole)
@@ -71,6 +58,38 @@ auto from_chars(const char* begin, const char* end, float_type& out_num, unsigne
 
     if (!digits || (scan_state == scanning::exponent && !exponent_digits))
         return make_from_chars_result(pos, std::errc::invalid_argument);
+    return make_from_chars_result(pos, std::errc());
+}
+
+auto from_chars(const char* begin, const char* end, float_type& out_num, unsigned radix) -> std::from_chars_result {
+// specialized variation of std::from_chars for converting a floating point
+// number. some differences from std::from_chars:
+// - specifically for converting to calc_val::float_type
+// - does not recognize leading minus sign
+// - does not have std::chars_format parameter, has radix parameter instead
+// - if radix != 10 then exponent is specified with 'p'/'P' instead of ''e'/'E',
+//   and exponent is a power of 2 expressed in decimal
+// - 0x and 0X prefixes are not recognized in any case 
+    float_type num = 0;
+    float_type frac_place = 1;
+    float_type exponent = 0; // float_type so overflow results in inf;
+                             // float_type is presumably large enough to
+                             // handle full range of exponent
+    bool negative_exponent;
+    auto result = scan_float_chars(begin, end, radix, [&](scanning scan_state, int digit) {
+        if (scan_state == scanning::whole)
+            num = num * radix + digit;
+        else if (scan_state == scanning::fraction) {
+            frac_place /= radix;
+            num += digit * frac_place;
+        } else {
+            assert(scan_state == scanning::exponent);
+            exponent = exponent * 10 + digit;
+        }
+    }, negative_exponent);
+    if (result.ec != std::errc())
+        return result;
+
     if (negative_exponent)
         exponent = -exponent;
     if (exponent != 0) {
@@ -78,7 +97,12 @@ auto from_chars(const char* begin, const char* end, float_type& out_num, unsigne
         num *= pow(base, exponent);
     }
     out_num = num;
-    return make_from_chars_result(pos, std::errc());
+    return result;
+}
+
+auto validate_float_chars(const char* begin, const char* end, unsigned radix) -> std::from_chars_result {
+    bool negative_exponent;
+    return scan_float_chars(begin, end, radix, [](scanning, int) {}, negative_exponent);
 }
 
 } // namespace calc_val
@@ -8,6 +8,9 @@ namespace calc_val {
 
 auto from_chars(const char* begin, const char* end, float_type& num, unsigned radix) -> std::from_chars_result;
 
+auto validate_float_chars(const char* begin, const char* end, unsigned radix) -> std::from_chars_result;
+// checks the syntax of a number as from_chars would, without converting it
+
 }
 
 #endif // FROM_CHARS_HPP
\ No newline at end of file
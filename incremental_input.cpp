@@ -0,0 +1,119 @@
+#include "calc_parser.hpp"
+#include <algorithm>
+
+// incremental evaluation (see calc_parser::incremental_input)
+
+auto calc_parser::incremental_input::replace(std::size_t offset, std::size_t length, std::string_view text) -> void {
+    offset = std::min(offset, source_.size());
+    length = std::min(length, source_.size() - offset);
+    source_.replace(offset, length, text);
+    if (!tokens)
+        return;
+    if (source_.size() > calc_token_buffer::max_input_size) {
+        tokens.reset();
+        values.clear();
+        return;
+    }
+
+    auto replaced = tokens->replace(source_, offset, length, text.size(), options_.default_number_radix);
+
+    // the values of the groups and calls that contain replaced tokens are
+    // discarded; those after the replaced tokens are moved with them
+    auto shift = static_cast<std::ptrdiff_t>(replaced.new_end) - static_cast<std::ptrdiff_t>(replaced.old_end);
+    auto kept = decltype(values)();
+    for (auto& [begin, v] : values) {
+        if (v.end <= replaced.first)
+            kept.emplace_hint(kept.end(), begin, std::move(v));
+        else if (begin >= replaced.old_end) {
+            v.end += shift;
+            kept.emplace_hint(kept.end(), begin + shift, std::move(v));
+        }
+    }
+    values = std::move(kept);
+}
+
+auto calc_parser::incremental_input::assign(std::string_view input) -> void {
+    auto source = std::string_view(source_);
+    auto prefix = static_cast<std::size_t>(
+        std::mismatch(source.begin(), source.end(), input.begin(), input.end()).first - source.begin());
+    auto max_suffix = std::min(source.size(), input.size()) - prefix;
+    auto suffix = static_cast<std::size_t>(
+        std::mismatch(source.rbegin(), source.rbegin() + max_suffix, input.rbegin()).first - source.rbegin());
+    if (prefix == source.size() && prefix == input.size())
+        return; // unchanged
+    replace(prefix, source.size() - prefix - suffix, input.substr(prefix, input.size() - prefix - suffix));
+}
+
+auto calc_parser::incremental_input::prepare(const parser_options& options) -> void {
+    if (tokens && options.default_number_radix != options_.default_number_radix)
+        tokens.reset();
+    if (options != options_)
+        values.clear();
+    options_ = options;
+    if (!tokens && source_.size() <= calc_token_buffer::max_input_size)
+        tokens.emplace(source_, options.default_number_radix);
+}
+
+auto calc_parser::evaluate(
+    incremental_input& input,
+    help_callback help,
+    output_options& out_options,
+    variables_changed_callback variables_changed_
+) -> calc_val::variant_type
+{
+    return value_or_throw(try_evaluate(input, help, out_options, variables_changed_));
+}
+
+auto calc_parser::try_evaluate(
+    incremental_input& input,
+    help_callback help,
+    output_options& out_options,
+    variables_changed_callback variables_changed_
+) -> evaluation_result
+{
+    assert(help);
+    variables_changed = variables_changed_;
+    auto cancellation_scope = calc_cancellation::scope(cancellation_);
+
+    input.prepare(options());
+    input.reused_values_ = 0;
+    auto result = evaluation_result();
+    if (input.tokens && (*input.tokens)[0].id != lexer_token::option) {
+        auto lexer = lookahead_calc_lexer(*input.tokens);
+        incremental = &input;
+        try {
+            result = input_expr<calc_val::variant_type>(lexer, help, out_options);
+        } catch (...) {
+            incremental = nullptr;
+            throw;
+        }
+        incremental = nullptr;
+    } else { // options may change the radix with which the tokens are scanned
+        auto lexer = lookahead_calc_lexer(input.source_, default_number_radix);
+        result = input_expr<calc_val::variant_type>(lexer, help, out_options);
+    }
+    deliver_variables_delta();
+    return result;
+}
+
+auto calc_parser::reuse_value(lookahead_calc_lexer& lexer, std::size_t begin) -> const calc_val::variant_type* {
+// if a value was kept for the group or call whose first token is at begin,
+// consumes its tokens and returns the value
+    auto itr = incremental->values.find(begin);
+    if (itr == incremental->values.end())
+        return nullptr;
+    lexer.skip_to(itr->second.end);
+    ++incremental->reused_values_;
+    return &itr->second.value;
+}
+
+auto calc_parser::keep_value(lookahead_calc_lexer& lexer, std::size_t begin, std::size_t impure_count_before,
+    const calc_val::variant_type& val) -> void
+{
+// keeps the value of the group or call whose first token is at begin and
+// whose last token was just consumed, unless it read a variable or "last" or
+// made an assignment
+    if (impure_count != impure_count_before)
+        return;
+    incremental->values.insert_or_assign(begin, incremental_input::kept_value{lexer.buffer_index(), val});
+}
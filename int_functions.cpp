@@ -0,0 +1,79 @@
+#include "int_functions.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+namespace calc_val {
+
+static_assert(sizeof(max_uint_type) == 2 * sizeof(std::uint64_t));
+
+static inline auto high(max_uint_type x) -> std::uint64_t
+{return static_cast<std::uint64_t>(x >> 64);}
+
+static inline auto low(max_uint_type x) -> std::uint64_t
+{return static_cast<std::uint64_t>(x);}
+
+auto isqrt(max_uint_type x, unsigned) -> max_uint_type {
+// the double precision root is within about 2^11 of the result for the
+// largest x; one newton step brings it within 1
+    if (x < 2)
+        return x;
+    auto r = static_cast<max_uint_type>(std::sqrt(static_cast<double>(x)));
+    r = std::min(r, static_cast<max_uint_type>(UINT64_MAX)); // so r * r can't overflow
+    r = (r + x / r) / 2;
+    r = std::min(r, static_cast<max_uint_type>(UINT64_MAX));
+    while (r * r > x)
+        --r;
+    while (r + 1 <= x / (r + 1))
+        ++r;
+    return r;
+}
+
+auto popcount(max_uint_type x, unsigned) -> max_uint_type {
+    return __builtin_popcountll(high(x)) + __builtin_popcountll(low(x));
+}
+
+auto clz(max_uint_type x, unsigned word_size) -> max_uint_type {
+    if (x == 0)
+        return word_size;
+    auto n = high(x) ? __builtin_clzll(high(x)) : 64 + __builtin_clzll(low(x));
+    return n - (128 - word_size);
+}
+
+auto ctz(max_uint_type x, unsigned word_size) -> max_uint_type {
+    if (x == 0)
+        return word_size;
+    return low(x) ? __builtin_ctzll(low(x)) : 64 + __builtin_ctzll(high(x));
+}
+
+static auto bitrev_bytes(std::uint64_t x) -> std::uint64_t {
+// reverses the bits of each byte
+    x = ((x >> 1) & 0x5555555555555555) | ((x & 0x5555555555555555) << 1);
+    x = ((x >> 2) & 0x3333333333333333) | ((x & 0x3333333333333333) << 2);
+    return ((x >> 4) & 0x0f0f0f0f0f0f0f0f) | ((x & 0x0f0f0f0f0f0f0f0f) << 4);
+}
+
+auto bitrev(max_uint_type x, unsigned word_size) -> max_uint_type {
+// byte swap, then reverse the bits of each byte
+    auto r = max_uint_type(bitrev_bytes(__builtin_bswap64(low(x)))) << 64 | bitrev_bytes(__builtin_bswap64(high(x)));
+    return r >> (128 - word_size);
+}
+
+auto bswap(max_uint_type x, unsigned word_size) -> max_uint_type {
+    auto r = max_uint_type(__builtin_bswap64(low(x))) << 64 | __builtin_bswap64(high(x));
+    return r >> (128 - word_size);
+}
+
+auto rotl(max_uint_type x, max_uint_type n, unsigned word_size) -> max_uint_type {
+    auto shift = static_cast<unsigned>(n % word_size);
+    if (shift == 0)
+        return x;
+    auto mask = ~max_uint_type(0) >> (128 - word_size);
+    return ((x << shift) | (x >> (word_size - shift))) & mask;
+}
+
+auto rotr(max_uint_type x, max_uint_type n, unsigned word_size) -> max_uint_type {
+    return rotl(x, word_size - static_cast<unsigned>(n % word_size), word_size);
+}
+
+} // namespace calc_val
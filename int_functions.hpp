@@ -0,0 +1,40 @@
+#ifndef INT_FUNCTIONS_HPP
+#define INT_FUNCTIONS_HPP
+
+// integer functions of calc_parser's unary_fn_table. each takes the bits of
+// an integer word of word_size bits (8 to 128; the bits above are 0) and
+// returns the bits of the result word, so it serves int and uint arguments
+// alike; the bit functions use the processor's bit instructions
+
+#include "basics.hpp"
+
+namespace calc_val {
+
+auto isqrt(max_uint_type x, unsigned word_size) -> max_uint_type;
+// integer square root: floor(sqrt(x)). x is taken as unsigned; a negative
+// int argument is rejected by the caller's domain check
+
+auto popcount(max_uint_type x, unsigned word_size) -> max_uint_type;
+// number of 1 bits
+
+auto clz(max_uint_type x, unsigned word_size) -> max_uint_type;
+auto ctz(max_uint_type x, unsigned word_size) -> max_uint_type;
+// number of leading (most significant) and trailing 0 bits; word_size if x is 0
+
+auto bitrev(max_uint_type x, unsigned word_size) -> max_uint_type;
+// bits in reverse order
+
+auto bswap(max_uint_type x, unsigned word_size) -> max_uint_type;
+// bytes in reverse order
+
+auto rotl(max_uint_type x, max_uint_type n, unsigned word_size) -> max_uint_type;
+auto rotr(max_uint_type x, max_uint_type n, unsigned word_size) -> max_uint_type;
+// x rotated left or right by n bits modulo word_size. n is the bits of a word
+// too: a negative int n rotates the other way
+
+inline auto int_identity(max_uint_type x, unsigned) -> max_uint_type
+{return x;} // for functions such as conj that leave a real argument unchanged
+
+} // namespace calc_val
+
+#endif // INT_FUNCTIONS_HPP
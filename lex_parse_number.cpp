@@ -3,8 +3,9 @@
 #include "is_digit.h"
 #include "calc_args.hpp"
 #include "from_chars.hpp"
+#include "char_class.hpp"
 
-// implementation of two very closely related functions regarding scanning and
+// implementation of closely related functions regarding scanning and
 // converting number tokens
 
 void calc_lexer::scan_as_number() {
@@ -25,14 +26,14 @@ void calc_lexer::scan_as_number() {
         auto inc_in_itr2 = 0;
 
         if (in_itr2.length() > 2 && !is_digit_any_decimal(in_itr2[2], radix)) {
-            auto prefix_code_2 = std::tolower(in_itr[2]);
+            auto prefix_code_2 = calc_val::to_lower(in_itr[2]);
             prefix_code_2_is_ok = prefix_code_2 == signed_prefix_code || prefix_code_2 == unsigned_prefix_code || prefix_code_2 == complex_prefix_code;
         }
         if (prefix_code_2_is_ok) {
-            prefix_code_1 = std::tolower(in_itr2[1]);
+            prefix_code_1 = calc_val::to_lower(in_itr2[1]);
             inc_in_itr2 = 3;
         } else if (in_itr2.length() > 1 && !is_digit_any_decimal(in_itr2[1], radix)) {
-            prefix_code_1 = std::tolower(in_itr2[1]);
+            prefix_code_1 = calc_val::to_lower(in_itr2[1]);
             prefix_code_2_is_ok = true; // implied code
             inc_in_itr2 = 2;
         }
@@ -65,7 +66,7 @@ void calc_lexer::scan_as_number() {
         }
 
         has_leading_digit = true;
-    } else if (in_itr2 && std::isdigit(*in_itr2)) {
+    } else if (in_itr2 && calc_val::is_digit10(*in_itr2)) {
         ++in_itr2;
         has_leading_digit = true;
         has_alnum = true;
@@ -78,16 +79,19 @@ void calc_lexer::scan_as_number() {
         if (*in_itr2 == '.' && !has_decimal_point) {
             ++in_itr2;
             has_decimal_point = true;
+        } else if (calc_val::is_digit10(*in_itr2)) { // decimal digit run; valid for any radix here
+            in_itr2 += calc_val::skip_digits10(in_itr2.ptr(), in_itr2.end()) - in_itr2.ptr();
+            has_alnum = true;
         } else if (is_digit_any_decimal(*in_itr2, radix)) {
             ++in_itr2;
             has_alnum = true;
-        } else if (std::tolower(*in_itr2) == exponent_code && has_alnum) {
+        } else if (calc_val::to_lower(*in_itr2) == exponent_code && has_alnum) {
             auto in_itr3 = in_itr2 + 1;
             if (in_itr3 && (*in_itr3 == '+' || *in_itr3 == '-'))
                 ++in_itr3;
-            if (in_itr3 && std::isdigit(*in_itr3)) {
+            if (in_itr3 && calc_val::is_digit10(*in_itr3)) {
                 do ++in_itr3;
-                    while (in_itr3 && std::isdigit(*in_itr3));
+                    while (in_itr3 && calc_val::is_digit10(*in_itr3));
                 in_itr2 = in_itr3;
             }
             break;
@@ -101,14 +105,10 @@ void calc_lexer::scan_as_number() {
         ++in_itr;
 }
 
-auto calc_parser::assumed_number(lookahead_calc_lexer& lexer, bool is_negative) -> calc_val::variant_type {
-// gets the next token, which is assumed to have been coded as a number.
-// converts the character sequence to internal numeric representation (and thus
-// final-validates it)
-    auto token = lexer.get_token(); // assume next token is number (caller should assure this)
-    assert(token.id == lexer_token::number);
-
-    auto num_itr = const_string_itr(token.view);
+auto calc_parser::scan_number_literal(std::string_view token_view) const -> number_literal {
+// splits a number token into its prefix, which gives the type and radix, and
+// the rest
+    auto num_itr = const_string_itr(token_view);
     auto type_code = default_number_type_code;
     auto radix = default_number_radix;
 
@@ -202,20 +202,70 @@ auto calc_parser::assumed_number(lookahead_calc_lexer& lexer, bool is_negative)
         }
     }
 
+    return number_literal{num_itr, type_code, radix};
+}
+
+auto calc_parser::assumed_number(lookahead_calc_lexer& lexer, bool is_negative) -> calc_val::variant_type {
+// gets the next token, which is assumed to have been coded as a number.
+// converts the character sequence to internal numeric representation (and thus
+// final-validates it)
+    auto token = lexer.get_token(); // assume next token is number (caller should assure this)
+    assert(token.id == lexer_token::number);
+
+    auto literal = scan_number_literal(token.view);
+    if (literal.type_code != calc_val::complex_code)
+        return int_number(token, literal, is_negative);
+
     calc_val::float_type float_val = 0;
-    calc_val::max_uint_type uint_val = 0;
+    auto num_itr = literal.digits;
+    auto from_char_result = calc_val::from_chars(num_itr.begin(), num_itr.end(), float_val, literal.radix);
+    if (from_char_result.ec == std::errc::result_out_of_range)
+        return fail(calc_parse_error::out_of_range, token);
+    else if (from_char_result.ec != std::errc() || from_char_result.ptr != num_itr.end())
+        return fail(calc_parse_error::invalid_number, token);
 
-    std::from_chars_result from_char_result;
-    if (type_code == calc_val::complex_code)
-        from_char_result = calc_val::from_chars(num_itr.begin(), num_itr.end(), float_val, radix);
-    else {
-        assert(type_code == calc_val::uint_code || type_code == calc_val::int_code);
-        from_char_result = std::from_chars(num_itr.begin(), num_itr.end(), uint_val, radix);
+    if (is_negative)
+        float_val = -float_val;
+    return calc_val::complex_type(float_val, 0);
+}
+
+auto calc_parser::validate_number(lookahead_calc_lexer& lexer, bool is_negative) -> void {
+// as assumed_number but only checks a floating point number's syntax. (an
+// integer is converted, which is cheap, so that its range is checked)
+    auto token = lexer.get_token(); // assume next token is number (caller should assure this)
+    assert(token.id == lexer_token::number);
+
+    auto literal = scan_number_literal(token.view);
+    if (literal.type_code != calc_val::complex_code) {
+        int_number(token, literal, is_negative);
+        return;
     }
+
+    auto num_itr = literal.digits;
+    auto scan_result = calc_val::validate_float_chars(num_itr.begin(), num_itr.end(), literal.radix);
+    if (scan_result.ec != std::errc() || scan_result.ptr != num_itr.end())
+        fail(calc_parse_error::invalid_number, token);
+}
+
+auto calc_parser::int_number(const lexer_token& token, const number_literal& literal, bool is_negative)
+    -> calc_val::variant_type
+{
+// converts the digits of an integer number token
+    if (int_word_size > calc_val::int_bits_128)
+        return wide_int_number(token, literal, is_negative);
+
+    auto num_itr = literal.digits;
+    auto type_code = literal.type_code;
+    auto radix = literal.radix;
+
+    calc_val::max_uint_type uint_val = 0;
+
+    assert(type_code == calc_val::uint_code || type_code == calc_val::int_code);
+    auto from_char_result = std::from_chars(num_itr.begin(), num_itr.end(), uint_val, radix);
     if (from_char_result.ec == std::errc::result_out_of_range)
-        throw calc_parse_error(calc_parse_error::out_of_range, token);
+        return fail(calc_parse_error::out_of_range, token);
     else if (from_char_result.ec != std::errc() || from_char_result.ptr != num_itr.end())
-        throw calc_parse_error(calc_parse_error::invalid_number, token);
+        return fail(calc_parse_error::invalid_number, token);
 
     calc_val::variant_type val;
     bool out_of_range = false;
@@ -250,7 +300,8 @@ auto calc_parser::assumed_number(lookahead_calc_lexer& lexer, bool is_negative)
                 assert(int_word_size == calc_val::int_bits_128);
                 val = val_for((unsigned __int128){}, uint_val, is_negative, out_of_range);
         }
-    } else if (type_code == calc_val::int_code) {
+    } else {
+        assert(type_code == calc_val::int_code);
         auto val_for = [](auto tag, auto uint_val, bool is_negative, calc_val::radices radix, bool& out_of_range) -> calc_val::int_type {
             using int_t = std::decay_t<decltype(tag)>;
             using uint_t = std::make_unsigned_t<int_t>;
@@ -294,15 +345,41 @@ auto calc_parser::assumed_number(lookahead_calc_lexer& lexer, bool is_negative)
                 assert(int_word_size == calc_val::int_bits_128);
                 val = val_for(__int128{}, uint_val, is_negative, radix, out_of_range);
         }
-    } else {
-        assert(type_code == calc_val::complex_code);
-        if (is_negative)
-            float_val = -float_val;
-        val = calc_val::complex_type(float_val, 0);
     }
 
     if (out_of_range)
-        throw calc_parse_error(calc_parse_error::out_of_range, token);
+        return fail(calc_parse_error::out_of_range, token);
 
     return val;
 }
+
+auto calc_parser::wide_int_number(const lexer_token& token, const number_literal& literal, bool is_negative)
+    -> calc_val::variant_type
+{
+// as int_number for the word sizes above 128 bits, with the same range checks
+    auto num_itr = literal.digits;
+    auto type_code = literal.type_code;
+    auto radix = literal.radix;
+
+    calc_val::wide_uint_type uint_val = 0;
+
+    assert(type_code == calc_val::uint_code || type_code == calc_val::int_code);
+    auto from_char_result = calc_val::from_chars(num_itr.begin(), num_itr.end(), uint_val, radix);
+    if (from_char_result.ec == std::errc::result_out_of_range)
+        return fail(calc_parse_error::out_of_range, token);
+    else if (from_char_result.ec != std::errc() || from_char_result.ptr != num_itr.end())
+        return fail(calc_parse_error::invalid_number, token);
+
+    // for base 10, an int must be in the range of the int; for other bases,
+    // any word is allowed so that e.g. 0xfff...f converts to -1
+    auto word_max = ~calc_val::wide_uint_type(0) >> (calc_val::wide_uint_type::bits - int_word_size);
+    auto max = type_code == calc_val::int_code && radix == calc_val::base10 ? (word_max >> 1) + is_negative : word_max;
+    if (uint_val > max)
+        return fail(calc_parse_error::out_of_range, token);
+
+    if (is_negative)
+        uint_val = -uint_val;
+    if (type_code == calc_val::uint_code)
+        return trim_if_int(uint_val);
+    return trim_if_int(calc_val::wide_int_type(uint_val));
+}
@@ -1,8 +1,17 @@
 #include "lookahead_calc_lexer.hpp"
 
+void lookahead_calc_lexer::default_number_radix(calc_val::radices default_number_radix) {
+    if (token_buffer)
+        token_buffer->retokenize_from(token_index + peeked, default_number_radix);
+    else if (stream_lexer)
+        stream_lexer->default_number_radix(default_number_radix);
+    else
+        lexer.default_number_radix(default_number_radix);
+}
+
 auto lookahead_calc_lexer::peek_token() -> const lexer_token& {
     if (!peeked) {
-        peeked_token_ = lexer.get_token();
+        peeked_token_ = token_buffer ? token_buffer->lexer_token_at(token_index) : next_token();
         peeked = 1;
     }
     return peeked_token_;
@@ -11,15 +20,22 @@ auto lookahead_calc_lexer::peek_token() -> const lexer_token& {
 auto lookahead_calc_lexer::peek_token2() -> const lexer_token& {
     if (peeked != 2) {
         peek_token();
-        peeked_token2_ = lexer.get_token();
+        peeked_token2_ = token_buffer ? token_buffer->lexer_token_at(token_index + 1) : next_token();
         peeked = 2;
     }
     return peeked_token2_;
 }
 
 auto lookahead_calc_lexer::get_token() -> const lexer_token& {
+    if (token_buffer) {
+        last_token_ = token_buffer->lexer_token_at(token_index++);
+        if (peeked && --peeked)
+            peeked_token_ = token_buffer->lexer_token_at(token_index);
+        return last_token_;
+    }
+
     if (!peeked)
-        last_token_ = lexer.get_token();
+        last_token_ = next_token();
     else {
         last_token_ = peeked_token_;
         if (--peeked) {
@@ -29,3 +45,10 @@ auto lookahead_calc_lexer::get_token() -> const lexer_token& {
     }
     return last_token_;
 }
+
+auto lookahead_calc_lexer::skip_to(std::size_t index) -> void {
+    assert(token_buffer && index > token_index);
+    token_index = index;
+    last_token_ = token_buffer->lexer_token_at(index - 1);
+    peeked = 0;
+}
@@ -2,19 +2,32 @@
 #define LOOKAHEAD_CALC_LEXER_HPP
 
 #include "calc_lexer.hpp"
+#include "calc_token_buffer.hpp"
+#include "calc_stream_lexer.hpp"
 
 class lookahead_calc_lexer {
 // simulates two-token lookhead lexer using calc_lexer. (implemented
 // separately from calc_lexer to keep calc_lexer clean and simple, and to
 // encapsulate lookahead logic)
+// alternatively steps through the tokens of a calc_token_buffer, in which case
+// the lookahead is just an index into the token buffer's array, or gets tokens
+// from a calc_stream_lexer
 public:
     using token_ids = typename lexer_token::token_ids;
 
     lookahead_calc_lexer(std::string_view input, calc_val::radices default_number_radix)
         : lexer{input, default_number_radix} {}
 
-    void default_number_radix(calc_val::radices default_number_radix)
-    {lexer.default_number_radix(default_number_radix);}
+    lookahead_calc_lexer(calc_token_buffer& token_buffer_)
+        : lexer{{}, calc_val::base10}, token_buffer{&token_buffer_} {}
+    // token_buffer_ must be valid for the lifetime of the class instance; it is
+    // modified if default_number_radix is called
+
+    lookahead_calc_lexer(calc_stream_lexer& stream_lexer_)
+        : lexer{{}, calc_val::base10}, stream_lexer{&stream_lexer_} {}
+    // stream_lexer_ must be valid for the lifetime of the class instance
+
+    void default_number_radix(calc_val::radices default_number_radix);
 
     auto get_token() -> const lexer_token&; // consume a token; throws parse_error if token has error
     auto last_token() const -> const lexer_token& {return last_token_;}
@@ -25,8 +38,18 @@ public:
     auto peek_token2() -> const lexer_token&; // peek at second token
     auto peeked_token2() const -> const lexer_token& {return peeked_token2_;}
 
+    auto buffer_index() const -> std::size_t {return token_index;}
+    // index in the token buffer of the next token to consume
+    auto skip_to(std::size_t index) -> void;
+    // consumes the tokens of the token buffer up to index
+
 private:
     calc_lexer lexer;
+    calc_token_buffer* token_buffer = nullptr;
+    std::size_t token_index = 0; // index in token_buffer of next token to consume
+    calc_stream_lexer* stream_lexer = nullptr;
+    auto next_token() -> lexer_token
+    {return stream_lexer ? stream_lexer->get_token() : lexer.get_token();}
     unsigned peeked = 0;
     lexer_token last_token_ = {};
     lexer_token peeked_token_ = {};
@@ -0,0 +1,79 @@
+#include "modular.hpp"
+#include "montgomery.hpp"
+#include "pow_int.hpp"
+#include <cstdint>
+#include <utility>
+
+namespace calc_val {
+
+namespace {
+
+using std::uint64_t;
+using helper::ctz;
+using helper::inverse_mod_word;
+using helper::montgomery;
+
+template <typename W>
+auto odd_mulmod(W x, W y, W n) -> W {
+    if (n == 1)
+        return 0;
+    auto mont = montgomery<W>(n);
+    return mont.mul(mont.to_form(x), y % n); // x * 2^bits * y * 2^-bits
+}
+
+template <typename W>
+auto odd_powmod(W x, max_uint_type e, W n) -> W {
+    if (n == 1)
+        return 0;
+    auto mont = montgomery<W>(n);
+    return mont.from_form(mont.pow(mont.to_form(x), e));
+}
+
+auto combine(max_uint_type r_odd, max_uint_type q, max_uint_type r_low, unsigned k) -> max_uint_type {
+// x < q * 2^k such that x = r_odd mod q and x = r_low mod 2^k (q is odd, so
+// invertible mod 2^k)
+    auto mask = (max_uint_type(1) << k) - 1;
+    auto t = ((r_low - r_odd) * inverse_mod_word(q)) & mask;
+    return r_odd + q * t;
+}
+
+} // namespace
+
+auto mulmod(max_uint_type x, max_uint_type y, max_uint_type m) -> max_uint_type {
+    if (m >> 64 == 0) // the product fits; one division is cheaper than a montgomery setup
+        return (x % m) * (y % m) % m;
+    auto k = ctz(m);
+    auto q = m >> k;
+    auto r_odd = q >> 64 == 0
+        ? odd_mulmod<uint64_t>(static_cast<uint64_t>(x % q), static_cast<uint64_t>(y % q), static_cast<uint64_t>(q))
+        : odd_mulmod<max_uint_type>(x, y, q);
+    return k ? combine(r_odd, q, x * y, k) : r_odd;
+}
+
+auto powmod(max_uint_type x, max_uint_type e, max_uint_type m) -> max_uint_type {
+    auto k = ctz(m);
+    auto q = m >> k;
+    auto r_odd = q >> 64 == 0
+        ? odd_powmod<uint64_t>(static_cast<uint64_t>(x % q), e, static_cast<uint64_t>(q))
+        : odd_powmod<max_uint_type>(x, e, q);
+    return k ? combine(r_odd, q, helper::pow_uint(x, e), k) : r_odd;
+}
+
+auto invmod(max_uint_type x, max_uint_type m) -> std::optional<max_uint_type> {
+// extended euclid. the coefficients of x alternate in sign and their
+// magnitudes are at most m, so they are kept as magnitudes and a sign
+    auto r0 = m, r1 = x % m;
+    auto s0 = max_uint_type(0), s1 = max_uint_type(1);
+    auto s1_negative = false;
+    while (r1) {
+        auto q = r0 / r1;
+        r0 = std::exchange(r1, r0 - q * r1);
+        s0 = std::exchange(s1, s0 + q * s1);
+        s1_negative = !s1_negative;
+    }
+    if (r0 != 1)
+        return std::nullopt;
+    return !s1_negative && s0 ? m - s0 : s0; // s0's sign is the opposite of s1's
+}
+
+} // namespace calc_val
@@ -0,0 +1,28 @@
+#ifndef MODULAR_HPP
+#define MODULAR_HPP
+
+// modular arithmetic of calc_parser's powmod, mulmod and invmod, on unsigned
+// words of up to 128 bits. the modulus m must not be 0.
+// an odd modulus is reduced by montgomery multiplication (montgomery.hpp), on
+// 64-bit words if it fits in one and on 128-bit words otherwise. an even
+// modulus 2^k*q is split into 2^k, which wrapping arithmetic takes care of,
+// and odd q; the results are then combined (chinese remainder theorem).
+// mulmod of a modulus of up to 64 bits just divides the 128-bit product
+
+#include "basics.hpp"
+#include <optional>
+
+namespace calc_val {
+
+auto mulmod(max_uint_type x, max_uint_type y, max_uint_type m) -> max_uint_type;
+// x * y mod m
+
+auto powmod(max_uint_type x, max_uint_type e, max_uint_type m) -> max_uint_type;
+// x^e mod m; x^0 is 1 mod m
+
+auto invmod(max_uint_type x, max_uint_type m) -> std::optional<max_uint_type>;
+// y < m such that x * y mod m is 1 mod m, if x and m are coprime
+
+} // namespace calc_val
+
+#endif // MODULAR_HPP
@@ -0,0 +1,126 @@
+#ifndef MONTGOMERY_HPP
+#define MONTGOMERY_HPP
+
+// montgomery multiplication mod an odd modulus, on 64-bit words with
+// 64x64->128 bit products and on 128-bit words with 128x128->256 bit
+// products; used by the modular and prime functions (modular.hpp, primes.hpp)
+
+#include "basics.hpp"
+#include <cstdint>
+
+namespace calc_val {
+
+namespace helper { // implementation helper; not meant for public use
+
+template <typename W>
+struct wide { // a double word
+    W high;
+    W low;
+};
+
+inline auto mul_wide(std::uint64_t x, std::uint64_t y) -> wide<std::uint64_t> {
+    auto p = static_cast<max_uint_type>(x) * y;
+    return {static_cast<std::uint64_t>(p >> 64), static_cast<std::uint64_t>(p)};
+}
+
+inline auto mul_wide(max_uint_type x, max_uint_type y) -> wide<max_uint_type> {
+// schoolbook, from four 64x64->128 bit products
+    auto x0 = static_cast<std::uint64_t>(x), x1 = static_cast<std::uint64_t>(x >> 64);
+    auto y0 = static_cast<std::uint64_t>(y), y1 = static_cast<std::uint64_t>(y >> 64);
+    auto p00 = static_cast<max_uint_type>(x0) * y0;
+    auto p01 = static_cast<max_uint_type>(x0) * y1;
+    auto p10 = static_cast<max_uint_type>(x1) * y0;
+    auto p11 = static_cast<max_uint_type>(x1) * y1;
+    auto mid = (p00 >> 64) + static_cast<std::uint64_t>(p01) + static_cast<std::uint64_t>(p10); // < 3 * 2^64
+    return {p11 + (p01 >> 64) + (p10 >> 64) + (mid >> 64), (mid << 64) | static_cast<std::uint64_t>(p00)};
+}
+
+template <typename W>
+auto inverse_mod_word(W n) -> W {
+// n^-1 mod 2^(bits of W) for odd n. n is its own inverse mod 8 and each
+// newton step doubles the number of correct low bits
+    auto x = n;
+    for (unsigned bits = 3; bits < 8 * sizeof(W); bits *= 2)
+        x *= 2 - n * x;
+    return x;
+}
+
+inline auto ctz(max_uint_type x) -> unsigned { // x != 0
+    auto low = static_cast<std::uint64_t>(x);
+    return low ? __builtin_ctzll(low) : 64 + __builtin_ctzll(static_cast<std::uint64_t>(x >> 64));
+}
+
+template <typename W>
+class montgomery {
+// arithmetic mod odd n > 1 on values in montgomery form: x * 2^bits mod n,
+// where bits are those of W. add, sub and half work on either form
+public:
+    explicit montgomery(W n_);
+    auto modulus() const -> W {return n;}
+    auto to_form(W x) const -> W {return reduce(mul_wide(x % n, r2));}
+    auto from_form(W x) const -> W {return reduce({0, x});}
+    auto one() const -> W {return r1;}
+    auto mul(W x, W y) const -> W {return reduce(mul_wide(x, y));}
+    auto add(W x, W y) const -> W;
+    auto sub(W x, W y) const -> W {return x >= y ? x - y : x - y + n;}
+    auto half(W x) const -> W {return x & 1 ? (x >> 1) + (n >> 1) + 1 : x >> 1;}
+    auto pow(W x, max_uint_type e) const -> W;
+
+private:
+    W n;
+    W n_neg_inv; // -n^-1 mod 2^bits
+    W r1; // 2^bits mod n
+    W r2; // 2^(2 * bits) mod n
+    auto reduce(wide<W> t) const -> W;
+};
+
+template <typename W>
+montgomery<W>::montgomery(W n_)
+    : n{n_}, n_neg_inv{W(0) - inverse_mod_word(n_)}, r1{(W(0) - n_) % n_}, r2{r1}
+{
+    for (unsigned i = 0; i < 8 * sizeof(W); ++i)
+        r2 = add(r2, r2);
+}
+
+template <typename W>
+inline auto montgomery<W>::add(W x, W y) const -> W {
+// for x, y < n
+    auto s = x + y;
+    if (s < x || s >= n)
+        s -= n;
+    return s;
+}
+
+template <typename W>
+auto montgomery<W>::pow(W x, max_uint_type e) const -> W {
+// of x in montgomery form
+    auto r = one();
+    for (; e; e >>= 1) {
+        if (e & 1)
+            r = mul(r, x);
+        x = mul(x, x);
+    }
+    return r;
+}
+
+template <typename W>
+inline auto montgomery<W>::reduce(wide<W> t) const -> W {
+// t * 2^-bits mod n, for t < n * 2^bits. t + m * n is a multiple of 2^bits
+// below 2 * n * 2^bits; its low word is 0, with a carry unless t.low is 0
+    auto m = t.low * n_neg_inv;
+    auto mn = mul_wide(m, n);
+    auto s = t.high + mn.high;
+    auto overflow = s < t.high;
+    auto carry = W(t.low != 0);
+    s += carry;
+    overflow |= s < carry;
+    if (overflow || s >= n)
+        s -= n;
+    return s;
+}
+
+} // namespace helper
+
+} // namespace calc_val
+
+#endif // MONTGOMERY_HPP
@@ -0,0 +1,335 @@
+#ifndef PERSISTENT_MAP_HPP
+#define PERSISTENT_MAP_HPP
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <memory_resource>
+#include <new>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <utility>
+
+struct persistent_map_usage {
+    std::size_t nodes = 0;
+    std::size_t bytes = 0;
+    std::size_t exclusive_bytes = 0;
+};
+// bytes: memory held by a map's nodes (including keys but not memory that
+// values themselves own). exclusive_bytes: the part of bytes not shared with
+// other maps, which would be released if the map was destroyed
+
+template <typename T>
+class persistent_map {
+// map from strings to T whose copies share structure: copying a map is O(1),
+// and changing a map copies at most the nodes on the path to the element
+// changed (it's an avl tree, so O(log n) nodes), leaving the other maps
+// unchanged. insert_or_assign copies only the nodes that are shared with
+// other maps and changes the others in place, so a map without copies is
+// updated about as cheaply as a std::map; erase copies the whole path even
+// then, so that the map is unchanged if an allocation fails.
+// nodes are allocated from the memory resource passed to the constructor,
+// which must outlive the map and its copies. reference counts are not atomic;
+// a map and its copies must not be used concurrently
+public:
+    using value_type = std::pair<const std::pmr::string, T>;
+
+    explicit persistent_map(std::pmr::memory_resource* resource_ = std::pmr::get_default_resource()) noexcept
+        : resource{resource_} {}
+
+    auto resource_used() const noexcept -> std::pmr::memory_resource* {return resource;}
+    auto size() const noexcept -> std::size_t {return size_;}
+    auto empty() const noexcept -> bool {return !size_;}
+
+    auto find(std::string_view key) const noexcept -> const T*;
+    // the value of key, if any; nullptr otherwise. the pointer is invalidated
+    // by a change of the map
+    auto contains(std::string_view key) const noexcept -> bool {return find(key) != nullptr;}
+
+    auto insert_or_assign(std::string_view key, const T& value) -> void;
+    auto erase(std::string_view key) -> bool;
+    // returns whether key was erased
+    auto clear() noexcept -> void {root = node_ref(); size_ = 0;}
+    // these throw std::bad_alloc if memory can't be allocated, in which case
+    // the map is unchanged
+
+    auto memory_usage() const noexcept -> persistent_map_usage;
+    // O(n)
+
+private:
+    struct node;
+
+    class node_ref {
+    // counted reference to a node
+    public:
+        node_ref() noexcept = default;
+        explicit node_ref(node* p_) noexcept : p{p_} {}
+        node_ref(const node_ref& other) noexcept : p{other.p} {if (p) ++p->refs;}
+        node_ref(node_ref&& other) noexcept : p{other.p} {other.p = nullptr;}
+        ~node_ref() {release();}
+        auto operator=(node_ref other) noexcept -> node_ref& {std::swap(p, other.p); return *this;}
+
+        explicit operator bool() const noexcept {return p != nullptr;}
+        auto operator->() const noexcept -> node* {return p;}
+
+        auto make_unique() -> void {
+        // replaces the node by a copy if it's shared
+            if (p->refs > 1)
+                *this = node_ref(new_node(p->resource, p->kv.first, p->kv.second, p->left, p->right));
+        }
+
+        node* p = nullptr;
+
+    private:
+        auto release() noexcept -> void {
+            if (p && !--p->refs) {
+                auto resource = p->resource;
+                p->~node();
+                resource->deallocate(p, sizeof(node), alignof(node));
+            }
+        }
+    };
+
+    struct node {
+        std::size_t refs = 1;
+        std::pmr::memory_resource* resource;
+        node_ref left;
+        node_ref right;
+        int height = 1;
+        value_type kv;
+
+        node(std::pmr::memory_resource* resource_, std::string_view key, const T& value, node_ref left_, node_ref right_)
+        :
+            resource{resource_}, left{std::move(left_)}, right{std::move(right_)},
+            kv{std::piecewise_construct, std::forward_as_tuple(key, resource_), std::forward_as_tuple(value)}
+        {}
+    };
+
+    static auto new_node(std::pmr::memory_resource* resource, std::string_view key, const T& value,
+        node_ref left = node_ref(), node_ref right = node_ref()) -> node*;
+    static auto height(const node_ref& n) noexcept -> int {return n ? n->height : 0;}
+    static auto update_height(node_ref& n) noexcept -> void
+    {n->height = 1 + std::max(height(n->left), height(n->right));}
+    static auto rotate_left(node_ref& n) -> void;
+    static auto rotate_right(node_ref& n) -> void;
+    static auto rebalance(node_ref& n) -> void;
+    auto insert_or_assign(node_ref& n, std::string_view key, const T& value) -> void;
+    static auto erase(node_ref& n, std::string_view key) -> void;
+    static auto remove_min(node_ref& n) -> node_ref;
+    static auto add_usage(const node* n, bool exclusive, persistent_map_usage& result) noexcept -> void;
+
+    std::pmr::memory_resource* resource;
+    node_ref root;
+    std::size_t size_ = 0;
+
+public:
+    class const_iterator {
+    // in-order iterator; holds the path from the root to the current node.
+    // invalidated by a change of the map
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = persistent_map::value_type;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const value_type*;
+        using reference = const value_type&;
+
+        const_iterator() noexcept = default;
+
+        auto operator*() const noexcept -> reference {assert(depth); return path[depth - 1]->kv;}
+        auto operator->() const noexcept -> pointer {return &**this;}
+        auto operator++() noexcept -> const_iterator& {
+            assert(depth);
+            auto n = path[--depth];
+            descend_left(n->right.p);
+            return *this;
+        }
+        auto operator++(int) noexcept -> const_iterator {auto old = *this; ++*this; return old;}
+        auto operator==(const const_iterator& other) const noexcept -> bool {return current() == other.current();}
+        auto operator!=(const const_iterator& other) const noexcept -> bool {return !(*this == other);}
+
+    private:
+        friend persistent_map;
+        static constexpr std::size_t max_depth = 64; // an avl tree this high has more than 2^44 nodes
+        std::array<const node*, max_depth> path;
+        std::size_t depth = 0;
+
+        auto current() const noexcept -> const node* {return depth ? path[depth - 1] : nullptr;}
+        auto descend_left(const node* n) noexcept -> void {
+            for (; n; n = n->left.p) {
+                assert(depth < max_depth);
+                path[depth++] = n;
+            }
+        }
+    };
+
+    auto begin() const noexcept -> const_iterator {auto itr = const_iterator(); itr.descend_left(root.p); return itr;}
+    auto end() const noexcept -> const_iterator {return const_iterator();}
+};
+
+template <typename T>
+auto persistent_map<T>::new_node(std::pmr::memory_resource* resource, std::string_view key, const T& value,
+    node_ref left, node_ref right) -> node*
+{
+    auto p = static_cast<node*>(resource->allocate(sizeof(node), alignof(node)));
+    try {
+        return new (p) node(resource, key, value, std::move(left), std::move(right));
+    } catch (...) {
+        resource->deallocate(p, sizeof(node), alignof(node));
+        throw;
+    }
+}
+
+template <typename T>
+auto persistent_map<T>::find(std::string_view key) const noexcept -> const T* {
+    for (auto n = root.p; n;) {
+        auto cmp = key.compare(n->kv.first);
+        if (!cmp)
+            return &n->kv.second;
+        n = cmp < 0 ? n->left.p : n->right.p;
+    }
+    return nullptr;
+}
+
+template <typename T>
+auto persistent_map<T>::rotate_left(node_ref& n) -> void {
+    n->right.make_unique();
+    auto r = std::move(n->right);
+    n->right = r->left;
+    update_height(n);
+    r->left = std::move(n);
+    update_height(r);
+    n = std::move(r);
+}
+
+template <typename T>
+auto persistent_map<T>::rotate_right(node_ref& n) -> void {
+    n->left.make_unique();
+    auto l = std::move(n->left);
+    n->left = l->right;
+    update_height(n);
+    l->right = std::move(n);
+    update_height(l);
+    n = std::move(l);
+}
+
+template <typename T>
+auto persistent_map<T>::rebalance(node_ref& n) -> void {
+// n is unique; the nodes rotated are made unique, which allocates only if they
+// are shared (never the case after an insertion, as they are on the path)
+    update_height(n);
+    auto balance = height(n->left) - height(n->right);
+    if (balance > 1) {
+        if (height(n->left->left) < height(n->left->right)) {
+            n->left.make_unique();
+            rotate_left(n->left);
+        }
+        rotate_right(n);
+    } else if (balance < -1) {
+        if (height(n->right->right) < height(n->right->left)) {
+            n->right.make_unique();
+            rotate_right(n->right);
+        }
+        rotate_left(n);
+    }
+}
+
+template <typename T>
+auto persistent_map<T>::insert_or_assign(std::string_view key, const T& value) -> void {
+    insert_or_assign(root, key, value);
+}
+
+template <typename T>
+auto persistent_map<T>::insert_or_assign(node_ref& n, std::string_view key, const T& value) -> void {
+// the nodes on the path are made unique on the way down; if an allocation then
+// fails, the map holds copies of some of its nodes but is otherwise unchanged
+    if (!n) {
+        n = node_ref(new_node(resource, key, value));
+        ++size_;
+        return;
+    }
+    n.make_unique();
+    auto cmp = key.compare(n->kv.first);
+    if (!cmp) {
+        n->kv.second = value;
+        return;
+    }
+    insert_or_assign(cmp < 0 ? n->left : n->right, key, value);
+    rebalance(n);
+}
+
+template <typename T>
+auto persistent_map<T>::erase(std::string_view key) -> bool {
+// rebalancing may rotate nodes off the path, which may need to be copied, so
+// the erasure is done on a copy of the root for the map to be unchanged if an
+// allocation fails
+    if (!contains(key))
+        return false;
+    auto new_root = root;
+    erase(new_root, key);
+    root = std::move(new_root);
+    --size_;
+    return true;
+}
+
+template <typename T>
+auto persistent_map<T>::erase(node_ref& n, std::string_view key) -> void {
+    assert(n);
+    n.make_unique();
+    auto cmp = key.compare(n->kv.first);
+    if (cmp < 0)
+        erase(n->left, key);
+    else if (cmp > 0)
+        erase(n->right, key);
+    else if (!n->left) {
+        n = node_ref(n->right);
+        return;
+    } else if (!n->right) {
+        n = node_ref(n->left);
+        return;
+    } else {
+        auto min = remove_min(n->right);
+        n = node_ref(new_node(n->resource, min->kv.first, min->kv.second, n->left, n->right));
+    }
+    rebalance(n);
+}
+
+template <typename T>
+auto persistent_map<T>::remove_min(node_ref& n) -> node_ref {
+    if (!n->left) {
+        auto min = n;
+        n = node_ref(n->right);
+        return min;
+    }
+    n.make_unique();
+    auto min = remove_min(n->left);
+    rebalance(n);
+    return min;
+}
+
+template <typename T>
+auto persistent_map<T>::memory_usage() const noexcept -> persistent_map_usage {
+    auto result = persistent_map_usage();
+    add_usage(root.p, true, result);
+    return result;
+}
+
+template <typename T>
+auto persistent_map<T>::add_usage(const node* n, bool exclusive, persistent_map_usage& result) noexcept -> void {
+// a node is exclusive to the map if it and all its ancestors are referenced once
+    if (!n)
+        return;
+    exclusive = exclusive && n->refs == 1;
+    auto& key = n->kv.first;
+    auto bytes = sizeof(node) + (key.capacity() > std::pmr::string().capacity() ? key.capacity() + 1 : 0);
+    ++result.nodes;
+    result.bytes += bytes;
+    if (exclusive)
+        result.exclusive_bytes += bytes;
+    add_usage(n->left.p, exclusive, result);
+    add_usage(n->right.p, exclusive, result);
+}
+
+#endif // PERSISTENT_MAP_HPP
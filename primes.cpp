@@ -0,0 +1,211 @@
+#include "primes.hpp"
+#include "calc_cancellation.hpp"
+#include "int_functions.hpp"
+#include "montgomery.hpp"
+#include "reductions.hpp"
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+
+namespace calc_val {
+
+namespace {
+
+using std::uint64_t;
+using helper::ctz;
+using helper::montgomery;
+
+constexpr unsigned small_primes[] = {
+    2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53, 59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103,
+    107, 109, 113, 127, 131, 137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223,
+    227, 229, 233, 239, 241, 251};
+constexpr max_uint_type small_primes_limit = 257 * 257; // a number below it with no small prime factor is prime
+
+template <typename W>
+auto strong_probable_prime(const montgomery<W>& mont, W base) -> bool {
+// miller-rabin: n = d * 2^s + 1 (d odd) passes if base^d is 1 or base^(d * 2^r)
+// is -1 mod n for some r < s
+    auto n = mont.modulus();
+    if (base % n == 0)
+        return true;
+    auto s = ctz(n - 1);
+    auto one = mont.one();
+    auto minus_one = mont.sub(0, one);
+    auto x = mont.pow(mont.to_form(base), (n - 1) >> s);
+    if (x == one || x == minus_one)
+        return true;
+    for (unsigned r = 1; r < s; ++r) {
+        x = mont.mul(x, x);
+        if (x == minus_one)
+            return true;
+        if (x == one)
+            return false;
+    }
+    return false;
+}
+
+auto jacobi(max_uint_type a, max_uint_type n) -> int {
+// jacobi symbol (a/n), n odd
+    auto t = 1;
+    a %= n;
+    while (a) {
+        while (!(a & 1)) {
+            a >>= 1;
+            if ((n & 7) == 3 || (n & 7) == 5)
+                t = -t;
+        }
+        std::swap(a, n);
+        if ((a & 3) == 3 && (n & 3) == 3)
+            t = -t;
+        a %= n;
+    }
+    return n == 1 ? t : 0;
+}
+
+auto strong_lucas_probable_prime(const montgomery<max_uint_type>& mont) -> bool {
+// with selfridge's parameters: the first d of 5, -7, 9, -11, ... with
+// jacobi(d/n) = -1, p = 1 and q = (1 - d) / 4. n + 1 = k * 2^s (k odd)
+// passes if u(k) is 0 or v(k * 2^r) is 0 mod n for some r < s. n must not be
+// a square, or there is no such d
+    auto n = mont.modulus();
+    auto residue = [&](std::int64_t x) { // x mod n, for |x| < n
+        return x >= 0 ? max_uint_type(x) : n - max_uint_type(-x);
+    };
+    auto d = std::int64_t(5);
+    for (;; d = d > 0 ? -(d + 2) : -d + 2) {
+        auto j = jacobi(residue(d), n);
+        if (j == -1)
+            break;
+        if (j == 0)
+            return false; // d and n have a common factor
+    }
+    auto d_form = mont.to_form(residue(d));
+    auto q_form = mont.to_form(residue((1 - d) / 4));
+
+    auto s = ctz(n + 1); // n + 1 doesn't overflow: 2^128 - 1 is a multiple of 3
+    auto k = (n + 1) >> s;
+    auto u = mont.one(); // u(1), v(1) and q^1
+    auto v = mont.one();
+    auto qk = q_form;
+    auto top = 127 - static_cast<unsigned>(clz(k, 128)); // k's highest 1 bit
+    for (auto bit = top; bit-- > 0;) {
+        u = mont.mul(u, v); // u(2j) = u(j) * v(j), v(2j) = v(j)^2 - 2 * q^j
+        v = mont.sub(mont.mul(v, v), mont.add(qk, qk));
+        qk = mont.mul(qk, qk);
+        if ((k >> bit) & 1) { // u(j+1) = (u(j) + v(j)) / 2, v(j+1) = (d * u(j) + v(j)) / 2
+            auto u_next = mont.half(mont.add(u, v));
+            v = mont.half(mont.add(mont.mul(d_form, u), v));
+            u = u_next;
+            qk = mont.mul(qk, q_form);
+        }
+    }
+    if (u == 0 || v == 0)
+        return true;
+    for (unsigned r = 1; r < s; ++r) {
+        v = mont.sub(mont.mul(v, v), mont.add(qk, qk));
+        if (v == 0)
+            return true;
+        qk = mont.mul(qk, qk);
+    }
+    return false;
+}
+
+auto is_prime(max_uint_type x) -> bool {
+    if (x < 2)
+        return false;
+    for (auto p : small_primes) {
+        if (x % p == 0)
+            return x == p;
+    }
+    if (x < small_primes_limit)
+        return true;
+    if (x >> 64 == 0) {
+        auto mont = montgomery<uint64_t>(static_cast<uint64_t>(x));
+        for (uint64_t base : {2, 325, 9375, 28178, 450775, 9780504, 1795265022}) {
+            if (!strong_probable_prime(mont, base))
+                return false;
+        }
+        return true;
+    }
+    auto mont = montgomery<max_uint_type>(x);
+    if (!strong_probable_prime(mont, max_uint_type(2)))
+        return false;
+    auto r = isqrt(x, 128);
+    return r * r != x && strong_lucas_probable_prime(mont);
+}
+
+template <typename W>
+auto rho_divisor(W n) -> W {
+// a divisor of odd composite n other than 1 and n, by pollard's rho with
+// brent's cycle detection, iterating x^2 + c (in montgomery form, which
+// doesn't change the gcds). differences are multiplied in batches of m so
+// that there is one gcd per batch; a batch that overshoots is stepped through
+// again. returns n if cancelled
+    constexpr W m = 128;
+    auto mont = montgomery<W>(n);
+    for (W c = 1;; ++c) {
+        auto c_form = mont.to_form(c);
+        auto f = [&](W x) {return mont.add(mont.mul(x, x), c_form);};
+        auto diff = [](W x, W y) {return x > y ? x - y : y - x;};
+        auto y = c_form, x = y, ys = y;
+        auto q = mont.one();
+        auto g = W(1);
+        for (W r = 1; g == 1; r *= 2) {
+            x = y;
+            for (W i = 0; i < r; ++i) {
+                y = f(y);
+                if (i % m == 0 && cancellation_requested())
+                    return n;
+            }
+            for (W k = 0; k < r && g == 1; k += m) {
+                ys = y;
+                for (W i = 0; i < std::min(m, r - k); ++i) {
+                    y = f(y);
+                    q = mont.mul(q, diff(x, y));
+                }
+                g = static_cast<W>(gcd(q, n));
+                if (cancellation_requested())
+                    return n;
+            }
+        }
+        if (g == n) {
+            do {
+                ys = f(ys);
+                g = static_cast<W>(gcd(diff(x, ys), n));
+            } while (g == 1);
+        }
+        if (g != n)
+            return g;
+    }
+}
+
+auto least_prime_factor(max_uint_type x) -> max_uint_type {
+// x has no small prime factor
+    if (is_prime(x))
+        return x;
+    auto d = x >> 64 == 0 ? rho_divisor<uint64_t>(static_cast<uint64_t>(x)) : rho_divisor(x);
+    if (d == x)
+        return x; // cancelled
+    auto p = least_prime_factor(d);
+    return std::min(p, least_prime_factor(x / d));
+}
+
+} // namespace
+
+auto isprime(max_uint_type x, unsigned) -> max_uint_type {
+    return is_prime(x);
+}
+
+auto factor(max_uint_type x, unsigned) -> max_uint_type {
+    if (x < 2)
+        return x;
+    for (auto p : small_primes) {
+        if (x % p == 0)
+            return p;
+    }
+    if (x < small_primes_limit)
+        return x;
+    return least_prime_factor(x);
+}
+
+} // namespace calc_val
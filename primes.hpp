@@ -0,0 +1,29 @@
+#ifndef PRIMES_HPP
+#define PRIMES_HPP
+
+// prime functions of calc_parser's unary_fn_table. like the functions of
+// int_functions.hpp, each takes the bits of an integer word (a negative int
+// argument is rejected by the caller's domain check) and returns the bits of
+// the result. both divide by the primes below 256 first and then use
+// montgomery multiplication (montgomery.hpp), on 64-bit words when the
+// number fits in one
+
+#include "basics.hpp"
+
+namespace calc_val {
+
+auto isprime(max_uint_type x, unsigned word_size) -> max_uint_type;
+// 1 if x is prime, else 0. deterministic below 2^64: miller-rabin with 7
+// bases that no composite below 2^64 passes. above, baillie-psw (miller-rabin
+// to base 2 and a strong lucas test), which no known composite passes
+
+auto factor(max_uint_type x, unsigned word_size) -> max_uint_type;
+// least prime factor of x, or x if it is 0 or 1; x / factor(x) has the other
+// factors. composites are split with pollard-brent rho, whose time grows with
+// the square root of the second largest prime factor: about 0.1 ms for one
+// below 2^24, a few ms for 2^32 and most of a second for 2^48 (it checks for
+// cancellation)
+
+} // namespace calc_val
+
+#endif // PRIMES_HPP
@@ -0,0 +1,73 @@
+#ifndef REAL_FUNCTIONS_HPP
+#define REAL_FUNCTIONS_HPP
+
+// real overloads of functions of calc_parser's unary_fn_table, for finite,
+// nonzero arguments x + 0i or x - 0i (negative_zero) in their real domain (all
+// reals unless noted). each gives the value of the complex function, the real
+// part computed as boost's complex function computes it and the imaginary part
+// the 0 or -0 that it gives, without the cost of complex arithmetic. where a
+// part is not finite the complex function may differ, and is to be used instead
+
+#include "complex_type.hpp"
+#include <limits>
+
+namespace calc_val::real {
+
+inline auto zero(bool negative) -> float_type
+{return negative ? -float_type(0) : float_type(0);}
+
+inline auto exp(const float_type& x, bool) -> complex_type
+{return complex_type(boost::multiprecision::exp(x));}
+
+inline auto log(const float_type& x, bool) -> complex_type // x > 0
+{return complex_type(boost::multiprecision::log(x));}
+
+inline auto log10(const float_type& x, bool) -> complex_type // x > 0
+{return complex_type(boost::multiprecision::log10(x));}
+
+inline auto log2(const float_type& x, bool) -> complex_type // x > 0
+{return complex_type(boost::multiprecision::log(x) / boost::multiprecision::log(float_type(2)));}
+
+inline auto sqrt(const float_type& x, bool) -> complex_type // x > 0
+{return complex_type(boost::multiprecision::sqrt(x));}
+
+inline auto cbrt(const float_type& x, bool) -> complex_type // x > 0
+// exp(log(x) / 3), as complex pow
+{return complex_type(boost::multiprecision::exp(boost::multiprecision::log(x) * (float_type(1) / float_type(3))));}
+
+inline auto sin(const float_type& x, bool negative_zero) -> complex_type
+// sin(x) cosh(0i) + cos(x) sinh(0i) i
+{return complex_type(boost::multiprecision::sin(x), zero(negative_zero != signbit(boost::multiprecision::cos(x))));}
+
+inline auto cos(const float_type& x, bool negative_zero) -> complex_type
+// cos(x) cosh(0i) - sin(x) sinh(0i) i
+{return complex_type(boost::multiprecision::cos(x), zero(negative_zero == signbit(boost::multiprecision::sin(x))));}
+
+inline auto tan(const float_type& x, bool negative_zero) -> complex_type
+{return complex_type(boost::multiprecision::tan(x), zero(negative_zero));}
+
+inline auto atan(const float_type& x, bool) -> complex_type
+// the complex function's imaginary part is nan where x^2 overflows
+{
+    auto imag = isinf(x * x) ? std::numeric_limits<float_type>::quiet_NaN() : float_type(0);
+    return complex_type(boost::multiprecision::atan(x), imag);
+}
+
+inline auto sinh(const float_type& x, bool negative_zero) -> complex_type
+{return complex_type(boost::multiprecision::sinh(x), zero(negative_zero));}
+
+inline auto cosh(const float_type& x, bool negative_zero) -> complex_type
+// cosh(x) cos(0i) + sinh(x) sin(0i) i
+{return complex_type(boost::multiprecision::cosh(x), zero(negative_zero != (x < 0)));}
+
+inline auto tanh(const float_type& x, bool negative_zero) -> complex_type
+// sinh(x) / cosh(x), as complex tanh, which is nan where they overflow
+{return complex_type(boost::multiprecision::sinh(x) / boost::multiprecision::cosh(x), zero(negative_zero));}
+
+inline auto asinh(const float_type& x, bool) -> complex_type
+// log(x + sqrt(x^2 + 1)), as complex asinh
+{return complex_type(boost::multiprecision::log(x + boost::multiprecision::sqrt(x * x + 1)));}
+
+} // namespace calc_val::real
+
+#endif // REAL_FUNCTIONS_HPP
@@ -0,0 +1,146 @@
+#include "reductions.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <utility>
+
+namespace calc_val {
+
+namespace {
+
+constexpr std::size_t vector_bytes = 16; // the width the baseline instruction set has (sse2 on x86-64)
+constexpr std::size_t lanes = vector_bytes / sizeof(std::uint64_t);
+
+template <typename T>
+using lane_vector [[gnu::vector_size(vector_bytes)]] = T;
+
+template <typename T>
+inline auto load(const T* p) -> lane_vector<T> {
+    auto v = lane_vector<T>();
+    std::memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+template <typename T, typename Op>
+auto reduce_lanes(std::span<const T> x, T identity, Op op) -> T {
+// folds x with op, lanes elements at a time, then folds the lanes
+    auto acc = lane_vector<T>{} + identity;
+    std::size_t i = 0;
+    for (; i + lanes <= x.size(); i += lanes)
+        acc = op(acc, load(x.data() + i));
+    auto r = identity;
+    for (std::size_t lane = 0; lane < lanes; ++lane)
+        r = op(r, acc[lane]);
+    for (; i < x.size(); ++i)
+        r = op(r, x[i]);
+    return r;
+}
+
+struct add_op {
+    template <typename V>
+    auto operator()(const V& a, const V& b) const -> V {return a + b;}
+};
+
+struct mul_op {
+    template <typename V>
+    auto operator()(const V& a, const V& b) const -> V {return a * b;}
+};
+
+struct min_op {
+    template <typename V>
+    auto operator()(const V& a, const V& b) const -> V {return b < a ? b : a;}
+};
+
+struct max_op {
+    template <typename V>
+    auto operator()(const V& a, const V& b) const -> V {return a < b ? b : a;}
+};
+
+auto neumaier_sum(std::span<const complex_type> z, float_type (*part)(const complex_type&)) -> float_type {
+    auto s = float_type(0);
+    auto c = float_type(0); // compensation: the low order bits lost from s
+    auto finite = true; // else the plain sum is the sum (the compensation would be inf - inf)
+    for (auto& elem : z) {
+        auto x = part(elem);
+        auto t = s + x;
+        if (!isfinite(t)) // so s or x isn't either
+            finite = false;
+        else if (abs(s) >= abs(x))
+            c += (s - t) + x;
+        else
+            c += (x - t) + s;
+        s = std::move(t);
+    }
+    return finite ? s + c : s;
+}
+
+} // namespace
+
+auto sum_lanes(std::span<const std::uint64_t> x) -> std::uint64_t
+{return reduce_lanes(x, std::uint64_t(0), add_op());}
+
+auto prod_lanes(std::span<const std::uint64_t> x) -> std::uint64_t
+{return reduce_lanes(x, std::uint64_t(1), mul_op());}
+
+auto min_lanes(std::span<const std::int64_t> x) -> std::int64_t
+{return reduce_lanes(x, x.front(), min_op());}
+
+auto min_lanes(std::span<const std::uint64_t> x) -> std::uint64_t
+{return reduce_lanes(x, x.front(), min_op());}
+
+auto max_lanes(std::span<const std::int64_t> x) -> std::int64_t
+{return reduce_lanes(x, x.front(), max_op());}
+
+auto max_lanes(std::span<const std::uint64_t> x) -> std::uint64_t
+{return reduce_lanes(x, x.front(), max_op());}
+
+auto sum(std::span<const complex_type> z) -> complex_type {
+    return complex_type(
+        neumaier_sum(z, [](const complex_type& z) -> float_type {return z.real();}),
+        neumaier_sum(z, [](const complex_type& z) -> float_type {return z.imag();}));
+}
+
+auto hypot(std::span<const float_type> magnitudes) -> float_type {
+    auto scale = float_type(0);
+    auto nan = false;
+    for (auto& m : magnitudes) {
+        if (isinf(m))
+            return m;
+        if (isnan(m))
+            nan = true;
+        else
+            scale = std::max(scale, m);
+    }
+    if (nan)
+        return std::numeric_limits<float_type>::quiet_NaN();
+    if (scale == 0)
+        return scale;
+    auto s = float_type(0);
+    for (auto& m : magnitudes) {
+        auto x = m / scale;
+        s += x * x;
+    }
+    return sqrt(s) * scale;
+}
+
+auto gcd(max_uint_type x, max_uint_type y) -> max_uint_type {
+    auto ctz = [](max_uint_type x) -> unsigned { // x != 0
+        auto low = static_cast<std::uint64_t>(x);
+        return low ? __builtin_ctzll(low) : 64 + __builtin_ctzll(static_cast<std::uint64_t>(x >> 64));
+    };
+    if (x == 0)
+        return y;
+    if (y == 0)
+        return x;
+    auto shift = std::min(ctz(x), ctz(y));
+    x >>= ctz(x);
+    do {
+        y >>= ctz(y);
+        if (x > y)
+            std::swap(x, y);
+        y -= x;
+    } while (y);
+    return x << shift;
+}
+
+} // namespace calc_val
@@ -0,0 +1,43 @@
+#ifndef REDUCTIONS_HPP
+#define REDUCTIONS_HPP
+
+// kernels of calc_parser's variadic functions (min, max, sum, ...), over
+// arguments converted to a common type.
+// integer words of up to 64 bits are reduced as 64-bit lanes (sign extended
+// for int, zero extended for uint), several at a time with gcc's vector
+// extensions, as wide as the baseline instruction set's vectors. the caller
+// trims the result to the word size, which is exact for sums and products as
+// they wrap around in any case. 128-bit words are reduced one at a time.
+// sums of floats are compensated
+
+#include "complex_type.hpp"
+#include <cstdint>
+#include <span>
+
+namespace calc_val {
+
+auto sum_lanes(std::span<const std::uint64_t> x) -> std::uint64_t;
+auto prod_lanes(std::span<const std::uint64_t> x) -> std::uint64_t;
+// modulo 2^64, for int and uint lanes alike
+
+auto min_lanes(std::span<const std::int64_t> x) -> std::int64_t;
+auto min_lanes(std::span<const std::uint64_t> x) -> std::uint64_t;
+auto max_lanes(std::span<const std::int64_t> x) -> std::int64_t;
+auto max_lanes(std::span<const std::uint64_t> x) -> std::uint64_t;
+// x must not be empty
+
+auto sum(std::span<const complex_type> z) -> complex_type;
+// the real and imaginary parts are summed with neumaier's compensated
+// summation, or plainly if a partial sum is not finite
+
+auto hypot(std::span<const float_type> magnitudes) -> float_type;
+// sqrt of the sum of the squares of magnitudes (each >= 0), scaled by the
+// largest so the squares can't overflow. inf if a magnitude is inf (even if
+// another is nan), else nan if one is nan
+
+auto gcd(max_uint_type x, max_uint_type y) -> max_uint_type;
+// binary (stein's) gcd; gcd(0, 0) is 0
+
+} // namespace calc_val
+
+#endif // REDUCTIONS_HPP
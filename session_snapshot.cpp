@@ -0,0 +1,378 @@
+#include "calc_parser.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// snapshot format (all fields in the machine's byte order):
+//   header: magic, format version, byte order mark, limb size
+//   parser options, output options
+//   "last"
+//   variable count, then for each: identifier, value
+//   formula count, then for each: identifier, source
+// a value is its variant index followed by, for complex_type, the real and
+// imaginary parts as floats, or for an int type (wide ones too), its bytes. a float is its
+// sign, exponent, limb count and the limbs of its bits. strings are a length
+// followed by the characters
+
+namespace {
+
+constexpr char snapshot_magic[8] = {'c', 'c', 'a', 'l', 'c', 's', 's', '\0'};
+constexpr std::uint32_t snapshot_version = 2; // 2: 16-bit int word size, wide int values
+constexpr std::uint32_t byte_order_mark = 0x01020304;
+
+using float_backend = calc_val::float_type::backend_type;
+using boost::multiprecision::limb_type;
+constexpr std::size_t max_limbs = (float_backend::bit_count + sizeof(limb_type) * 8 - 1) / (sizeof(limb_type) * 8);
+
+class snapshot_writer {
+public:
+    template <typename T>
+    auto put(const T& x) -> void {
+        static_assert(std::is_trivially_copyable_v<T>);
+        buf.append(reinterpret_cast<const char*>(&x), sizeof(x));
+    }
+
+    auto put(std::string_view s) -> void {
+        put(static_cast<std::uint32_t>(s.size()));
+        buf.append(s);
+    }
+
+    auto put(const calc_val::float_type& x) -> void {
+        auto& backend = x.backend();
+        auto& bits = backend.bits();
+        put(static_cast<std::uint8_t>(backend.sign()));
+        put(static_cast<std::int64_t>(backend.exponent()));
+        put(static_cast<std::uint8_t>(bits.size()));
+        buf.append(reinterpret_cast<const char*>(bits.limbs()), bits.size() * sizeof(limb_type));
+    }
+
+    auto put(const calc_val::variant_type& val) -> void {
+        put(static_cast<std::uint8_t>(val.index()));
+        std::visit([&](const auto& x) {
+            if constexpr (calc_val::is_complex_type<decltype(x)>()) {
+                put(calc_val::float_type(x.real()));
+                put(calc_val::float_type(x.imag()));
+            } else
+                put(x);
+        }, val);
+    }
+
+    std::string buf;
+};
+
+class snapshot_reader {
+// reads from a snapshot that may be truncated or corrupt; throws
+// calc_parser::invalid_snapshot if it is
+public:
+    explicit snapshot_reader(std::string_view snapshot) : in{snapshot} {}
+
+    template <typename T>
+    auto get() -> T {
+        static_assert(std::is_trivially_copyable_v<T>);
+        T x;
+        std::memcpy(&x, take(sizeof(x)).data(), sizeof(x));
+        return x;
+    }
+
+    auto get_string() -> std::string_view {return take(get<std::uint32_t>());}
+
+    auto get_float() -> calc_val::float_type {
+        auto x = calc_val::float_type();
+        auto& backend = x.backend();
+        backend.sign() = get<std::uint8_t>();
+        auto exponent = get<std::int64_t>();
+        if (exponent < std::numeric_limits<float_backend::exponent_type>::min()
+                || exponent > std::numeric_limits<float_backend::exponent_type>::max())
+            throw calc_parser::invalid_snapshot();
+        backend.exponent() = static_cast<float_backend::exponent_type>(exponent);
+        auto n_limbs = get<std::uint8_t>();
+        if (!n_limbs || n_limbs > max_limbs)
+            throw calc_parser::invalid_snapshot();
+        auto& bits = backend.bits();
+        bits.resize(n_limbs, n_limbs);
+        std::memcpy(bits.limbs(), take(n_limbs * sizeof(limb_type)).data(), n_limbs * sizeof(limb_type));
+        bits.normalize();
+        return x;
+    }
+
+    auto get_value() -> calc_val::variant_type {
+        switch (get<std::uint8_t>()) {
+            case 0: {
+                auto real = get_float();
+                return calc_val::complex_type(real, get_float());
+            }
+            case 1:
+                return get<calc_val::uint_type>();
+            case 2:
+                return get<calc_val::int_type>();
+            case 3:
+                return get<calc_val::wide_uint_type>();
+            case 4:
+                return get<calc_val::wide_int_type>();
+            default:
+                throw calc_parser::invalid_snapshot();
+        }
+    }
+
+    auto get_number_type_code() -> calc_val::number_type_codes {
+        auto code = get<std::uint8_t>();
+        if (code != calc_val::complex_code && code != calc_val::uint_code && code != calc_val::int_code)
+            throw calc_parser::invalid_snapshot();
+        return static_cast<calc_val::number_type_codes>(code);
+    }
+
+    auto get_radix() -> calc_val::radices {
+        auto radix = get<std::uint8_t>();
+        if (radix != calc_val::base2 && radix != calc_val::base8 && radix != calc_val::base10 && radix != calc_val::base16)
+            throw calc_parser::invalid_snapshot();
+        return static_cast<calc_val::radices>(radix);
+    }
+
+    auto get_int_word_size() -> calc_val::int_word_sizes {
+        auto size = get<std::uint16_t>();
+        if (size != calc_val::int_bits_8 && size != calc_val::int_bits_16 && size != calc_val::int_bits_32
+                && size != calc_val::int_bits_64 && size != calc_val::int_bits_128 && size != calc_val::int_bits_256
+                && size != calc_val::int_bits_512 && size != calc_val::int_bits_1024)
+            throw calc_parser::invalid_snapshot();
+        return static_cast<calc_val::int_word_sizes>(size);
+    }
+
+    auto at_end() const -> bool {return in.empty();}
+
+private:
+    std::string_view in;
+
+    auto take(std::size_t n) -> std::string_view {
+        if (n > in.size())
+            throw calc_parser::invalid_snapshot();
+        auto s = in.substr(0, n);
+        in.remove_prefix(n);
+        return s;
+    }
+};
+
+static_assert(std::variant_size_v<calc_val::variant_type> == 5
+    && std::is_same_v<std::variant_alternative_t<0, calc_val::variant_type>, calc_val::complex_type>
+    && std::is_same_v<std::variant_alternative_t<1, calc_val::variant_type>, calc_val::uint_type>
+    && std::is_same_v<std::variant_alternative_t<2, calc_val::variant_type>, calc_val::int_type>
+    && std::is_same_v<std::variant_alternative_t<3, calc_val::variant_type>, calc_val::wide_uint_type>
+    && std::is_same_v<std::variant_alternative_t<4, calc_val::variant_type>, calc_val::wide_int_type>);
+    // get_value assumes these
+
+auto is_snapshot_identifier(std::string_view identifier) -> bool {
+// whether identifier is an identifier as the lexer reads it, as a session's
+// variables are (they may shadow constants and functions, e.g., "pi")
+    auto lexer = calc_lexer(identifier, calc_val::base10);
+    return lexer.get_token().id == lexer_token::identifier && lexer.get_token().id == lexer_token::end;
+}
+
+template <typename Formula>
+auto formulas_have_cycle(const std::vector<std::pair<std::string_view, Formula>>& formulas) -> bool {
+// whether a formula depends on itself through the dependencies of others,
+// which define_formula refuses
+    auto dependencies = std::map<std::string_view, const Formula*>();
+    for (auto& [identifier, f] : formulas)
+        dependencies.emplace(identifier, &f);
+    auto done = std::map<std::string_view, bool>(); // false while a formula's dependencies are being visited
+    auto reaches_cycle = [&](auto& self, std::string_view identifier) -> bool {
+        auto itr = dependencies.find(identifier);
+        if (itr == dependencies.end())
+            return false;
+        auto [state, first_visit] = done.emplace(identifier, false);
+        if (!first_visit)
+            return !state->second;
+        for (std::string_view dependency : *itr->second->dependencies)
+            if (self(self, dependency))
+                return true;
+        state->second = true;
+        return false;
+    };
+    return std::any_of(formulas.begin(), formulas.end(),
+        [&](const auto& elem) {return reaches_cycle(reaches_cycle, elem.first);});
+}
+
+struct file_descriptor {
+    int fd;
+    explicit file_descriptor(int fd_) : fd{fd_} {
+        if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "open");
+    }
+    ~file_descriptor() {::close(fd);}
+};
+
+} // namespace
+
+auto calc_parser::save_snapshot(const output_options& out_options) const -> std::string {
+    auto writer = snapshot_writer();
+    writer.buf.append(snapshot_magic, sizeof(snapshot_magic));
+    writer.put(snapshot_version);
+    writer.put(byte_order_mark);
+    writer.put(static_cast<std::uint8_t>(sizeof(limb_type)));
+
+    writer.put(static_cast<std::uint8_t>(default_number_type_code));
+    writer.put(static_cast<std::uint8_t>(default_number_radix));
+    writer.put(static_cast<std::uint16_t>(int_word_size));
+    writer.put(static_cast<std::uint8_t>(out_options.output_radix));
+    writer.put(static_cast<std::uint32_t>(out_options.precision));
+    writer.put(static_cast<std::uint8_t>(out_options.output_fp_normalized));
+
+    writer.put(last_val());
+
+    writer.put(static_cast<std::uint64_t>(variables.size()));
+    for (auto& [identifier, val] : variables) {
+        writer.put(std::string_view(identifier));
+        writer.put(val);
+    }
+
+    writer.put(static_cast<std::uint64_t>(formulas.size()));
+    for (auto& [identifier, f] : formulas) {
+        writer.put(std::string_view(identifier));
+        writer.put(f.expr->source());
+    }
+
+    return std::move(writer.buf);
+}
+
+auto calc_parser::save_snapshot(const char* path, const output_options& out_options) const -> void {
+    auto snapshot = save_snapshot(out_options);
+    auto file = file_descriptor(::open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666));
+    for (std::string_view out = snapshot; !out.empty();) {
+        auto n = ::write(file.fd, out.data(), out.size());
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            throw std::system_error(errno, std::generic_category(), "write");
+        }
+        out.remove_prefix(static_cast<std::size_t>(n));
+    }
+}
+
+auto calc_parser::load_snapshot(std::string_view snapshot, output_options& out_options) -> void {
+    // decode and check everything before changing the session so a malformed
+    // snapshot leaves it unchanged
+
+    auto reader = snapshot_reader(snapshot);
+    for (auto c : snapshot_magic)
+        if (reader.get<char>() != c)
+            throw invalid_snapshot();
+    if (reader.get<std::uint32_t>() != snapshot_version
+            || reader.get<std::uint32_t>() != byte_order_mark
+            || reader.get<std::uint8_t>() != sizeof(limb_type))
+        throw invalid_snapshot();
+
+    auto new_options = parser_options();
+    new_options.default_number_type_code = reader.get_number_type_code();
+    new_options.default_number_radix = reader.get_radix();
+    new_options.int_word_size = reader.get_int_word_size();
+    auto new_out_options = output_options();
+    new_out_options.output_radix = reader.get_radix();
+    new_out_options.precision = static_cast<decltype(new_out_options.precision)>(reader.get<std::uint32_t>());
+    new_out_options.output_fp_normalized = reader.get<std::uint8_t>() != 0;
+
+    // the values are trimmed to the snapshot's word size, and the formulas
+    // compiled with its options and variables, so those are the session's
+    // while decoding; the previous ones are put back if the snapshot is
+    // rejected
+    auto previous_options = options();
+    auto previous_variables = variables_map(&memory->pool);
+    std::swap(variables, previous_variables);
+    options(new_options);
+    auto last = calc_val::variant_type();
+    auto new_formulas = std::vector<std::pair<std::string_view, formula>>();
+    try {
+        last = reader.get_value();
+        trim_int(last);
+
+        auto n_variables = reader.get<std::uint64_t>();
+        for (std::uint64_t i = 0; i < n_variables; ++i) {
+            auto identifier = reader.get_string();
+            if (!is_snapshot_identifier(identifier))
+                throw invalid_snapshot();
+            auto val = reader.get_value();
+            trim_int(val);
+            variables.insert_or_assign(identifier, val);
+        }
+
+        // formulas are recompiled, which is cheap compared with converting
+        // their values from text. one that no longer compiles (which would
+        // take a snapshot that was tampered with) leaves its variable a plain
+        // value; one that define_formula would refuse rejects the snapshot
+        auto n_formulas = reader.get<std::uint64_t>();
+        if (n_formulas > snapshot.size())
+            throw invalid_snapshot();
+        for (std::uint64_t i = 0; i < n_formulas; ++i) {
+            auto identifier = reader.get_string();
+            auto source = reader.get_string();
+            if (!is_snapshot_identifier(identifier))
+                throw invalid_snapshot();
+            if (!variables.contains(identifier))
+                continue;
+            auto expr = std::make_shared<compiled_expr>();
+            expr->source_ = source;
+            compile_into(*expr, expr->source_);
+            if (failed()) {
+                parse_error.reset();
+                continue;
+            }
+            if (std::any_of(expr->nodes.begin(), expr->nodes.end(),
+                    [](const auto& n) {return n.kind == compiled_expr::assign_kind;}))
+                throw invalid_snapshot();
+            auto dependencies = formula_dependencies(*expr);
+            new_formulas.emplace_back(identifier, formula{std::move(expr), std::move(dependencies)});
+        }
+        if (!reader.at_end())
+            throw invalid_snapshot();
+        if (formulas_have_cycle(new_formulas))
+            throw invalid_snapshot();
+    } catch (...) {
+        parse_error.reset();
+        options(previous_options);
+        std::swap(variables, previous_variables);
+        throw;
+    }
+
+    // replace the session's state
+
+    changed_variables_.clear();
+    for (auto& [identifier, val] : previous_variables)
+        note_variable_change(identifier, variable_removed);
+    formulas.clear();
+    dependents.clear();
+    for (auto& [identifier, val] : variables)
+        note_variable_change(identifier, variable_added);
+
+    out_options = new_out_options;
+    last_val_pos->second = std::move(last);
+    for (auto& [identifier, f] : new_formulas)
+        bind_formula(identifier, std::move(f));
+
+    deliver_variables_delta();
+}
+
+auto calc_parser::load_snapshot(const char* path, output_options& out_options) -> void {
+    auto file = file_descriptor(::open(path, O_RDONLY | O_CLOEXEC));
+    struct stat file_stat;
+    if (::fstat(file.fd, &file_stat) < 0)
+        throw std::system_error(errno, std::generic_category(), "fstat");
+    auto size = static_cast<std::size_t>(file_stat.st_size);
+    if (!size)
+        throw invalid_snapshot();
+
+    auto data = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, file.fd, 0);
+    if (data == MAP_FAILED)
+        throw std::system_error(errno, std::generic_category(), "mmap");
+    struct mapping {
+        void* data;
+        std::size_t size;
+        ~mapping() {::munmap(data, size);}
+    } map{data, size};
+
+    load_snapshot(std::string_view(static_cast<const char*>(map.data), map.size), out_options);
+}
@@ -0,0 +1,571 @@
+// regressions: checks of calc_parser's features (and the c interface) and of
+// values that calc_parser once got wrong. prints the checks that fail and
+// exits with 1 if any did. run by make test
+
+#include "calc_outputter.hpp"
+#include "calc_parser.hpp"
+#include "calc_result_cache.hpp"
+#include "calc_stream_lexer.hpp"
+#include "ccalc.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <initializer_list>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+namespace {
+
+int failures = 0;
+
+auto check(std::string_view what, bool ok) -> void {
+    if (!ok) {
+        std::cout << "failed: " << what << '\n';
+        ++failures;
+    }
+}
+
+auto evaluate(calc_parser& parser, std::string_view input) -> calc_val::complex_type {
+// input's value, which is complex
+    auto out_options = output_options();
+    auto val = parser.evaluate(input, []{}, out_options);
+    auto z = std::get_if<calc_val::complex_type>(&val);
+    return z ? *z : calc_val::complex_type(std::numeric_limits<calc_val::float_type>::quiet_NaN());
+}
+
+auto formatted(const calc_parser::evaluation_result& result, const output_options& out_options) -> std::string {
+// the value as calc_outputter writes it, "error: " and the error's
+// description, or "void"
+    if (result.error)
+        return "error: " + result.error->error_str();
+    if (!result.has_value())
+        return "void";
+    auto out = std::ostringstream();
+    out << calc_outputter(out_options)(result.value);
+    return out.str();
+}
+
+template <typename Input>
+auto output(calc_parser& parser, Input&& input) -> std::string {
+// input's value formatted, or "threw" if evaluating input threw an exception
+    auto out_options = output_options();
+    try {
+        auto result = parser.try_evaluate(input, []{}, out_options);
+        return formatted(result, out_options);
+    } catch (...) {
+        return "threw";
+    }
+}
+
+auto check_output(calc_parser& parser, std::string_view input, std::string_view expected) -> void {
+    auto actual = output(parser, input);
+    check(std::string(input) + " gives " + std::string(expected) + " (not " + actual + ")", actual == expected);
+}
+
+auto check_outputs(std::initializer_list<std::pair<std::string_view, std::string_view>> cases) -> void {
+// each input evaluated, in order, by one parser gives the output paired with it
+    auto parser = calc_parser();
+    for (auto [input, expected] : cases)
+        check_output(parser, input, expected);
+}
+
+auto check_signed_zeros() -> void {
+// the real overloads of functions give the signs of the complex functions'
+// zeros
+    auto parser = calc_parser();
+    check("ln(sin(4)) has imaginary part -pi", signbit(evaluate(parser, "ln(sin(4))").imag()));
+    check("ln(cos(-4)) has imaginary part -pi", signbit(evaluate(parser, "ln(cos(-4))").imag()));
+    check("sin(2.5) has imaginary part -0", signbit(evaluate(parser, "sin(2.5)").imag()));
+    check("cbrt(-0) is 0", !signbit(evaluate(parser, "cbrt(-0)").real()));
+    check("atan(-0) is 0", !signbit(evaluate(parser, "atan(-0)").real()));
+    check("asinh(-0) is 0", !signbit(evaluate(parser, "asinh(-0)").real()));
+}
+
+auto check_cached_shadowed_internals() -> void {
+// a variable that shadows an internal is not taken for the internal's cached
+// value
+    auto cache = calc_result_cache();
+    auto parser = calc_parser();
+    parser.result_cache(&cache);
+    auto uncached = calc_parser();
+    for (auto input : {"pi*2", "sin(1)"}) {
+        evaluate(parser, input);
+        evaluate(parser, input);
+    }
+    for (auto input : {"pi=3", "sin=2"}) {
+        evaluate(parser, input);
+        evaluate(uncached, input);
+    }
+    check("pi*2 after pi=3 is 6", evaluate(parser, "pi*2") == calc_val::complex_type(6));
+    check("sin(1) after sin=2 is as uncached", evaluate(parser, "sin(1)") == evaluate(uncached, "sin(1)"));
+}
+
+auto check_stream_input() -> void {
+// input pulled from a stream evaluates as the same string does
+    auto parser = calc_parser();
+    auto out_options = output_options();
+    for (auto input : {std::string("max(1, 2)"), std::string("sum(1, 2, 3) - min(4, 5)")}) {
+        auto pos = std::size_t(0);
+        auto stream = calc_stream_lexer([&](char* buf, std::size_t size) {
+            size = input.copy(buf, size, pos);
+            pos += size;
+            return size;
+        });
+        check(input + " from a stream", parser.evaluate(stream, []{}, out_options)
+            == parser.evaluate(input, []{}, out_options));
+    }
+}
+
+auto check_compiled_shadowed_internals() -> void {
+// a compiled expression evaluates as its source does when a variable shadows
+// one of its internal identifiers, or no longer does
+    auto parser = calc_parser();
+    auto out_options = output_options();
+    auto same_as_source = [&](calc_parser::compiled_expr& expr) {
+        return parser.evaluate(expr) == parser.evaluate(expr.source(), []{}, out_options);
+    };
+    auto exprs = std::vector<calc_parser::compiled_expr>();
+    for (auto input : {"pi*2", "sin(1)", "e^2 + cos(pi)"})
+        exprs.push_back(parser.compile(input));
+    for (auto input : {"pi=3", "sin=2", "delete pi", "delete sin"}) {
+        try {
+            parser.evaluate(input, []{}, out_options);
+        } catch (const calc_parser::void_expression&) {}
+        for (auto& expr : exprs)
+            check(std::string(expr.source()) + " after " + input, same_as_source(expr));
+    }
+    auto expr = calc_parser().compile("(e=3)*e");
+    check("(e=3)*e compiled", parser.evaluate(expr) == calc_val::variant_type(calc_val::complex_type(9)));
+}
+
+auto check_engines_of_shadowed_internals() -> void {
+// the engine of a compiled expression is chosen again when a variable comes
+// to shadow one of its internal identifiers, or no longer does
+    auto parser = calc_parser();
+    auto out_options = output_options();
+    auto expr = parser.compile("0x3*pi");
+    auto source_value = [&] {return parser.evaluate(expr.source(), []{}, out_options);};
+    check("0x3*pi by the real engine",
+        parser.evaluate(expr) == source_value() && expr.engine() == calc_parser::compiled_expr::real_engine);
+    parser.evaluate("pi=0x4", []{}, out_options);
+    check("0x3*pi after pi=0x4 by the int engine",
+        parser.evaluate(expr) == source_value() && expr.engine() == calc_parser::compiled_expr::int_engine);
+    try {
+        parser.evaluate("delete pi", []{}, out_options);
+    } catch (const calc_parser::void_expression&) {}
+    check("0x3*pi after delete pi by the real engine",
+        parser.evaluate(expr) == source_value() && expr.engine() == calc_parser::compiled_expr::real_engine);
+}
+
+auto check_variables_itr() -> void {
+// the variables are enumerated as pairs of std::strings and values
+    auto parser = calc_parser();
+    auto out_options = output_options();
+    for (auto input : {"b=2", "a=1", "c=0x3"})
+        parser.evaluate(input, []{}, out_options);
+    auto names = std::string();
+    for (auto itr = parser.variables_begin(); itr != parser.variables_end(); ++itr) {
+        const calc_parser::variables_pair& variable = *itr;
+        std::string name = itr->first;
+        names += name + (variable.second.index() == 0 ? "r " : "i ");
+    }
+    check("variables a, b and c in order", names == "ar br ci ");
+}
+
+auto check_infinite_magnitudes() -> void {
+// hypot of an infinite part is inf (abs of a complex number would throw)
+    check_outputs({
+        {"hypot(exp(1e10),1)", "inf"},
+        {"@0du hypot(exp(-1),3)", "inf"},
+    });
+    check_outputs({{"hypot(3,4i)", "5"}});
+}
+
+auto check_infinite_sums() -> void {
+// a sum with an infinite term is inf, not the nan of the compensation inf - inf
+    check_outputs({
+        {"sum(exp(1e10))", "inf"},
+        {"sum(exp(1e10),1)", "inf"},
+        {"mean(exp(1e10),1)", "inf"},
+        {"sum(1,exp(1e10),-1)", "inf"},
+        {"sum(exp(1e10),-exp(1e10))", "nan"},
+        {"sum(1e300,1,-1e300)", "1"},
+    });
+}
+
+auto check_snapshots() -> void {
+// a snapshot restores the variables, formulas, "last" and options, and a
+// truncated or corrupt one is rejected with the session unchanged
+    auto parser = calc_parser();
+    for (auto input : {"@0di @w32", "x=5", "y=0x7fffffff+2", "@0dn", "r=2.5-1i", "r*2"})
+        output(parser, input);
+    parser.define_formula("f", "x*r");
+    auto out_options = output_options();
+    out_options.precision = 12;
+    auto snapshot = parser.save_snapshot(out_options);
+
+    auto loaded = calc_parser();
+    output(loaded, "w=1");
+    auto loaded_out_options = output_options();
+    loaded.load_snapshot(snapshot, loaded_out_options);
+    check("snapshot restores out_options", loaded_out_options.precision == 12);
+    check("snapshot restores options", loaded.options().int_word_size == calc_val::int_bits_32
+        && loaded.options().default_number_type_code == calc_val::complex_code);
+    check("snapshot restores the formula", loaded.formula_source("f") == std::optional<std::string_view>("x*r"));
+    for (auto [input, expected] : {std::pair{"last", "5-2i"}, {"x", "5"}, {"y", "-2147483647"}, {"r", "2.5-i"},
+            {"f", "12.5-5i"}, {"w", "error: Error: undefined identifier."}, {"x=2", "2"}, {"f", "5-2i"}})
+        check_output(loaded, input, expected);
+
+    auto rejected = [&](std::string_view snapshot) {
+        try {
+            loaded.load_snapshot(snapshot, loaded_out_options);
+        } catch (const calc_parser::invalid_snapshot&) {
+            return output(loaded, "x") == "2" && output(loaded, "f") == "5-2i" && loaded_out_options.precision == 12;
+        }
+        return false;
+    };
+    auto truncated_rejected = true;
+    for (std::size_t size = 0; size < snapshot.size(); ++size)
+        truncated_rejected = truncated_rejected && rejected(std::string_view(snapshot).substr(0, size));
+    check("truncated snapshots rejected", truncated_rejected);
+    auto corrupt = snapshot;
+    corrupt[0] ^= 1; // the magic
+    check("snapshot with a corrupt header rejected", rejected(corrupt));
+    check("snapshot with trailing bytes rejected", rejected(snapshot + '\0'));
+
+    auto replaced = [](std::string snapshot, std::string_view from, std::string_view to) {
+        auto pos = snapshot.find(from);
+        return pos == std::string::npos ? std::string() : snapshot.replace(pos, from.size(), to);
+    };
+    auto x_identifier = std::string("\1\0\0\0x", 5); // a string is its 32-bit length and characters
+    check("snapshot with an invalid identifier rejected", rejected(replaced(snapshot, x_identifier, "\1\0\0\0" "1")));
+    check("snapshot with an empty identifier rejected",
+        rejected(replaced(snapshot, x_identifier, std::string_view("\0\0\0\0", 4))));
+
+    auto formulas = calc_parser();
+    for (auto input : {"a=1", "b=2"})
+        output(formulas, input);
+    formulas.define_formula("f", "a+1");
+    formulas.define_formula("g", "b+1");
+    auto formulas_snapshot = formulas.save_snapshot(out_options);
+    check("snapshot with a formula cycle rejected",
+        rejected(replaced(replaced(formulas_snapshot, "a+1", "g+1"), "b+1", "f+1")));
+    check("snapshot with a formula of itself rejected", rejected(replaced(formulas_snapshot, "a+1", "f+1")));
+    check("snapshot with an assignment in a formula rejected", rejected(replaced(formulas_snapshot, "a+1", "a=1")));
+    loaded.load_snapshot(replaced(formulas_snapshot, "a+1", "g+a"), loaded_out_options);
+    for (auto [input, expected] : {std::pair{"f", "2"}, {"b=5", "5"}, {"f", "7"}}) // recomputed once g is
+        check_output(loaded, input, expected);
+
+    auto wider = calc_parser();
+    for (auto input : {"@0du @w64", "x=2**60+300", "pi=3", "@w8"})
+        output(wider, input);
+    check_output(wider, "@w16 x", "300"); // a variable keeps the bits above the word size
+    output(wider, "@w8");
+    loaded.load_snapshot(wider.save_snapshot(out_options), loaded_out_options);
+    check_output(loaded, "@w16 x", "44"); // but a loaded one is trimmed to the snapshot's
+    check_output(loaded, "pi", "3");
+}
+
+auto check_checkpoints() -> void {
+// restoring a checkpoint restores the variables and formulas and delivers the
+// delta from the current ones; a fork changes independently
+    auto parser = calc_parser();
+    auto delta = calc_parser::variables_delta();
+    parser.variables_delta_handler([&](const calc_parser::variables_delta& d) {delta = d;});
+    for (auto input : {"a=1", "b=2"})
+        output(parser, input);
+    parser.define_formula("f", "a+b");
+    auto state = parser.checkpoint();
+    for (auto input : {"a=10", "c=4", "delete b"})
+        output(parser, input);
+    check("delete b fails while f uses b", delta.removed.empty());
+    output(parser, "f=0");
+    output(parser, "delete b");
+    check("delete b after f=0", delta.removed == std::vector<std::string>{"b"});
+    auto version = delta.version;
+    parser.restore(state);
+    check("restore delta", delta.added == std::vector<std::string>{"b"}
+        && delta.modified == std::vector<std::string>{"a", "f"}
+        && delta.removed == std::vector<std::string>{"c"} && delta.version == version + 1);
+    for (auto [input, expected] : {std::pair{"a", "1"}, {"b", "2"}, {"f", "3"}, {"c", "error: Error: undefined identifier."}})
+        check_output(parser, input, expected);
+    check("restore restores the formula", parser.formula_source("f") == std::optional<std::string_view>("a+b"));
+    output(parser, "b=5");
+    check("restored formula recomputed", output(parser, "f") == "6" && delta.modified == std::vector<std::string>{"b", "f"});
+
+    auto fork = parser.fork();
+    output(fork, "a=100");
+    check("fork recomputes its formula", output(fork, "f") == "105");
+    check("fork leaves the session", output(parser, "a") == "1" && output(parser, "f") == "6");
+    check("fork has no delta handler", delta.modified == std::vector<std::string>{"b", "f"});
+}
+
+auto check_formulas() -> void {
+// formulas are recomputed when their dependencies change and can't depend on
+// themselves
+    auto parser = calc_parser();
+    for (auto input : {"w=2", "h=3"})
+        output(parser, input);
+    parser.define_formula("area", "w*h");
+    parser.define_formula("volume", "area*h");
+    check_output(parser, "volume", "18");
+    output(parser, "w=4");
+    check("changed variables after w=4", std::ranges::equal(parser.changed_variables(), std::vector<std::string_view>{"w", "area", "volume"}));
+    check_output(parser, "volume", "36");
+    auto define_error = [&](std::string_view identifier, std::string_view formula) {
+        try {
+            parser.define_formula(identifier, formula);
+        } catch (const calc_parse_error& e) {
+            return e.error();
+        }
+        return calc_parse_error::no_error;
+    };
+    check("w=volume+1 is a cycle", define_error("w", "volume+1") == calc_parse_error::formula_cycle);
+    check("area=area is a cycle", define_error("area", "area") == calc_parse_error::formula_cycle);
+    check("formula with an assignment", define_error("z", "(h=1)*2") == calc_parse_error::assignment_in_formula);
+    check_output(parser, "w", "4");
+    check_output(parser, "delete h", "error: Error: variable is used by a formula.");
+    check_output(parser, "area=1", "1");
+    check("assignment unbinds the formula", !parser.formula_source("area"));
+    check_output(parser, "h=5", "5");
+    check_output(parser, "volume", "5");
+    check_output(parser, "area", "1");
+}
+
+auto check_session_memory() -> void {
+// a formula's dependencies and the changed variables are allocated from the
+// session's pool, so they count toward memory_usage; pretokenizing a long
+// input that the memory limit leaves no room for falls back to lexing it
+    auto parser = calc_parser();
+    output(parser, "a=1");
+    auto before = parser.memory_usage().bytes_in_use;
+    auto sum = std::string("a");
+    for (auto i = 0; i < 200; ++i) {
+        auto identifier = "dependency_" + std::to_string(i) + "_of_the_formula";
+        output(parser, identifier + "=1");
+        sum += "+" + identifier;
+    }
+    auto with_variables = parser.memory_usage().bytes_in_use;
+    parser.define_formula("f", sum);
+    check("formula dependencies counted", parser.memory_usage().bytes_in_use > with_variables
+        && with_variables > before);
+    parser.memory_limit(parser.memory_usage().bytes_in_use);
+    check_output(parser, sum + "+0", "201");
+    parser.memory_limit(0);
+}
+
+auto check_cancellation() -> void {
+// a cancelled evaluation, or one past its deadline, fails
+    auto parser = calc_parser();
+    auto cancelled = calc_cancellation();
+    cancelled.cancel();
+    parser.cancellation(&cancelled);
+    check_output(parser, "1+1", "error: Error: evaluation cancelled.");
+    check_output(parser, "@0du @w64 3**18446744073709551615", "error: Error: evaluation cancelled.");
+    auto expired = calc_cancellation(calc_cancellation::clock::duration(0));
+    parser.cancellation(&expired);
+    check_output(parser, "1+1", "error: Error: evaluation deadline exceeded.");
+    auto pending = calc_cancellation(std::chrono::hours(1));
+    parser.cancellation(&pending);
+    check_output(parser, "1+1", "2");
+    parser.cancellation(nullptr);
+    check_output(parser, "1+1", "2");
+}
+
+auto check_validation() -> void {
+// validate classifies the tokens of the input and finds its first error
+    auto parser = calc_parser();
+    output(parser, "x=1");
+    auto classes = [&](std::string_view input) {
+        auto result = parser.validate(input);
+        auto s = std::string();
+        for (auto& token : result.tokens)
+            s += "nvcfuiopk@?"[token.token_class];
+        return s + (result.is_valid() ? "" : " " + result.error->error_str());
+    };
+    check("validate a=sin(pi)*x + 0x1f", classes("a=sin(pi)*x + 0x1f") == "vofpcpovon");
+    check("validate @0du y+2 z", classes("@0du y+2 z") == "@uoni Error: undefined identifier.");
+    check("validate 1 + b + c", classes("1 + b + c") == "nouoi Error: undefined identifier.");
+    check("validate 1 + (2", classes("1 + (2").back() == '.');
+    check("validate leaves the session", output(parser, "a") == "error: Error: undefined identifier.");
+}
+
+auto check_incremental_input() -> void {
+// incremental input evaluates as its source does after each edit, and reuses
+// the values of the groups and calls the edit didn't touch
+    auto parser = calc_parser();
+    auto input = calc_parser::incremental_input("sum(1,2,3) * (4+5) + sin(1)^2 + max(7, 8)");
+    auto same_as_source = [&] {
+        auto fresh = calc_parser();
+        return output(parser, input) == output(fresh, input.source());
+    };
+    check("incremental input", same_as_source());
+    input.replace(4, 1, "10");
+    check("incremental input after an edit", same_as_source() && input.reused_values() > 0);
+    input.replace(input.source().size() - 1, 1, "x");
+    check("incremental input with an error", same_as_source());
+    input.assign("sum(10,2,3) * (4+5) + sin(1)^2 + max(7, 9)");
+    check("incremental input after assign", same_as_source() && input.reused_values() > 0);
+    input.assign("@0du @w8 sum(200,2,3) * (4+5)");
+    check("incremental input with options", same_as_source());
+}
+
+auto check_batch_api() -> void {
+// the c interface evaluates a batch of expressions in order and truncates
+// the output that doesn't fit
+    auto session = ccalc_session_create();
+    const char input[] = "1+2" "" "1+" "x=40" "x+2" "help";
+    std::size_t offsets[] = {0, 3, 3, 5, 9, 12, 16};
+    ccalc_result results[6];
+    char out[64];
+    auto needed = std::size_t(0);
+    auto value = [&](const ccalc_result& result) {
+        return std::string_view(out + result.output_offset, result.output_length);
+    };
+    auto status = ccalc_evaluate_batch(session, input, offsets, 6, results, out, sizeof(out), &needed);
+    check("batch status", status == CCALC_OK && needed == 5);
+    check("batch values", results[0].kind == CCALC_VALUE && value(results[0]) == "3"
+        && results[3].kind == CCALC_VALUE && value(results[3]) == "40"
+        && results[4].kind == CCALC_VALUE && value(results[4]) == "42");
+    check("batch voids", results[1].kind == CCALC_VOID && results[5].kind == CCALC_VOID);
+    check("batch error", results[2].kind == CCALC_ERROR && results[2].error_code == CCALC_UNEXPECTED_END_OF_INPUT
+        && results[2].error_offset == 2);
+    status = ccalc_evaluate_batch(session, input + 9, offsets, 1, results, out, sizeof(out), &needed);
+    check("batch offsets", status == CCALC_OK && value(results[0]) == "42");
+    std::size_t offsets_x[] = {0, 4, 7};
+    status = ccalc_evaluate_batch(session, "x=41x+2", offsets_x, 2, results, out, 2, &needed);
+    check("batch truncated", status == CCALC_OUTPUT_TRUNCATED && needed == 4
+        && !results[0].output_truncated && value(results[0]) == "41"
+        && results[1].output_truncated && value(results[1]).empty());
+    std::size_t offsets_y[] = {0, 4, 8};
+    status = ccalc_evaluate_batch(session, "x*10x*20", offsets_y, 2, results, out, 4, &needed);
+    check("batch truncated within a value", status == CCALC_OUTPUT_TRUNCATED && needed == 6
+        && !results[0].output_truncated && value(results[0]) == "410"
+        && results[1].output_truncated && value(results[1]) == "8");
+    ccalc_session_destroy(session);
+}
+
+auto check_wide_ints() -> void {
+// arithmetic of 256, 512 and 1024-bit integers wraps around at the word size
+    check_outputs({
+        {"@0du @w256 2**255", "57896044618658097711785492504343953926634992332820282019728792003956564819968"},
+        {"2**256", "0"},
+        {"@0di 2**255", "-57896044618658097711785492504343953926634992332820282019728792003956564819968"},
+        {"-1 >> 200", "-1"},
+        {"@0du @w512 (2**128+1)**2",
+            "115792089237316195423570985008687907853950549399482440966384333222776666062849"},
+        {"2**511 + 2**511", "0"},
+        {"@0di -1", "-1"},
+        {"@0du -1", "1340780792994259709957402499820584612747936582059239337772356144372176403007354697680187429816690342"
+            "7690031858186486050853753882811946569946433649006084095"},
+        {"@0di @w1024 2**1000 / 2**998", "4"},
+        {"2**1022 / -(2**1021)", "-2"},
+        {"(2**600 + 7) % 2**600", "7"},
+        {"@0du @w256 0xffffffffffffffffffffffffffffffff + 1", "340282366920938463463374607431768211456"},
+        {"@w256 popcount(7)", "error: Error: function is unsupported for word sizes above 128 bits."},
+        {"@w512 gcd(12, 18)", "error: Error: function is unsupported for word sizes above 128 bits."},
+        {"@w1024 isprime(7)", "error: Error: function is unsupported for word sizes above 128 bits."},
+        {"powmod(2, 10, 1000)", "error: Error: function is unsupported for word sizes above 128 bits."},
+        {"gcd(1.5, 3)", "error: Error: invalid operand."},
+        {"sqrt(16)", "4"},
+    });
+}
+
+auto check_modular_ints() -> void {
+// the modular and prime functions give known values
+    check_outputs({
+        {"@0du @w64 powmod(2, 10, 1000)", "24"},
+        {"powmod(3, 4611686018427387903, 18446744073709551557)", "6516557149755782596"},
+        {"mulmod(18446744073709551615, 18446744073709551615, 18446744073709551557)", "3364"},
+        {"invmod(3, 7)", "5"},
+        {"invmod(2, 4)", "error: Error: invalid operand."},
+        {"isprime(18446744073709551557)", "1"},
+        {"isprime(18446744073709551559)", "0"},
+        {"factor(18446744073709551559)", "41"},
+        {"factor(18446744073709551557)", "18446744073709551557"},
+        {"factor(1)", "1"},
+        {"@w128 isprime(170141183460469231731687303715884105727)", "1"},
+        {"powmod(5, 170141183460469231731687303715884105726, 170141183460469231731687303715884105727)", "1"},
+    });
+}
+
+auto check_reductions() -> void {
+// the variadic functions of ints (which are reduced in lanes) and of floats
+    check_outputs({
+        {"sum(1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20)", "210"},
+        {"prod(1,2,3,4,5,6,7,8,9,10)", "3628800"},
+        {"mean(1,2,3,4)", "2.5"},
+        {"min(3,-1,2)", "-1"},
+        {"max(3,-1,2)", "3"},
+        {"hypot(3,4,12)", "13"},
+        {"sum(1e100, 1, -1e100)", "1"},
+        {"sum(1i, 2, 3i)", "2+4i"},
+        {"@0du @w8 sum(200, 100)", "44"},
+        {"prod(16, 16, 1)", "0"},
+        {"min(5, 3, 7, 9, 4)", "3"},
+        {"@0di @w16 min(-5, 3, 7)", "-5"},
+        {"max(-5, -3, -7, -9, -4)", "-3"},
+        {"@0du @w64 gcd(12, 18, 27)", "3"},
+        {"sum(18446744073709551615, 2)", "1"},
+        {"@w128 sum(18446744073709551615, 2)", "18446744073709551617"},
+        {"max(1, 340282366920938463463374607431768211455, 2)", "340282366920938463463374607431768211455"},
+    });
+}
+
+auto check_compiled_exprs() -> void {
+// compiled expressions evaluate as their sources do, whichever engine runs
+// them
+    auto parser = calc_parser();
+    auto exprs = std::vector<calc_parser::compiled_expr>();
+    for (auto input : {"x*2+1", "sin(x)+cos(x)^2", "sqrt(x)-ln(x)", "(x+1)*(x+1)/3", "max(x,2)*sum(x,1,y)",
+            "x^y - y", "hypot(x, y)", "0x7*y + x", "(y=x+1)*y", "exp(x*pi*i)", "x % y", "-x!"})
+        exprs.push_back(parser.compile(input));
+    for (auto values : {"x=2 ", "x=-1.5 ", "x=0x5 ", "x=3+4i ", "x=0 ", "y=2 ", "y=0x3 ", "x=-0x5 ", "y=0 "}) {
+        output(parser, values);
+        for (auto& expr : exprs) {
+            auto compiled = std::string();
+            try {
+                auto result = parser.try_evaluate(expr);
+                compiled = formatted(result, output_options());
+            } catch (...) {
+                compiled = "threw";
+            }
+            check(std::string(expr.source()) + " compiled after " + values + "(" + compiled + ")",
+                compiled == output(parser, expr.source()));
+        }
+    }
+}
+
+} // namespace
+
+auto main() -> int {
+    check_signed_zeros();
+    check_cached_shadowed_internals();
+    check_stream_input();
+    check_compiled_shadowed_internals();
+    check_engines_of_shadowed_internals();
+    check_variables_itr();
+    check_infinite_magnitudes();
+    check_infinite_sums();
+    check_snapshots();
+    check_checkpoints();
+    check_formulas();
+    check_session_memory();
+    check_cancellation();
+    check_validation();
+    check_incremental_input();
+    check_batch_api();
+    check_wide_ints();
+    check_modular_ints();
+    check_reductions();
+    check_compiled_exprs();
+    if (failures)
+        return EXIT_FAILURE;
+    std::cout << "all passed\n";
+}
@@ -3,11 +3,14 @@
 
 #include "basics.hpp"
 #include "complex_type.hpp"
+#include "wide_int.hpp"
 #include <variant>
 
 namespace calc_val {
 
-using variant_type = std::variant<complex_type, uint_type, int_type>;
+using variant_type = std::variant<complex_type, uint_type, int_type, wide_uint_type, wide_int_type>;
+// the wide alternatives hold the values of the int and uint types when the
+// int word size is above 128 bits
 
 } // namespace calc_val
 
@@ -0,0 +1,196 @@
+#include "wide_int.hpp"
+#include "is_digit.h"
+#include <algorithm>
+#include <cassert>
+
+namespace calc_val {
+
+namespace helper {
+
+using std::uint64_t;
+constexpr unsigned limb_count = std::tuple_size_v<wide_limbs>;
+
+static inline auto used_limbs(const wide_limbs& x) -> unsigned {
+// number of limbs below the highest limb that isn't 0
+    auto n = limb_count;
+    while (n && !x[n - 1])
+        --n;
+    return n;
+}
+
+static inline auto clz(uint64_t x) -> unsigned // x != 0
+{return __builtin_clzll(x);}
+
+auto wide_mul(const wide_limbs& x, const wide_limbs& y) -> wide_limbs {
+// schoolbook; only the limb products below limb_count are needed
+    auto r = wide_limbs{};
+    auto nx = used_limbs(x), ny = used_limbs(y);
+    for (unsigned i = 0; i < nx; ++i) {
+        if (!x[i])
+            continue;
+        auto carry = uint64_t(0);
+        auto n = std::min(ny, limb_count - i);
+        for (unsigned j = 0; j < n; ++j) {
+            auto p = static_cast<max_uint_type>(x[i]) * y[j] + r[i + j] + carry;
+            r[i + j] = static_cast<uint64_t>(p);
+            carry = static_cast<uint64_t>(p >> 64);
+        }
+        if (i + n < limb_count)
+            r[i + n] = carry;
+    }
+    return r;
+}
+
+auto wide_divmod(const wide_limbs& x, const wide_limbs& y, wide_limbs& remainder) -> wide_limbs {
+// knuth's algorithm d (taocp vol. 2, 4.3.1): the divisor is normalized so that
+// its top bit is 1, which makes each estimated quotient limb at most 2 too big
+    auto q = wide_limbs{};
+    remainder = wide_limbs{};
+    auto n = used_limbs(y), m = used_limbs(x);
+    assert(n);
+    if (m < n) {
+        remainder = x;
+        return q;
+    }
+    if (n == 1) {
+        auto r = max_uint_type(0);
+        for (auto i = m; i-- > 0;) {
+            auto t = r << 64 | x[i];
+            q[i] = static_cast<uint64_t>(t / y[0]);
+            r = t % y[0];
+        }
+        remainder[0] = static_cast<uint64_t>(r);
+        return q;
+    }
+
+    auto s = clz(y[n - 1]);
+    auto v = wide_limbs{}; // normalized y
+    std::array<uint64_t, limb_count + 1> u = {}; // normalized x, with a limb for the shifted out bits
+    for (auto i = n; i-- > 1;)
+        v[i] = s ? y[i] << s | y[i - 1] >> (64 - s) : y[i];
+    v[0] = y[0] << s;
+    u[m] = s ? x[m - 1] >> (64 - s) : 0;
+    for (auto i = m; i-- > 1;)
+        u[i] = s ? x[i] << s | x[i - 1] >> (64 - s) : x[i];
+    u[0] = x[0] << s;
+
+    for (auto j = m - n + 1; j-- > 0;) {
+        auto t = static_cast<max_uint_type>(u[j + n]) << 64 | u[j + n - 1];
+        auto qhat = t / v[n - 1];
+        auto rhat = t % v[n - 1];
+        while (qhat >> 64 || qhat * v[n - 2] > (rhat << 64 | u[j + n - 2])) {
+            --qhat;
+            rhat += v[n - 1];
+            if (rhat >> 64)
+                break;
+        }
+        // u[j..j+n] -= qhat * v
+        auto borrow = uint64_t(0), carry = uint64_t(0);
+        for (unsigned i = 0; i < n; ++i) {
+            auto p = qhat * v[i] + carry;
+            carry = static_cast<uint64_t>(p >> 64);
+            auto d = static_cast<max_uint_type>(u[i + j]) - static_cast<uint64_t>(p) - borrow;
+            u[i + j] = static_cast<uint64_t>(d);
+            borrow = static_cast<uint64_t>(d >> 64) & 1;
+        }
+        auto d = static_cast<max_uint_type>(u[j + n]) - carry - borrow;
+        u[j + n] = static_cast<uint64_t>(d);
+        if (d >> 64) { // qhat was 1 too big: add v back
+            --qhat;
+            auto c = uint64_t(0);
+            for (unsigned i = 0; i < n; ++i) {
+                auto sum = static_cast<max_uint_type>(u[i + j]) + v[i] + c;
+                u[i + j] = static_cast<uint64_t>(sum);
+                c = static_cast<uint64_t>(sum >> 64);
+            }
+            u[j + n] += c;
+        }
+        q[j] = static_cast<uint64_t>(qhat);
+    }
+
+    for (unsigned i = 0; i < n; ++i)
+        remainder[i] = s ? u[i] >> s | u[i + 1] << (64 - s) : u[i];
+    return q;
+}
+
+auto wide_shl(const wide_limbs& x, unsigned n) -> wide_limbs {
+    auto r = wide_limbs{};
+    auto limbs = n / 64, bits = n % 64;
+    for (auto i = limb_count; i-- > limbs;) {
+        auto k = i - limbs;
+        r[i] = bits ? x[k] << bits | (k ? x[k - 1] >> (64 - bits) : 0) : x[k];
+    }
+    return r;
+}
+
+auto wide_shr(const wide_limbs& x, unsigned n, uint64_t fill) -> wide_limbs {
+    auto r = wide_limbs{};
+    r.fill(fill);
+    auto limbs = n / 64, bits = n % 64;
+    for (unsigned i = 0; i + limbs < limb_count; ++i) {
+        auto k = i + limbs;
+        auto next = k + 1 < limb_count ? x[k + 1] : fill;
+        r[i] = bits ? x[k] >> bits | next << (64 - bits) : x[k];
+    }
+    return r;
+}
+
+auto wide_to_float(const wide_limbs& x) -> float_type {
+    auto r = float_type(0);
+    for (auto i = used_limbs(x); i-- > 0;)
+        r = ldexp(r, 64) + x[i];
+    return r;
+}
+
+auto wide_from_float(const float_type& x) -> wide_limbs {
+    auto r = wide_limbs{};
+    auto f = trunc(x);
+    int e;
+    frexp(f, &e);
+    if (e > 1024)
+        f = fmod(f, ldexp(float_type(1), 1024));
+    for (auto i = limb_count; i-- > 0;) {
+        auto place = ldexp(float_type(1), static_cast<int>(64 * i));
+        if (f < place)
+            continue;
+        auto limb = floor(f / place);
+        r[i] = static_cast<uint64_t>(limb);
+        f -= limb * place;
+    }
+    return r;
+}
+
+} // namespace helper
+
+auto from_chars(const char* begin, const char* end, wide_uint_type& num, unsigned radix) -> std::from_chars_result {
+// each digit multiplies the limbs by radix and adds to them, a pass of
+// carries that stops early while the number is small
+    auto r = std::from_chars_result{begin, std::errc::invalid_argument};
+    auto x = wide_uint_type();
+    auto used = 1u;
+    auto overflow = false;
+    for (; r.ptr < end; ++r.ptr) {
+        auto digit = digit_ord(*r.ptr, radix);
+        if (digit == -1)
+            break;
+        auto carry = static_cast<std::uint64_t>(digit);
+        for (unsigned i = 0; i < used; ++i) {
+            auto p = static_cast<max_uint_type>(x.limbs[i]) * radix + carry;
+            x.limbs[i] = static_cast<std::uint64_t>(p);
+            carry = static_cast<std::uint64_t>(p >> 64);
+        }
+        if (carry) {
+            if (used < wide_uint_type::limb_count)
+                x.limbs[used++] = carry;
+            else
+                overflow = true;
+        }
+    }
+    if (r.ptr != begin) {
+        r.ec = overflow ? std::errc::result_out_of_range : std::errc();
+        num = x;
+    }
+    return r;
+}
+
+} // namespace calc_val
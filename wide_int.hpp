@@ -0,0 +1,263 @@
+#ifndef WIDE_INT_HPP
+#define WIDE_INT_HPP
+
+// the integer types of the word sizes above 128 bits (int_bits_256 to
+// int_bits_1024): wide_uint_type and wide_int_type (see basics.hpp). both are
+// 1024-bit two's complement words of 64-bit limbs, least significant first,
+// that wrap around as __int128 does. calc_parser trims them to the word size
+// after each operation, so the limbs above it are 0 (or copies of the sign
+// bit).
+// the carry chains of addition and subtraction are 128-bit sums of limbs,
+// which compile to add with carry. products are the low 1024 bits, from
+// 64x64->128 bit limb products; limbs that are 0 are skipped, so the cost
+// follows the word size (16 limb products for 256-bit words). signed operands
+// are multiplied and divided as magnitudes. division is knuth's algorithm d
+
+#include "basics.hpp"
+#include <array>
+#include <compare>
+#include <concepts>
+#include <cstdint>
+#include <functional>
+#include <charconv>
+#include <type_traits>
+
+namespace calc_val {
+
+namespace helper { // implementation helper; not meant for public use
+    using wide_limbs = std::array<std::uint64_t, 16>;
+
+    auto wide_mul(const wide_limbs& x, const wide_limbs& y) -> wide_limbs;
+    // low half of the product
+
+    auto wide_divmod(const wide_limbs& x, const wide_limbs& y, wide_limbs& remainder) -> wide_limbs;
+    // quotient; y must not be 0
+
+    auto wide_shl(const wide_limbs& x, unsigned n) -> wide_limbs;
+    auto wide_shr(const wide_limbs& x, unsigned n, std::uint64_t fill) -> wide_limbs;
+    // fill is 0, or ~0 for an arithmetic shift of a negative number; n < 1024
+
+    auto wide_to_float(const wide_limbs& x) -> float_type;
+    auto wide_from_float(const float_type& x) -> wide_limbs;
+    // of magnitudes. wide_from_float truncates x, which must be finite and
+    // >= 0, and wraps it around 2^1024
+} // namespace helper
+
+template <bool Signed>
+class wide_integer {
+public:
+    static constexpr unsigned bits = 1024;
+    using limb_type = std::uint64_t;
+    static constexpr unsigned limb_count = bits / 64;
+
+    helper::wide_limbs limbs = {};
+
+    constexpr wide_integer() = default;
+
+    template <std::integral T>
+    constexpr wide_integer(T x) { // sign extended if T is signed
+        auto fill = limb_type(0);
+        if constexpr (std::is_signed_v<T>)
+            fill = x < 0 ? ~limb_type(0) : 0;
+        auto v = static_cast<max_uint_type>(x);
+        limbs[0] = static_cast<limb_type>(v);
+        limbs[1] = sizeof(T) > sizeof(limb_type) ? static_cast<limb_type>(v >> 64) : fill;
+        for (unsigned i = 2; i < limb_count; ++i)
+            limbs[i] = fill;
+    }
+
+    template <typename T> requires std::is_enum_v<T>
+    constexpr wide_integer(T x) : wide_integer(static_cast<std::underlying_type_t<T>>(x)) {}
+
+    explicit(Signed) constexpr wide_integer(const wide_integer<!Signed>& x) : limbs{x.limbs} {}
+    // as the built-in integers, int converts to uint implicitly, so that an
+    // operation on both is an operation on uints
+
+    template <std::integral T>
+    explicit constexpr operator T() const {
+        if constexpr (sizeof(T) > sizeof(limb_type))
+            return static_cast<T>(static_cast<max_uint_type>(limbs[1]) << 64 | limbs[0]);
+        else
+            return static_cast<T>(limbs[0]);
+    }
+
+    explicit operator float_type() const {
+        auto x = helper::wide_to_float(magnitude().limbs);
+        return is_negative() ? -x : x;
+    }
+
+    static auto from_float(const float_type& x) -> wide_integer {
+    // truncated; x must be finite
+        auto r = wide_integer();
+        r.limbs = helper::wide_from_float(abs(x));
+        return x < 0 ? -r : r;
+    }
+
+    constexpr auto is_negative() const -> bool {return Signed && limbs.back() >> 63;}
+
+    constexpr auto magnitude() const -> wide_integer<false> {
+    // of the most negative int too
+        return wide_integer<false>(is_negative() ? -*this : *this);
+    }
+
+    auto div_limb(limb_type d) -> limb_type {
+    // divides (as unsigned) by d, which must not be 0; returns the remainder
+        auto r = max_uint_type(0);
+        for (auto i = limb_count; i-- > 0;) {
+            auto n = r << 64 | limbs[i];
+            limbs[i] = static_cast<limb_type>(n / d);
+            r = n % d;
+        }
+        return static_cast<limb_type>(r);
+    }
+
+    friend constexpr auto operator+(const wide_integer& x, const wide_integer& y) -> wide_integer {
+        auto r = wide_integer();
+        auto carry = limb_type(0);
+        for (unsigned i = 0; i < limb_count; ++i) {
+            auto s = static_cast<max_uint_type>(x.limbs[i]) + y.limbs[i] + carry;
+            r.limbs[i] = static_cast<limb_type>(s);
+            carry = static_cast<limb_type>(s >> 64);
+        }
+        return r;
+    }
+
+    friend constexpr auto operator-(const wide_integer& x, const wide_integer& y) -> wide_integer {
+        auto r = wide_integer();
+        auto borrow = limb_type(0);
+        for (unsigned i = 0; i < limb_count; ++i) {
+            auto d = static_cast<max_uint_type>(x.limbs[i]) - y.limbs[i] - borrow;
+            r.limbs[i] = static_cast<limb_type>(d);
+            borrow = static_cast<limb_type>(d >> 64) & 1;
+        }
+        return r;
+    }
+
+    friend constexpr auto operator-(const wide_integer& x) -> wide_integer {return wide_integer() - x;}
+
+    friend auto operator*(const wide_integer& x, const wide_integer& y) -> wide_integer {
+        auto r = wide_integer();
+        r.limbs = helper::wide_mul(x.magnitude().limbs, y.magnitude().limbs);
+        return x.is_negative() != y.is_negative() ? -r : r;
+    }
+
+    friend auto operator/(const wide_integer& x, const wide_integer& y) -> wide_integer {
+    // truncated toward 0, as for the built-in integers
+        auto r = wide_integer(), q = wide_integer();
+        q.limbs = helper::wide_divmod(x.magnitude().limbs, y.magnitude().limbs, r.limbs);
+        return x.is_negative() != y.is_negative() ? -q : q;
+    }
+
+    friend auto operator%(const wide_integer& x, const wide_integer& y) -> wide_integer {
+    // has the sign of x
+        auto r = wide_integer();
+        helper::wide_divmod(x.magnitude().limbs, y.magnitude().limbs, r.limbs);
+        return x.is_negative() ? -r : r;
+    }
+
+    friend constexpr auto operator&(const wide_integer& x, const wide_integer& y) -> wide_integer
+    {return bitwise(x, y, std::bit_and<limb_type>());}
+
+    friend constexpr auto operator|(const wide_integer& x, const wide_integer& y) -> wide_integer
+    {return bitwise(x, y, std::bit_or<limb_type>());}
+
+    friend constexpr auto operator^(const wide_integer& x, const wide_integer& y) -> wide_integer
+    {return bitwise(x, y, std::bit_xor<limb_type>());}
+
+    friend constexpr auto operator~(const wide_integer& x) -> wide_integer {
+        auto r = x;
+        for (auto& limb : r.limbs)
+            limb = ~limb;
+        return r;
+    }
+
+    friend auto operator<<(const wide_integer& x, unsigned n) -> wide_integer {
+        auto r = wide_integer();
+        if (n < bits)
+            r.limbs = helper::wide_shl(x.limbs, n);
+        return r;
+    }
+
+    friend auto operator>>(const wide_integer& x, unsigned n) -> wide_integer {
+    // arithmetic for int
+        auto fill = x.is_negative() ? ~limb_type(0) : 0;
+        auto r = wide_integer();
+        if (n < bits)
+            r.limbs = helper::wide_shr(x.limbs, n, fill);
+        else
+            r.limbs.fill(fill);
+        return r;
+    }
+
+    template <bool S>
+    friend auto operator<<(const wide_integer& x, const wide_integer<S>& n) -> wide_integer
+    {return x << shift_count(n);}
+
+    template <bool S>
+    friend auto operator>>(const wide_integer& x, const wide_integer<S>& n) -> wide_integer
+    {return x >> shift_count(n);}
+
+    friend constexpr auto operator==(const wide_integer& x, const wide_integer& y) -> bool = default;
+
+    friend constexpr auto operator<=>(const wide_integer& x, const wide_integer& y) -> std::strong_ordering {
+        if (x.is_negative() != y.is_negative())
+            return x.is_negative() ? std::strong_ordering::less : std::strong_ordering::greater;
+        for (auto i = limb_count; i-- > 0;) {
+            if (x.limbs[i] != y.limbs[i])
+                return x.limbs[i] < y.limbs[i] ? std::strong_ordering::less : std::strong_ordering::greater;
+        }
+        return std::strong_ordering::equal;
+    }
+
+private:
+    template <typename Op>
+    static constexpr auto bitwise(const wide_integer& x, const wide_integer& y, Op op) -> wide_integer {
+        auto r = wide_integer();
+        for (unsigned i = 0; i < limb_count; ++i)
+            r.limbs[i] = op(x.limbs[i], y.limbs[i]);
+        return r;
+    }
+
+    template <bool S>
+    static constexpr auto shift_count(const wide_integer<S>& n) -> unsigned {
+    // bits if n is negative or >= bits (the caller checks for those)
+        for (unsigned i = 1; i < limb_count; ++i) {
+            if (n.limbs[i])
+                return bits;
+        }
+        return n.limbs[0] < bits ? static_cast<unsigned>(n.limbs[0]) : bits;
+    }
+};
+
+template <bool S1, bool S2>
+auto pow(const wide_integer<S1>& x, const wide_integer<S2>& e) -> wide_integer<S1> {
+// as pow of int_pow.hpp: a negative e gives 0
+    if (e.is_negative())
+        return 0;
+    auto r = wide_integer<S1>(1);
+    auto base = x;
+    for (auto n = wide_integer<false>(e); n != 0; n = n >> 1) {
+        if (n.limbs[0] & 1)
+            r = r * base;
+        base = base * base;
+    }
+    return r;
+}
+
+auto from_chars(const char* begin, const char* end, wide_uint_type& num, unsigned radix) -> std::from_chars_result;
+// as std::from_chars for an unsigned integer (without a sign); out of range
+// if the value is 2^1024 or more
+
+} // namespace calc_val
+
+template <bool Signed>
+struct std::hash<calc_val::wide_integer<Signed>> {
+    auto operator()(const calc_val::wide_integer<Signed>& x) const noexcept -> std::size_t {
+        auto h = std::size_t(0);
+        for (auto limb : x.limbs)
+            h = h * 31 + std::hash<std::uint64_t>()(limb);
+        return h;
+    }
+};
+
+#endif // WIDE_INT_HPP